@@ -0,0 +1,608 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 15:38
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Unordered map that tunes its own shard count and hot key replication
+from live contention statistics.
+*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#include "sharded_umap.hpp"
+#include "epoch.hpp"
+
+namespace ts
+{
+    /**
+     * @brief configuration of the automatic tuning of an adaptive_umap.
+     */
+    struct adaptive_options
+    {
+        // tune automatically in the background (otherwise only migrate() changes the layout)
+        bool auto_tune = true;
+        // how often the contention statistics are evaluated
+        std::chrono::milliseconds interval{100};
+        // bounds of the shard count (1 shard = one lock for the whole map)
+        std::size_t initial_shards = 1;
+        std::size_t min_shards = 1;
+        std::size_t max_shards = 64;
+        // minimum number of sampled lock acquisitions in an interval to base a decision on
+        std::uint64_t min_samples = 32;
+        // the shard count is multiplied by 4 if more than this fraction of lock time is spent waiting
+        double grow_wait_ratio = 0.2;
+        // the shard count is halved after shrink_after intervals below this wait ratio
+        double shrink_wait_ratio = 0.02;
+        unsigned shrink_after = 50;
+        // hot key replication is enabled above / disabled below these read shares
+        double replicate_read_share = 0.95;
+        double unreplicate_read_share = 0.8;
+        // hot key detection settings used when replication is enabled. If hot_keys.enabled
+        // is false, replication is never turned on.
+        hot_key_options hot_keys;
+    };
+
+    namespace __detail
+    {
+        /**
+         * @brief something the __tuner periodically calls back
+         */
+        class __tunable
+        {
+        public:
+            virtual void __tune() = 0;
+
+        protected:
+            ~__tunable() = default;
+        };
+
+        /**
+         * @brief process wide background thread periodically tuning all registered maps.
+         * One thread serves all maps, so there can be hundreds of them without hundreds of threads.
+         * Like the epoch_manager it is intentionally never destroyed.
+         */
+        class __tuner
+        {
+        private:
+            struct __entry
+            {
+                __tunable *target;
+                std::chrono::milliseconds interval;
+                std::chrono::steady_clock::time_point due;
+            };
+
+            std::mutex __mutex;
+            std::condition_variable __cv;
+            std::vector<__entry> __entries;
+            __tunable *__running = nullptr;
+            bool __started = false;
+
+            __tuner() = default;
+
+            void __run()
+            {
+                std::unique_lock lock(__mutex);
+                for (;;)
+                {
+                    if (__entries.empty())
+                    {
+                        __cv.wait(lock);
+                        continue;
+                    }
+                    auto next = std::min_element(__entries.begin(), __entries.end(), [](const __entry &_a, const __entry &_b)
+                    {
+                        return _a.due < _b.due;
+                    });
+                    auto now = std::chrono::steady_clock::now();
+                    if (now < next->due)
+                    {
+                        __cv.wait_until(lock, next->due);
+                        continue;
+                    }
+
+                    next->due = now + next->interval;
+                    __running = next->target;
+                    lock.unlock();
+                    try
+                    {
+                        __running->__tune();
+                    }
+                    catch (...)
+                    {
+                        // e.g. a lock timeout during migration, which leaves the map on its
+                        // old layout, so it is simply retried next interval
+                    }
+                    lock.lock();
+                    __running = nullptr;
+                    __cv.notify_all();
+                }
+            }
+
+        public:
+            static __tuner &instance()
+            {
+                static __tuner *tuner = new __tuner();
+                return *tuner;
+            }
+
+            void add(__tunable *_target, std::chrono::milliseconds _interval)
+            {
+                std::lock_guard lock(__mutex);
+                __entries.push_back({_target, _interval, std::chrono::steady_clock::now() + _interval});
+                if (!__started)
+                {
+                    std::thread(&__tuner::__run, this).detach();
+                    __started = true;
+                }
+                __cv.notify_all();
+            }
+
+            /**
+             * @brief unregisters _target, waiting for a running __tune() call on it to finish
+             */
+            void remove(__tunable *_target)
+            {
+                std::unique_lock lock(__mutex);
+                __entries.erase(std::remove_if(__entries.begin(), __entries.end(), [&](const __entry &_e)
+                {
+                    return _e.target == _target;
+                }), __entries.end());
+                __cv.wait(lock, [&]
+                {
+                    return __running != _target;
+                });
+            }
+        };
+    };
+
+    /**
+     * @brief unordered map that watches its own lock contention and migrates between
+     * layouts online: from a single lock up to many shards (and back when contention is gone),
+     * and with or without hot key replication (see sharded_umap) depending on the read/write mix.
+     *
+     * Decisions are made by a single process wide background thread every interval, based on
+     * the wait ratio (time spent waiting for locks vs. holding them) and the read share of
+     * sampled accesses. A migration builds the new layout next to the old one while both
+     * stay in use: writers update both, readers keep reading the old one, and the elements are
+     * copied over in the background. Once the copy is complete the new layout is published
+     * atomically and the old one is freed after all threads stopped using it (epoch_manager).
+     * Callers are never blocked for the duration of a migration.
+     *
+     * @tparam _K key type
+     * @tparam _V mapped type (copyable, lookups return copies)
+     * @tparam _Hash key hash function
+     * @tparam _KeyEqual key equality predicate
+     */
+    template <class _K, class _V, class _Hash = std::hash<_K>, class _KeyEqual = std::equal_to<_K>>
+    class adaptive_umap : private __detail::__tunable
+    {
+    public:
+        typedef _K key_type;
+        typedef _V mapped_type;
+        typedef std::size_t size_type;
+        typedef sharded_umap<_K, _V, _Hash, _KeyEqual> layout_type;
+
+        /**
+         * @brief snapshot of the current layout and tuning state
+         */
+        struct stats_t
+        {
+            size_type shard_count = 0;
+            bool hot_key_replication = false;
+            // number of completed migrations
+            std::uint64_t migrations = 0;
+            // wait ratio and read share seen in the last evaluated interval
+            double wait_ratio = 0.0;
+            double read_share = 0.0;
+            // contention of the current layout since it was created
+            ts::contention_stats contention;
+        };
+
+    private:
+        /**
+         * @brief the layouts in use. During a migration, next is the layout being filled.
+         * Published states are immutable and replaced as a whole.
+         */
+        struct __state
+        {
+            layout_type *current;
+            layout_type *next;
+        };
+
+        struct alignas(64) __stripe
+        {
+            std::mutex mutex;
+        };
+
+        // writers of the same key are serialized by these during a migration
+        static constexpr size_type __stripe_count = 32;
+
+        std::atomic<__state *> __state_ptr;
+        adaptive_options __options;
+        _Hash __hash;
+        std::chrono::milliseconds __lock_timeout{10000};
+        std::unique_ptr<__stripe[]> __stripes;
+
+        // layout changes are serialized by this
+        std::mutex __migration_mutex;
+
+        // tuning state, only accessed while holding __migration_mutex
+        ts::contention_stats __last_contention;
+        unsigned __calm_intervals = 0;
+
+        std::atomic<std::uint64_t> __migrations{0};
+        std::atomic<double> __wait_ratio{0.0};
+        std::atomic<double> __read_share{0.0};
+
+        layout_type *__make_layout(size_type _shards, bool _replicate)
+        {
+            hot_key_options hot = __options.hot_keys;
+            hot.enabled = _replicate;
+            auto layout = new layout_type(_shards, hot);
+            layout->set_lock_timeout(__lock_timeout);
+            return layout;
+        }
+
+        std::mutex &__stripe_for(const _K &_key)
+        {
+            return __stripes[__hash(_key) % __stripe_count].mutex;
+        }
+
+        /**
+         * @brief runs a modification. Outside of migrations _fn is applied to the current
+         * layout only. During a migration _mirror is additionally applied to the new layout,
+         * with both steps done under the key's stripe so the layouts agree on the key's value.
+         *
+         * @param _fn function modifying the current layout, its result is returned
+         * @param _mirror function applying the result of _fn to the new layout
+         */
+        template <class _Fn, class _Mirror>
+        auto __modify(const _K &_key, _Fn &&_fn, _Mirror &&_mirror)
+        {
+            epoch_guard guard;
+            __state *state = __state_ptr.load(std::memory_order_seq_cst);
+            if (state->next == nullptr)
+                return _fn(*state->current);
+
+            std::unique_lock lock(__stripe_for(_key));
+            // the migration may have finished while waiting. It can't while the stripe is
+            // held, and mirroring into a published layout could overwrite newer values.
+            state = __state_ptr.load(std::memory_order_seq_cst);
+            if (state->next == nullptr)
+            {
+                lock.unlock();
+                return _fn(*state->current);
+            }
+            auto result = _fn(*state->current);
+            _mirror(*state->next, result);
+            return result;
+        }
+
+        /**
+         * @brief stores _state while holding all stripes, so no modification is in the middle
+         * of updating both layouts
+         */
+        void __publish(__state *_state) noexcept
+        {
+            for (size_type i = 0; i < __stripe_count; i++)
+                __stripes[i].mutex.lock();
+            __state_ptr.store(_state, std::memory_order_seq_cst);
+            for (size_type i = 0; i < __stripe_count; i++)
+                __stripes[i].mutex.unlock();
+        }
+
+        /**
+         * @brief moves all data to a new layout. __migration_mutex has to be held. If copying
+         * fails (e.g. a lock timeout), the map stays on the old layout and the error is rethrown.
+         */
+        void __migrate_locked(size_type _shards, bool _replicate)
+        {
+            __state *old_state = __state_ptr.load(std::memory_order_seq_cst);
+            layout_type *from = old_state->current;
+            std::unique_ptr<layout_type> to(__make_layout(_shards, _replicate));
+            // all states are allocated up front, so giving up later can't fail
+            std::unique_ptr<__state> migrating(new __state{from, to.get()});
+            std::unique_ptr<__state> done(new __state{to.get(), nullptr});
+            std::unique_ptr<__state> aborted(new __state{from, nullptr});
+
+            // from now on, every modification is mirrored into the new layout. Wait for
+            // modifications that still only apply to the old one.
+            __state_ptr.store(migrating.get(), std::memory_order_seq_cst);
+            epoch_manager &epochs = epoch_manager::instance();
+            epochs.synchronize();
+            delete old_state;
+
+            // copy the elements. The keys of each shard are collected under its shared lock,
+            // then every key is copied with the current value under its stripe, so the copy
+            // can't race with (and overwrite) a mirrored modification of the same key.
+            try
+            {
+                std::vector<_K> keys;
+                for (size_type i = 0; i < from->shard_count(); i++)
+                {
+                    keys.clear();
+                    {
+                        auto access = from->get_shared_shard_access(i);
+                        keys.reserve(access->size());
+                        for (const auto &element : *access)
+                            keys.push_back(element.first);
+                    }
+                    for (const auto &key : keys)
+                    {
+                        std::lock_guard lock(__stripe_for(key));
+                        if (auto value = from->find(key))
+                            to->insert(key, *value);
+                    }
+                }
+            }
+            catch (...)
+            {
+                // e.g. a lock timeout or bad_alloc: stop mirroring and drop the partial copy
+                __publish(aborted.release());
+                epochs.synchronize();
+                throw;
+            }
+
+            __publish(done.release());
+            epochs.synchronize();
+            to.release();
+            delete from;
+
+            __last_contention = ts::contention_stats();
+            __calm_intervals = 0;
+            __migrations.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief evaluates the contention since the last call and migrates if necessary.
+         * Called by the tuner thread.
+         */
+        void __tune() override
+        {
+            std::unique_lock lock(__migration_mutex, std::try_to_lock);
+            if (!lock)
+                return;
+
+            layout_type *current = __state_ptr.load(std::memory_order_seq_cst)->current;
+            ts::contention_stats now = current->contention();
+            ts::contention_stats delta;
+            delta.sampled_reads = now.sampled_reads - __last_contention.sampled_reads;
+            delta.sampled_writes = now.sampled_writes - __last_contention.sampled_writes;
+            delta.wait = now.wait - __last_contention.wait;
+            delta.hold = now.hold - __last_contention.hold;
+            __last_contention = now;
+
+            std::uint64_t samples = delta.sampled_reads + delta.sampled_writes;
+            if (samples < __options.min_samples)
+                return;
+            double wait_ratio = delta.wait_ratio();
+            double read_share = static_cast<double>(delta.sampled_reads) / static_cast<double>(samples);
+            __wait_ratio.store(wait_ratio, std::memory_order_relaxed);
+            __read_share.store(read_share, std::memory_order_relaxed);
+
+            size_type shards = current->shard_count();
+            size_type target_shards = shards;
+            if (wait_ratio > __options.grow_wait_ratio)
+            {
+                target_shards = std::min(__options.max_shards, shards * 4);
+                __calm_intervals = 0;
+            }
+            else if (wait_ratio < __options.shrink_wait_ratio)
+            {
+                if (++__calm_intervals >= __options.shrink_after)
+                {
+                    target_shards = std::max(__options.min_shards, shards / 2);
+                    __calm_intervals = 0;
+                }
+            }
+            else
+                __calm_intervals = 0;
+
+            bool replicate = current->hot_keys().enabled;
+            bool target_replicate = replicate;
+            if (__options.hot_keys.enabled)
+            {
+                // replicating only pays off for contended, read mostly maps
+                if (read_share >= __options.replicate_read_share && wait_ratio > __options.shrink_wait_ratio)
+                    target_replicate = true;
+                else if (read_share < __options.unreplicate_read_share)
+                    target_replicate = false;
+            }
+
+            if (target_shards != shards || target_replicate != replicate)
+                __migrate_locked(target_shards, target_replicate);
+        }
+
+    public:
+        explicit adaptive_umap(adaptive_options _options = adaptive_options())
+            : __options(_options),
+            __stripes(new __stripe[__stripe_count])
+        {
+            __options.min_shards = std::max<size_type>(1, __options.min_shards);
+            __options.max_shards = std::max(__options.min_shards, __options.max_shards);
+            size_type shards = std::clamp(__options.initial_shards, __options.min_shards, __options.max_shards);
+            __state_ptr.store(new __state{__make_layout(shards, false), nullptr});
+
+            if (__options.auto_tune)
+                __detail::__tuner::instance().add(this, __options.interval);
+        }
+
+        // the map is shared between threads by reference, so copying it makes no sense
+        adaptive_umap(const adaptive_umap &) = delete;
+        adaptive_umap &operator=(const adaptive_umap &) = delete;
+
+        ~adaptive_umap()
+        {
+            if (__options.auto_tune)
+                __detail::__tuner::instance().remove(this);
+            __state *state = __state_ptr.load(std::memory_order_relaxed);
+            delete state->current;
+            delete state;
+        }
+
+        /**
+         * @brief Set the lock timeout of the map's locks (see wrapper::set_lock_timeout()).
+         * Waits for a running migration to finish.
+         */
+        void set_lock_timeout(std::chrono::milliseconds _ms)
+        {
+            std::lock_guard lock(__migration_mutex);
+            __lock_timeout = _ms;
+            __state_ptr.load(std::memory_order_seq_cst)->current->set_lock_timeout(_ms);
+        }
+
+        /**
+         * @brief migrates to a layout with _shard_count shards and hot key replication enabled
+         * or disabled, regardless of the tuning. The map stays fully usable while this runs.
+         * With auto tuning enabled, the tuner may later decide to migrate again.
+         */
+        void migrate(size_type _shard_count, bool _replicate_hot_keys)
+        {
+            std::lock_guard lock(__migration_mutex);
+            __migrate_locked(std::max<size_type>(1, _shard_count), _replicate_hot_keys);
+        }
+
+        /**
+         * @return std::optional<_V> copy of the value mapped to _key, empty if there is none
+         */
+        std::optional<_V> find(const _K &_key)
+        {
+            epoch_guard guard;
+            return __state_ptr.load(std::memory_order_seq_cst)->current->find(_key);
+        }
+
+        bool contains(const _K &_key)
+        {
+            return find(_key).has_value();
+        }
+
+        /**
+         * @brief inserts _value for _key if the key is not present yet.
+         * @return bool true if the element was inserted
+         */
+        bool insert(const _K &_key, const _V &_value)
+        {
+            return __modify(_key, [&](layout_type &_l)
+            {
+                return _l.insert(_key, _value);
+            }, [&](layout_type &_l, bool _inserted)
+            {
+                if (_inserted)
+                    _l.insert_or_assign(_key, _value);
+            });
+        }
+
+        /**
+         * @brief inserts _value for _key or overwrites the existing value.
+         * @return bool true if the element was inserted, false if it was assigned
+         */
+        bool insert_or_assign(const _K &_key, const _V &_value)
+        {
+            return __modify(_key, [&](layout_type &_l)
+            {
+                return _l.insert_or_assign(_key, _value);
+            }, [&](layout_type &_l, bool)
+            {
+                _l.insert_or_assign(_key, _value);
+            });
+        }
+
+        /**
+         * @brief calls _fn with a reference to the value of _key while holding the
+         * lock of the key's shard, if the key is present. _fn is called exactly once.
+         * @return bool true if the key was present
+         */
+        template <class _Fn>
+        bool update(const _K &_key, _Fn _fn)
+        {
+            std::optional<_V> updated;
+            return __modify(_key, [&](layout_type &_l)
+            {
+                return _l.update(_key, [&](_V &_value)
+                {
+                    _fn(_value);
+                    updated = _value;
+                });
+            }, [&](layout_type &_l, bool _found)
+            {
+                if (_found)
+                    _l.insert_or_assign(_key, *updated);
+            });
+        }
+
+        /**
+         * @return size_type number of elements removed (0 or 1)
+         */
+        size_type erase(const _K &_key)
+        {
+            return __modify(_key, [&](layout_type &_l)
+            {
+                return _l.erase(_key);
+            }, [&](layout_type &_l, size_type)
+            {
+                _l.erase(_key);
+            });
+        }
+
+        /**
+         * @brief removes all elements. Waits for a running migration to finish.
+         */
+        void clear()
+        {
+            std::lock_guard lock(__migration_mutex);
+            __state_ptr.load(std::memory_order_seq_cst)->current->clear();
+        }
+
+        /**
+         * @brief number of elements. Under concurrent modification the result is only approximate.
+         */
+        size_type size()
+        {
+            epoch_guard guard;
+            return __state_ptr.load(std::memory_order_seq_cst)->current->size();
+        }
+
+        bool empty()
+        {
+            return size() == 0;
+        }
+
+        size_type shard_count()
+        {
+            epoch_guard guard;
+            return __state_ptr.load(std::memory_order_seq_cst)->current->shard_count();
+        }
+
+        stats_t stats()
+        {
+            stats_t stats;
+            epoch_guard guard;
+            layout_type *current = __state_ptr.load(std::memory_order_seq_cst)->current;
+            stats.shard_count = current->shard_count();
+            stats.hot_key_replication = current->hot_keys().enabled;
+            stats.migrations = __migrations.load(std::memory_order_relaxed);
+            stats.wait_ratio = __wait_ratio.load(std::memory_order_relaxed);
+            stats.read_share = __read_share.load(std::memory_order_relaxed);
+            stats.contention = current->contention();
+            return stats;
+        }
+    };
+};
@@ -0,0 +1,899 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 13:52
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Concurrent ordered map implemented as an adaptive radix tree with lock-free readers.
+
+Based on:
+V. Leis, A. Kemper, T. Neumann: "The Adaptive Radix Tree: ARTful Indexing for
+Main-Memory Databases" (ICDE 2013) and
+V. Leis, F. Scheibner, A. Kemper, T. Neumann: "The ART of Practical Synchronization"
+(DaMoN 2016), whose ROWEX protocol the read path follows.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <algorithm>
+#include <type_traits>
+
+#include "epoch.hpp"
+
+namespace ts
+{
+    /**
+     * @brief converts keys of an art_map into binary comparable byte strings,
+     * meaning that comparing the byte strings lexicographically (as unsigned bytes)
+     * yields the same order as comparing the keys.
+     * Specializations are provided for integral types and std::string.
+     * encode() may return any type providing data() and size().
+     */
+    template <class _K, class = void>
+    struct art_key_traits;
+
+    template <class _K>
+    struct art_key_traits<_K, std::enable_if_t<std::is_integral_v<_K>>>
+    {
+        static std::array<std::uint8_t, sizeof(_K)> encode(_K _key) noexcept
+        {
+            typedef std::make_unsigned_t<_K> unsigned_t;
+            unsigned_t value = static_cast<unsigned_t>(_key);
+            // flipping the sign bit makes negative numbers sort before positive ones
+            if constexpr (std::is_signed_v<_K>)
+                value ^= unsigned_t(1) << (sizeof(_K) * 8 - 1);
+
+            std::array<std::uint8_t, sizeof(_K)> bytes;
+            for (std::size_t i = 0; i < sizeof(_K); i++)
+                bytes[i] = static_cast<std::uint8_t>(value >> ((sizeof(_K) - 1 - i) * 8));
+            return bytes;
+        }
+    };
+
+    template <>
+    struct art_key_traits<std::string>
+    {
+        static std::string_view encode(const std::string &_key) noexcept
+        {
+            return std::string_view(_key);
+        }
+    };
+
+    /**
+     * @brief concurrent ordered map implemented as an adaptive radix tree (ART).
+     * Instead of comparing whole keys at every level like std::map, the tree branches on one
+     * key byte per level, with node sizes (4, 16, 48 or 256 children) adapting to the
+     * number of children and common key prefixes compressed into the nodes.
+     * This makes lookups of long keys with shared prefixes (paths, tenant ids, ...) cheap
+     * and allows prefix scans that only visit the matching subtree.
+     *
+     * Readers never lock and never restart: writers (which are serialized by a mutex)
+     * only modify the tree with single atomic stores that keep it valid for concurrent
+     * readers at all times (ROWEX: read optimistic, write exclusive). Nodes that have to grow,
+     * change their prefix or be removed are replaced by a modified copy, and leaves are
+     * immutable and replaced when their value changes. Replaced objects are reclaimed with
+     * the epoch_manager once no reader can access them anymore.
+     *
+     * Keys ending inside the tree (one key being a prefix of another) are supported.
+     * Lookups return copies, while iteration callbacks receive references that are
+     * valid for the duration of the callback.
+     *
+     * @tparam _K key type, needs a specialization of art_key_traits (integers and std::string are provided)
+     * @tparam _V mapped type
+     * @tparam _Traits key encoding
+     */
+    template <class _K, class _V, class _Traits = art_key_traits<_K>>
+    class art_map
+    {
+    public:
+        typedef _K key_type;
+        typedef _V mapped_type;
+        typedef std::size_t size_type;
+
+    private:
+        // encoded keys and prefixes, bytes are compared as unsigned
+        typedef std::string __bytes_t;
+        typedef std::string_view __view_t;
+
+        struct __leaf
+        {
+            const _K key;
+            const _V value;
+        };
+
+        enum class __type : std::uint8_t
+        {
+            node4,
+            node16,
+            node48,
+            node256
+        };
+
+        // child pointers are tagged: bit 0 set = __leaf, otherwise __inner
+        typedef std::uintptr_t __ptr;
+
+        struct __inner
+        {
+            const __type type;
+            // compressed path, immutable once the node is published
+            const __bytes_t prefix;
+            // leaf of the key that ends right after this node's prefix
+            std::atomic<__leaf *> terminal{nullptr};
+            // number of non-null children, only used by the writer
+            std::uint16_t live = 0;
+
+            __inner(__type _type, __bytes_t _prefix)
+                : type(_type),
+                prefix(std::move(_prefix))
+            {
+            }
+        };
+
+        /**
+         * @brief node with up to _N children stored in (byte, child) slots.
+         * Slots are only ever appended (published by count) and a slot stays bound to its
+         * byte, so readers scanning the first count slots always see consistent bytes.
+         */
+        template <std::size_t _N, __type _Type>
+        struct __node_n : __inner
+        {
+            std::atomic<std::uint8_t> count{0};
+            std::uint8_t keys[_N];
+            std::atomic<__ptr> children[_N] = {};
+
+            explicit __node_n(__bytes_t _prefix)
+                : __inner(_Type, std::move(_prefix))
+            {
+            }
+        };
+        typedef __node_n<4, __type::node4> __node4;
+        typedef __node_n<16, __type::node16> __node16;
+
+        struct __node48 : __inner
+        {
+            std::atomic<std::uint8_t> count{0};
+            // slot + 1 of each byte's child, 0 = none. A slot stays bound to its byte.
+            std::atomic<std::uint8_t> index[256] = {};
+            std::atomic<__ptr> children[48] = {};
+
+            explicit __node48(__bytes_t _prefix)
+                : __inner(__type::node48, std::move(_prefix))
+            {
+            }
+        };
+
+        struct __node256 : __inner
+        {
+            std::atomic<__ptr> children[256] = {};
+
+            explicit __node256(__bytes_t _prefix)
+                : __inner(__type::node256, std::move(_prefix))
+            {
+            }
+        };
+
+        std::atomic<__ptr> __root{0};
+        std::atomic<size_type> __size{0};
+        std::mutex __write_mutex;
+
+        // == pointer tagging ==
+
+        static bool __is_leaf(__ptr _p) noexcept
+        {
+            return _p & 1;
+        }
+        static __leaf *__as_leaf(__ptr _p) noexcept
+        {
+            return reinterpret_cast<__leaf *>(_p & ~__ptr(1));
+        }
+        static __inner *__as_inner(__ptr _p) noexcept
+        {
+            return reinterpret_cast<__inner *>(_p);
+        }
+        static __ptr __tag(__leaf *_l) noexcept
+        {
+            return reinterpret_cast<__ptr>(_l) | 1;
+        }
+        static __ptr __tag(__inner *_n) noexcept
+        {
+            return reinterpret_cast<__ptr>(_n);
+        }
+
+        template <class _E>
+        static __view_t __as_view(const _E &_encoded) noexcept
+        {
+            return __view_t(reinterpret_cast<const char *>(_encoded.data()), _encoded.size());
+        }
+
+        // == node access (safe for concurrent readers) ==
+
+        /**
+         * @return std::atomic<__ptr>* the child slot of _byte or nullptr if there is none
+         */
+        static std::atomic<__ptr> *__find_slot(__inner *_n, std::uint8_t _byte) noexcept
+        {
+            switch (_n->type)
+            {
+            case __type::node4:
+            {
+                auto *n = static_cast<__node4 *>(_n);
+                std::uint8_t count = n->count.load(std::memory_order_acquire);
+                for (std::uint8_t i = 0; i < count; i++)
+                    if (n->keys[i] == _byte)
+                        return &n->children[i];
+                return nullptr;
+            }
+            case __type::node16:
+            {
+                auto *n = static_cast<__node16 *>(_n);
+                std::uint8_t count = n->count.load(std::memory_order_acquire);
+                for (std::uint8_t i = 0; i < count; i++)
+                    if (n->keys[i] == _byte)
+                        return &n->children[i];
+                return nullptr;
+            }
+            case __type::node48:
+            {
+                auto *n = static_cast<__node48 *>(_n);
+                std::uint8_t slot = n->index[_byte].load(std::memory_order_acquire);
+                return slot == 0 ? nullptr : &n->children[slot - 1];
+            }
+            case __type::node256:
+                return &static_cast<__node256 *>(_n)->children[_byte];
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief calls _fn(byte, child) for every non-null child in ascending byte order
+         */
+        template <class _Fn>
+        static void __for_each_child(__inner *_n, _Fn &&_fn)
+        {
+            switch (_n->type)
+            {
+            case __type::node4:
+                __for_each_child_n(static_cast<__node4 *>(_n), _fn);
+                break;
+            case __type::node16:
+                __for_each_child_n(static_cast<__node16 *>(_n), _fn);
+                break;
+            case __type::node48:
+            {
+                auto *n = static_cast<__node48 *>(_n);
+                for (unsigned b = 0; b < 256; b++)
+                {
+                    std::uint8_t slot = n->index[b].load(std::memory_order_acquire);
+                    if (slot == 0)
+                        continue;
+                    __ptr child = n->children[slot - 1].load(std::memory_order_acquire);
+                    if (child)
+                        _fn(static_cast<std::uint8_t>(b), child);
+                }
+                break;
+            }
+            case __type::node256:
+            {
+                auto *n = static_cast<__node256 *>(_n);
+                for (unsigned b = 0; b < 256; b++)
+                {
+                    __ptr child = n->children[b].load(std::memory_order_acquire);
+                    if (child)
+                        _fn(static_cast<std::uint8_t>(b), child);
+                }
+                break;
+            }
+            }
+        }
+
+        template <class _Node, class _Fn>
+        static void __for_each_child_n(_Node *_n, _Fn &_fn)
+        {
+            // slots are in insertion order, sort a local copy by byte
+            std::pair<std::uint8_t, __ptr> entries[sizeof(_n->keys)];
+            std::size_t n = 0;
+            std::uint8_t count = _n->count.load(std::memory_order_acquire);
+            for (std::uint8_t i = 0; i < count; i++)
+            {
+                __ptr child = _n->children[i].load(std::memory_order_acquire);
+                if (child)
+                    entries[n++] = {_n->keys[i], child};
+            }
+            std::sort(entries, entries + n, [](const auto &_a, const auto &_b)
+            {
+                return _a.first < _b.first;
+            });
+            for (std::size_t i = 0; i < n; i++)
+                _fn(entries[i].first, entries[i].second);
+        }
+
+        // == node modification (writer only) ==
+
+        static std::size_t __capacity(__type _type) noexcept
+        {
+            switch (_type)
+            {
+            case __type::node4:
+                return 4;
+            case __type::node16:
+                return 16;
+            case __type::node48:
+                return 48;
+            default:
+                return 256;
+            }
+        }
+
+        static __inner *__new_node(__type _type, __bytes_t _prefix)
+        {
+            switch (_type)
+            {
+            case __type::node4:
+                return new __node4(std::move(_prefix));
+            case __type::node16:
+                return new __node16(std::move(_prefix));
+            case __type::node48:
+                return new __node48(std::move(_prefix));
+            default:
+                return new __node256(std::move(_prefix));
+            }
+        }
+
+        /**
+         * @brief frees a single node without touching its children
+         */
+        static void __delete_node(void *_p)
+        {
+            __inner *n = static_cast<__inner *>(_p);
+            switch (n->type)
+            {
+            case __type::node4:
+                delete static_cast<__node4 *>(n);
+                break;
+            case __type::node16:
+                delete static_cast<__node16 *>(n);
+                break;
+            case __type::node48:
+                delete static_cast<__node48 *>(n);
+                break;
+            case __type::node256:
+                delete static_cast<__node256 *>(n);
+                break;
+            }
+        }
+
+        struct __node_deleter
+        {
+            void operator()(__inner *_n) const noexcept
+            {
+                __delete_node(_n);
+            }
+        };
+        // new node that is not linked into the tree yet
+        typedef std::unique_ptr<__inner, __node_deleter> __node_ptr;
+
+        static void __retire(__inner *_n)
+        {
+            epoch_manager::instance().retire(static_cast<void *>(_n), &__delete_node);
+        }
+        static void __retire(__leaf *_l)
+        {
+            epoch_manager::instance().retire(_l);
+        }
+
+        /**
+         * @brief tries to publish _child for _byte in a node. Reuses the slot already
+         * bound to the byte if there is one.
+         * @return bool false if the node is full and has to be replaced by a larger one
+         */
+        static bool __add_child(__inner *_n, std::uint8_t _byte, __ptr _child)
+        {
+            std::atomic<__ptr> *slot = __find_slot(_n, _byte);
+            if (slot == nullptr)
+            {
+                switch (_n->type)
+                {
+                case __type::node4:
+                    slot = __append_slot(static_cast<__node4 *>(_n), _byte);
+                    break;
+                case __type::node16:
+                    slot = __append_slot(static_cast<__node16 *>(_n), _byte);
+                    break;
+                case __type::node48:
+                {
+                    auto *n = static_cast<__node48 *>(_n);
+                    std::uint8_t count = n->count.load(std::memory_order_relaxed);
+                    if (count == 48)
+                        return false;
+                    n->children[count].store(_child, std::memory_order_relaxed);
+                    n->count.store(count + 1, std::memory_order_relaxed);
+                    n->index[_byte].store(count + 1, std::memory_order_release);
+                    _n->live++;
+                    return true;
+                }
+                case __type::node256:
+                    break;
+                }
+                if (slot == nullptr)
+                    return false;
+            }
+            if (slot->load(std::memory_order_relaxed) == 0)
+                _n->live++;
+            slot->store(_child, std::memory_order_release);
+            return true;
+        }
+
+        template <class _Node>
+        static std::atomic<__ptr> *__append_slot(_Node *_n, std::uint8_t _byte)
+        {
+            std::uint8_t count = _n->count.load(std::memory_order_relaxed);
+            if (count == sizeof(_n->keys))
+                return nullptr;
+            // the byte is written before the count publishes the slot
+            _n->keys[count] = _byte;
+            _n->count.store(count + 1, std::memory_order_release);
+            return &_n->children[count];
+        }
+
+        /**
+         * @brief creates a copy of _n with a different prefix and a node type large enough
+         * for its children plus _extra more, dropping slots of removed children.
+         */
+        static __inner *__rebuild(__inner *_n, __bytes_t _prefix, std::size_t _extra)
+        {
+            std::size_t needed = _n->live + _extra;
+            __type type = needed <= 4 ? __type::node4 : needed <= 16 ? __type::node16 : needed <= 48 ? __type::node48 : __type::node256;
+            // never shrink below the current size class to avoid flapping
+            if (type < _n->type && _extra > 0)
+                type = _n->type;
+            __inner *copy = __new_node(type, std::move(_prefix));
+            copy->terminal.store(_n->terminal.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            __for_each_child(_n, [&](std::uint8_t _b, __ptr _child)
+            {
+                __add_child(copy, _b, _child);
+            });
+            return copy;
+        }
+
+        static void __destroy(__ptr _p)
+        {
+            if (_p == 0)
+                return;
+            if (__is_leaf(_p))
+            {
+                delete __as_leaf(_p);
+                return;
+            }
+            __inner *n = __as_inner(_p);
+            if (__leaf *t = n->terminal.load(std::memory_order_relaxed))
+                delete t;
+            __for_each_child(n, [](std::uint8_t, __ptr _child)
+            {
+                __destroy(_child);
+            });
+            __delete_node(n);
+        }
+
+        // == writer operations ==
+
+        /**
+         * @brief inserts _leaf (or replaces the existing leaf if _assign is set).
+         * _leaf is released right when it gets linked into the tree, so it is still owned
+         * by the caller if anything throws before. __write_mutex has to be held.
+         * @return __leaf* the existing leaf if the key was already present (and not replaced),
+         * nullptr if _leaf was inserted
+         */
+        __leaf *__insert_locked(__view_t _key, std::unique_ptr<__leaf> &_leaf, bool _assign)
+        {
+            std::atomic<__ptr> *ref = &__root;
+            std::size_t depth = 0;
+            for (;;)
+            {
+                __ptr current = ref->load(std::memory_order_relaxed);
+                if (current == 0)
+                {
+                    ref->store(__tag(_leaf.release()), std::memory_order_release);
+                    return nullptr;
+                }
+
+                if (__is_leaf(current))
+                {
+                    __leaf *existing = __as_leaf(current);
+                    auto existing_encoded = _Traits::encode(existing->key);
+                    __view_t existing_key = __as_view(existing_encoded);
+                    if (existing_key == _key)
+                    {
+                        if (!_assign)
+                            return existing;
+                        ref->store(__tag(_leaf.release()), std::memory_order_release);
+                        __retire(existing);
+                        return nullptr;
+                    }
+
+                    // replace the leaf with a node branching where the keys differ
+                    std::size_t common = depth;
+                    while (common < _key.size() && common < existing_key.size() && _key[common] == existing_key[common])
+                        common++;
+                    __inner *node = __new_node(__type::node4, __bytes_t(_key.substr(depth, common - depth)));
+                    __place(node, existing_key, common, existing);
+                    __place(node, _key, common, _leaf.release());
+                    ref->store(__tag(node), std::memory_order_release);
+                    return nullptr;
+                }
+
+                __inner *node = __as_inner(current);
+                const __bytes_t &prefix = node->prefix;
+                std::size_t matched = 0;
+                while (matched < prefix.size() && depth + matched < _key.size() && prefix[matched] == _key[depth + matched])
+                    matched++;
+
+                if (matched < prefix.size())
+                {
+                    // the key leaves the compressed path: split it with a new parent node
+                    __node_ptr parent(__new_node(__type::node4, prefix.substr(0, matched)));
+                    __node_ptr shortened(__rebuild(node, prefix.substr(matched + 1), 0));
+                    __add_child(parent.get(), prefix[matched], __tag(shortened.release()));
+                    __place(parent.get(), _key, depth + matched, _leaf.release());
+                    ref->store(__tag(parent.release()), std::memory_order_release);
+                    __retire(node);
+                    return nullptr;
+                }
+
+                depth += prefix.size();
+                if (depth == _key.size())
+                {
+                    __leaf *existing = node->terminal.load(std::memory_order_relaxed);
+                    if (existing && !_assign)
+                        return existing;
+                    node->terminal.store(_leaf.release(), std::memory_order_release);
+                    if (existing)
+                        __retire(existing);
+                    return nullptr;
+                }
+
+                std::uint8_t byte = _key[depth];
+                std::atomic<__ptr> *slot = __find_slot(node, byte);
+                if (slot && slot->load(std::memory_order_relaxed) != 0)
+                {
+                    ref = slot;
+                    depth++;
+                    continue;
+                }
+
+                if (__add_child(node, byte, __tag(_leaf.get())))
+                {
+                    _leaf.release();
+                    return nullptr;
+                }
+                __inner *grown = __rebuild(node, node->prefix, 1);
+                __add_child(grown, byte, __tag(_leaf.release()));
+                ref->store(__tag(grown), std::memory_order_release);
+                __retire(node);
+                return nullptr;
+            }
+        }
+
+        /**
+         * @brief adds a leaf with key _key below a new (unpublished) node whose path ends at _depth
+         */
+        static void __place(__inner *_node, __view_t _key, std::size_t _depth, __leaf *_leaf)
+        {
+            if (_depth == _key.size())
+                _node->terminal.store(_leaf, std::memory_order_relaxed);
+            else
+                __add_child(_node, _key[_depth], __tag(_leaf));
+        }
+
+        /**
+         * @brief removes the key, removing nodes that become empty on the way back up.
+         * __write_mutex has to be held.
+         */
+        bool __erase_locked(__view_t _key)
+        {
+            // path of (slot referencing the node, node)
+            std::vector<std::pair<std::atomic<__ptr> *, __inner *>> path;
+
+            std::atomic<__ptr> *ref = &__root;
+            std::size_t depth = 0;
+            for (;;)
+            {
+                __ptr current = ref->load(std::memory_order_relaxed);
+                if (current == 0)
+                    return false;
+
+                if (__is_leaf(current))
+                {
+                    __leaf *existing = __as_leaf(current);
+                    auto existing_encoded = _Traits::encode(existing->key);
+                    if (__as_view(existing_encoded) != _key)
+                        return false;
+                    ref->store(0, std::memory_order_release);
+                    __retire(existing);
+                    if (!path.empty())
+                        path.back().second->live--;
+                    break;
+                }
+
+                __inner *node = __as_inner(current);
+                const __bytes_t &prefix = node->prefix;
+                if (_key.size() - depth < prefix.size() || _key.compare(depth, prefix.size(), prefix) != 0)
+                    return false;
+                depth += prefix.size();
+                path.emplace_back(ref, node);
+
+                if (depth == _key.size())
+                {
+                    __leaf *existing = node->terminal.load(std::memory_order_relaxed);
+                    if (existing == nullptr)
+                        return false;
+                    node->terminal.store(nullptr, std::memory_order_release);
+                    __retire(existing);
+                    break;
+                }
+
+                std::atomic<__ptr> *slot = __find_slot(node, _key[depth]);
+                if (slot == nullptr)
+                    return false;
+                ref = slot;
+                depth++;
+            }
+
+            // unlink nodes that have become empty, bottom up
+            while (!path.empty())
+            {
+                auto [node_ref, node] = path.back();
+                if (node->live > 0 || node->terminal.load(std::memory_order_relaxed) != nullptr)
+                    break;
+                node_ref->store(0, std::memory_order_release);
+                __retire(node);
+                path.pop_back();
+                if (!path.empty())
+                    path.back().second->live--;
+            }
+            return true;
+        }
+
+        // == reader operations (epoch guard has to be held) ==
+
+        __leaf *__find(__view_t _key) const
+        {
+            __ptr current = __root.load(std::memory_order_acquire);
+            std::size_t depth = 0;
+            while (current != 0)
+            {
+                if (__is_leaf(current))
+                {
+                    __leaf *leaf = __as_leaf(current);
+                    auto encoded = _Traits::encode(leaf->key);
+                    return __as_view(encoded) == _key ? leaf : nullptr;
+                }
+
+                __inner *node = __as_inner(current);
+                const __bytes_t &prefix = node->prefix;
+                if (_key.size() - depth < prefix.size() || _key.compare(depth, prefix.size(), prefix) != 0)
+                    return nullptr;
+                depth += prefix.size();
+
+                if (depth == _key.size())
+                    return node->terminal.load(std::memory_order_acquire);
+
+                std::atomic<__ptr> *slot = __find_slot(node, _key[depth]);
+                if (slot == nullptr)
+                    return nullptr;
+                current = slot->load(std::memory_order_acquire);
+                depth++;
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief visits all leaves below _p in key order until _fn returns false
+         * @return bool false if the visit was stopped
+         */
+        template <class _Fn>
+        static bool __visit(__ptr _p, _Fn &_fn)
+        {
+            if (__is_leaf(_p))
+            {
+                __leaf *leaf = __as_leaf(_p);
+                return _fn(leaf->key, leaf->value);
+            }
+
+            __inner *node = __as_inner(_p);
+            if (__leaf *t = node->terminal.load(std::memory_order_acquire))
+                if (!_fn(t->key, t->value))
+                    return false;
+
+            bool proceed = true;
+            __for_each_child(node, [&](std::uint8_t, __ptr _child)
+            {
+                if (proceed)
+                    proceed = __visit(_child, _fn);
+            });
+            return proceed;
+        }
+
+        template <class _Fn>
+        static auto __continuing(_Fn &_fn)
+        {
+            return [&](const _K &_k, const _V &_v)
+            {
+                if constexpr (std::is_same_v<decltype(_fn(_k, _v)), bool>)
+                    return _fn(_k, _v);
+                else
+                {
+                    _fn(_k, _v);
+                    return true;
+                }
+            };
+        }
+
+    public:
+        art_map() = default;
+
+        // the map is shared between threads by reference, so copying it makes no sense
+        art_map(const art_map &) = delete;
+        art_map &operator=(const art_map &) = delete;
+
+        ~art_map()
+        {
+            __destroy(__root.load(std::memory_order_relaxed));
+        }
+
+        /**
+         * @brief inserts _value for _key if the key is not present yet.
+         * @return bool true if the element was inserted
+         */
+        bool insert(const _K &_key, const _V &_value)
+        {
+            // owned until linked, so it is freed if encoding or inserting throws
+            std::unique_ptr<__leaf> leaf(new __leaf{_key, _value});
+            auto encoded = _Traits::encode(leaf->key);
+            std::lock_guard lock(__write_mutex);
+            if (__insert_locked(__as_view(encoded), leaf, false) != nullptr)
+                return false;
+            __size.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /**
+         * @brief inserts _value for _key or replaces the existing value.
+         * @return bool true if the element was inserted, false if it was assigned
+         */
+        bool insert_or_assign(const _K &_key, const _V &_value)
+        {
+            std::unique_ptr<__leaf> leaf(new __leaf{_key, _value});
+            auto encoded = _Traits::encode(leaf->key);
+            std::lock_guard lock(__write_mutex);
+            bool existed = __find(__as_view(encoded)) != nullptr;
+            __insert_locked(__as_view(encoded), leaf, true);
+            if (!existed)
+                __size.fetch_add(1, std::memory_order_relaxed);
+            return !existed;
+        }
+
+        /**
+         * @return size_type number of elements removed (0 or 1)
+         */
+        size_type erase(const _K &_key)
+        {
+            auto encoded = _Traits::encode(_key);
+            std::lock_guard lock(__write_mutex);
+            if (!__erase_locked(__as_view(encoded)))
+                return 0;
+            __size.fetch_sub(1, std::memory_order_relaxed);
+            return 1;
+        }
+
+        /**
+         * @return std::optional<_V> copy of the value mapped to _key, empty if there is none
+         */
+        std::optional<_V> find(const _K &_key) const
+        {
+            auto encoded = _Traits::encode(_key);
+            epoch_guard guard;
+            if (__leaf *leaf = __find(__as_view(encoded)))
+                return leaf->value;
+            return std::nullopt;
+        }
+
+        bool contains(const _K &_key) const
+        {
+            auto encoded = _Traits::encode(_key);
+            epoch_guard guard;
+            return __find(__as_view(encoded)) != nullptr;
+        }
+        size_type count(const _K &_key) const
+        {
+            return contains(_key) ? 1 : 0;
+        }
+
+        size_type size() const noexcept
+        {
+            return __size.load(std::memory_order_relaxed);
+        }
+        bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        /**
+         * @brief calls _fn(key, value) for every element in key order. If _fn returns
+         * bool, returning false stops the iteration. Elements inserted or removed
+         * concurrently may or may not be visited.
+         */
+        template <class _Fn>
+        void for_each(_Fn _fn) const
+        {
+            epoch_guard guard;
+            __ptr root = __root.load(std::memory_order_acquire);
+            auto visitor = __continuing(_fn);
+            if (root != 0)
+                __visit(root, visitor);
+        }
+
+        /**
+         * @brief calls _fn(key, value) for every element whose encoded key starts with the
+         * encoded _prefix (for std::string keys: every key starting with _prefix), in key order.
+         * Only the subtree below the prefix is visited. If _fn returns bool, returning false
+         * stops the scan.
+         */
+        template <class _Fn>
+        void scan_prefix(const _K &_prefix, _Fn _fn) const
+        {
+            auto encoded = _Traits::encode(_prefix);
+            __view_t key = __as_view(encoded);
+            auto visitor = __continuing(_fn);
+
+            epoch_guard guard;
+            __ptr current = __root.load(std::memory_order_acquire);
+            std::size_t depth = 0;
+            while (current != 0)
+            {
+                if (__is_leaf(current))
+                {
+                    __leaf *leaf = __as_leaf(current);
+                    auto leaf_encoded = _Traits::encode(leaf->key);
+                    __view_t leaf_key = __as_view(leaf_encoded);
+                    if (leaf_key.substr(0, key.size()) == key)
+                        visitor(leaf->key, leaf->value);
+                    return;
+                }
+
+                __inner *node = __as_inner(current);
+                const __bytes_t &prefix = node->prefix;
+                std::size_t remaining = key.size() - depth;
+                std::size_t compared = std::min(remaining, prefix.size());
+                if (key.compare(depth, compared, prefix, 0, compared) != 0)
+                    return;
+                if (remaining <= prefix.size())
+                {
+                    // the whole subtree matches
+                    __visit(current, visitor);
+                    return;
+                }
+                depth += prefix.size();
+
+                std::atomic<__ptr> *slot = __find_slot(node, key[depth]);
+                if (slot == nullptr)
+                    return;
+                current = slot->load(std::memory_order_acquire);
+                depth++;
+            }
+        }
+    };
+};
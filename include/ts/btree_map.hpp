@@ -0,0 +1,943 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 12:15
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Concurrent ordered map implemented as a B+tree with optimistic lock coupling.
+
+Based on the OLC B+tree described in:
+V. Leis, M. Haubenschild, T. Neumann: "Optimistic Lock Coupling: A Scalable and
+Efficient General-Purpose Synchronization Method" (IEEE Data Eng. Bull. 2019)
+*/
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <functional>
+#include <type_traits>
+
+namespace ts
+{
+    namespace __detail
+    {
+        /**
+         * @brief largest unsigned integer type whose size divides sizeof(_T)
+         */
+        template <class _T>
+        using __olc_word = std::conditional_t<sizeof(_T) % 8 == 0, std::uint64_t,
+            std::conditional_t<sizeof(_T) % 4 == 0, std::uint32_t,
+            std::conditional_t<sizeof(_T) % 2 == 0, std::uint16_t, std::uint8_t>>>;
+
+        /**
+         * @brief storage of a key, value or child pointer in a btree_map node.
+         * Trivially copyable types are stored as an array of atomic words that are accessed
+         * with relaxed ordering, so optimistic readers can copy them while a writer modifies
+         * them without a data race (the node's version check then decides whether the copy
+         * is used). Other types are stored as they are and may only be accessed while the
+         * node is write locked.
+         */
+        template <class _T, bool = std::is_trivially_copyable_v<_T>>
+        class __olc_slot
+        {
+        private:
+            typedef __olc_word<_T> __word;
+            static constexpr std::size_t __words = sizeof(_T) / sizeof(__word);
+
+            std::atomic<__word> __data[__words];
+
+        public:
+            static constexpr bool optimistic = true;
+
+            __olc_slot()
+            {
+                store(_T());
+            }
+
+            _T load() const noexcept
+            {
+                __word buffer[__words];
+                for (std::size_t i = 0; i < __words; i++)
+                    buffer[i] = __data[i].load(std::memory_order_relaxed);
+                _T value;
+                std::memcpy(static_cast<void *>(&value), buffer, sizeof(_T));
+                return value;
+            }
+
+            void store(const _T &_value) noexcept
+            {
+                __word buffer[__words];
+                std::memcpy(buffer, static_cast<const void *>(&_value), sizeof(_T));
+                for (std::size_t i = 0; i < __words; i++)
+                    __data[i].store(buffer[i], std::memory_order_relaxed);
+            }
+
+            void move_from(__olc_slot &_other) noexcept
+            {
+                store(_other.load());
+            }
+
+            void reset() noexcept
+            {
+            }
+        };
+
+        template <class _T>
+        class __olc_slot<_T, false>
+        {
+        private:
+            _T __value;
+
+        public:
+            static constexpr bool optimistic = false;
+
+            _T load() const
+            {
+                return __value;
+            }
+
+            void store(const _T &_value)
+            {
+                __value = _value;
+            }
+
+            void store(_T &&_value) noexcept
+            {
+                __value = std::move(_value);
+            }
+
+            void move_from(__olc_slot &_other) noexcept
+            {
+                __value = std::move(_other.__value);
+            }
+
+            // releases the resources of a slot that is no longer in use
+            void reset() noexcept
+            {
+                __value = _T();
+            }
+        };
+    };
+
+    /**
+     * @brief concurrent ordered map implemented as an in-memory B+tree with
+     * optimistic lock coupling (OLC). Every node carries a version counter with a lock bit.
+     * Readers never write to shared memory: they read a node's version, read the node and
+     * validate that the version has not changed (restarting the operation if it has).
+     * Writers only lock the leaf they modify (and the nodes involved in a split), so writers
+     * working on different subtrees don't block each other, and readers are never blocked.
+     * The wide nodes (4 KiB by default) also make lookups much more cache friendly than
+     * the red-black tree of std::map.
+     *
+     * Since readers may observe keys while they are being modified (and then discard what
+     * they read), keys have to be trivially copyable. They, the child pointers and trivially
+     * copyable values are stored as relaxed atomic words, so these racy reads are well
+     * defined. Values that are not trivially copyable can't be copied optimistically, lookups
+     * and scans briefly write lock the leaf to copy them instead. Nothing may throw while a
+     * node is write locked, so such values are copied before locking and have to be nothrow
+     * move assignable and nothrow default constructible. Keys and values have to be
+     * default constructible, as nodes store them in fixed size arrays, and lookups
+     * return copies instead of references or iterators.
+     * Nodes are never merged or freed while the map exists (erasing does not rebalance),
+     * which is what makes optimistic reads of stale nodes safe without a memory
+     * reclamation scheme.
+     *
+     * @tparam _K key type (trivially copyable)
+     * @tparam _V mapped type (copyable, trivially copyable types are read without locking)
+     * @tparam _Compare key comparator (same semantics as for std::map)
+     * @tparam _NodeBytes approximate size of a tree node in bytes
+     */
+    template <class _K, class _V, class _Compare = std::less<_K>, std::size_t _NodeBytes = 4096>
+    class btree_map
+    {
+        static_assert(std::is_trivially_copyable_v<_K>,
+            "ts-stl/btree_map requires trivially copyable keys because optimistic readers may copy them while they are being modified");
+        static_assert(std::is_default_constructible_v<_K> && std::is_default_constructible_v<_V>,
+            "ts-stl/btree_map requires default constructible keys and values because nodes store them in fixed size arrays");
+        static_assert(std::is_trivially_copyable_v<_V> || (std::is_nothrow_move_assignable_v<_V> && std::is_nothrow_default_constructible_v<_V>),
+            "ts-stl/btree_map requires values that are trivially copyable or nothrow move assignable and default constructible, because they are moved while nodes are locked");
+
+    public:
+        typedef _K key_type;
+        typedef _V mapped_type;
+        typedef std::pair<_K, _V> value_type;
+        typedef _Compare key_compare;
+        typedef std::size_t size_type;
+
+    private:
+        // version layout: bit 1 = locked, bits 2.. = modification counter
+        static constexpr std::uint64_t __lock_bit = 0b10;
+
+        struct __node
+        {
+            std::atomic<std::uint64_t> version{0b100};
+            std::atomic<std::uint16_t> count{0};
+            const bool leaf;
+
+            explicit __node(bool _leaf)
+                : leaf(_leaf)
+            {
+            }
+        };
+
+        static constexpr std::size_t __header_bytes = sizeof(__node) + sizeof(void *);
+        static constexpr std::size_t __leaf_capacity =
+            (_NodeBytes - __header_bytes) / (sizeof(_K) + sizeof(_V)) < 4 ? 4 : (_NodeBytes - __header_bytes) / (sizeof(_K) + sizeof(_V));
+        static constexpr std::size_t __inner_capacity =
+            (_NodeBytes - __header_bytes) / (sizeof(_K) + sizeof(void *)) < 4 ? 4 : (_NodeBytes - __header_bytes) / (sizeof(_K) + sizeof(void *));
+
+        static_assert(__leaf_capacity <= UINT16_MAX && __inner_capacity <= UINT16_MAX,
+            "ts-stl/btree_map node size too large for the 16 bit element counters");
+
+        typedef __detail::__olc_slot<_K> __key_slot;
+        typedef __detail::__olc_slot<_V> __value_slot;
+        typedef __detail::__olc_slot<__node *> __child_slot;
+
+        // values that are not trivially copyable are only read with the leaf locked
+        static constexpr bool __optimistic_values = __value_slot::optimistic;
+
+        struct __leaf : __node
+        {
+            std::atomic<__leaf *> next{nullptr};
+            __key_slot keys[__leaf_capacity];
+            __value_slot values[__leaf_capacity];
+
+            __leaf()
+                : __node(true)
+            {
+            }
+        };
+
+        struct __inner : __node
+        {
+            // child i holds the keys in (keys[i - 1], keys[i]]
+            __key_slot keys[__inner_capacity];
+            __child_slot children[__inner_capacity + 1];
+
+            __inner()
+                : __node(false)
+            {
+            }
+        };
+
+        std::atomic<__node *> __root;
+        _Compare __comp;
+
+        static void __pause() noexcept
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#else
+            std::this_thread::yield();
+#endif
+        }
+
+        // == optimistic lock primitives ==
+        // _restart is set whenever the operation has to be restarted from the root
+
+        static std::uint64_t __read_lock(const __node *_n, bool &_restart) noexcept
+        {
+            std::uint64_t v = _n->version.load(std::memory_order_acquire);
+            if (v & __lock_bit)
+            {
+                __pause();
+                _restart = true;
+            }
+            return v;
+        }
+
+        static void __validate(const __node *_n, std::uint64_t _v, bool &_restart) noexcept
+        {
+            // keep the (racy) node reads above from being reordered past the validation
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_n->version.load(std::memory_order_relaxed) != _v)
+                _restart = true;
+        }
+
+        static void __upgrade(__node *_n, std::uint64_t _v, bool &_restart) noexcept
+        {
+            if (!_n->version.compare_exchange_strong(_v, _v + __lock_bit, std::memory_order_acquire))
+            {
+                __pause();
+                _restart = true;
+                return;
+            }
+            // readers that see any of the following stores also see the locked version
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        static void __write_unlock(__node *_n) noexcept
+        {
+            _n->version.fetch_add(__lock_bit, std::memory_order_release);
+        }
+
+        // == node helpers ==
+
+        static std::size_t __count(const __node *_n, std::size_t _capacity) noexcept
+        {
+            // an optimistic reader may see a count that is being changed, never exceed the arrays
+            std::size_t c = _n->count.load(std::memory_order_relaxed);
+            return c > _capacity ? _capacity : c;
+        }
+
+        std::size_t __lower_bound(const __key_slot *_keys, std::size_t _count, const _K &_key) const
+        {
+            std::size_t lo = 0, hi = _count;
+            while (lo < hi)
+            {
+                std::size_t mid = (lo + hi) / 2;
+                if (__comp(_keys[mid].load(), _key))
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo;
+        }
+
+        bool __equal(const _K &_a, const _K &_b) const
+        {
+            return !__comp(_a, _b) && !__comp(_b, _a);
+        }
+
+        /**
+         * @brief moves _n slots from _src to _dst (of a write locked node), the ranges may overlap
+         */
+        template <class _Slot>
+        static void __move_slots(_Slot *_dst, _Slot *_src, std::size_t _n)
+        {
+            if (_dst < _src)
+                for (std::size_t i = 0; i < _n; i++)
+                    _dst[i].move_from(_src[i]);
+            else
+                for (std::size_t i = _n; i > 0; i--)
+                    _dst[i - 1].move_from(_src[i - 1]);
+        }
+
+        /**
+         * @brief moves the upper half of a full leaf into the empty new right sibling _right.
+         * The leaf has to be write locked, the new sibling is not visible until it is
+         * inserted into the parent. _separator receives the largest key remaining in the leaf.
+         */
+        static void __split(__leaf *_l, __leaf *_right, _K &_separator) noexcept
+        {
+            std::size_t count = _l->count.load(std::memory_order_relaxed);
+            std::size_t moved = count - count / 2;
+            std::size_t kept = count - moved;
+            __move_slots(_right->keys, _l->keys + kept, moved);
+            __move_slots(_right->values, _l->values + kept, moved);
+            for (std::size_t i = kept; i < count; i++)
+                _l->values[i].reset();
+            _right->count.store(static_cast<std::uint16_t>(moved), std::memory_order_relaxed);
+            _right->next.store(_l->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            // published with release so size() can follow the chain without validating
+            _l->next.store(_right, std::memory_order_release);
+            _l->count.store(static_cast<std::uint16_t>(kept), std::memory_order_relaxed);
+            _separator = _l->keys[kept - 1].load();
+        }
+
+        static void __split(__inner *_n, __inner *_right, _K &_separator) noexcept
+        {
+            std::size_t count = _n->count.load(std::memory_order_relaxed);
+            std::size_t moved = count - count / 2;
+            std::size_t kept = count - moved - 1;
+            _separator = _n->keys[kept].load();
+            __move_slots(_right->keys, _n->keys + kept + 1, moved);
+            __move_slots(_right->children, _n->children + kept + 1, moved + 1);
+            _right->count.store(static_cast<std::uint16_t>(moved), std::memory_order_relaxed);
+            _n->count.store(static_cast<std::uint16_t>(kept), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief inserts separator _key with the new right child _child (created by
+         * splitting the child left of it) into a write locked inner node that is not full.
+         */
+        void __insert_child(__inner *_n, const _K &_key, __node *_child)
+        {
+            std::size_t count = _n->count.load(std::memory_order_relaxed);
+            std::size_t pos = __lower_bound(_n->keys, count, _key);
+            __move_slots(_n->keys + pos + 1, _n->keys + pos, count - pos);
+            __move_slots(_n->children + pos + 2, _n->children + pos + 1, count - pos);
+            _n->keys[pos].store(_key);
+            _n->children[pos + 1].store(_child);
+            _n->count.store(static_cast<std::uint16_t>(count + 1), std::memory_order_relaxed);
+        }
+
+        void __make_root(__inner *_root, const _K &_separator, __node *_left, __node *_right) noexcept
+        {
+            _root->keys[0].store(_separator);
+            _root->children[0].store(_left);
+            _root->children[1].store(_right);
+            _root->count.store(1, std::memory_order_relaxed);
+            __root.store(_root, std::memory_order_release);
+        }
+
+        /**
+         * @brief splits the write locked full node _n into the new node _right (of the same
+         * kind). _parent is write locked too, or null if _n is the root, in which case _root
+         * becomes the new root. Both are unlocked afterwards. The new nodes are allocated by
+         * the caller before locking, so no allocation can throw while the nodes are locked.
+         */
+        void __split_and_unlock(__node *_n, __inner *_parent, __node *_right, __inner *_root)
+        {
+            _K separator;
+            if (_n->leaf)
+                __split(static_cast<__leaf *>(_n), static_cast<__leaf *>(_right), separator);
+            else
+                __split(static_cast<__inner *>(_n), static_cast<__inner *>(_right), separator);
+
+            if (_parent)
+                __insert_child(_parent, separator, _right);
+            else
+                __make_root(_root, separator, _n, _right);
+
+            __write_unlock(_n);
+            if (_parent)
+                __write_unlock(_parent);
+        }
+
+        /**
+         * @brief optimistically descends to the leaf responsible for _key.
+         * On success, _parent/_parent_version describe the leaf's parent (null for a
+         * root leaf) and the leaf's read version is returned. Full nodes encountered
+         * on the way are split if _split_full is set, which restarts the descent.
+         */
+        __leaf *__descend(const _K &_key, bool _split_full, std::uint64_t &_version, __inner *&_parent, std::uint64_t &_parent_version, bool &_restart)
+        {
+            __node *node = __root.load(std::memory_order_acquire);
+            _version = __read_lock(node, _restart);
+            if (_restart || node != __root.load(std::memory_order_acquire))
+            {
+                _restart = true;
+                return nullptr;
+            }
+
+            _parent = nullptr;
+            while (!node->leaf)
+            {
+                __inner *inner = static_cast<__inner *>(node);
+
+                if (_split_full && __count(inner, __inner_capacity) == __inner_capacity)
+                {
+                    // split full inner nodes eagerly so a split never has to propagate upwards
+                    std::unique_ptr<__inner> right(new __inner());
+                    std::unique_ptr<__inner> root(_parent ? nullptr : new __inner());
+                    if (_parent)
+                    {
+                        __upgrade(_parent, _parent_version, _restart);
+                        if (_restart)
+                            return nullptr;
+                    }
+                    __upgrade(inner, _version, _restart);
+                    if (_restart)
+                    {
+                        if (_parent)
+                            __write_unlock(_parent);
+                        return nullptr;
+                    }
+                    if (!_parent && node != __root.load(std::memory_order_acquire))
+                    {
+                        // another thread has grown the tree in the meantime
+                        __write_unlock(inner);
+                        _restart = true;
+                        return nullptr;
+                    }
+                    __split_and_unlock(inner, _parent, right.release(), root.release());
+                    _restart = true;
+                    return nullptr;
+                }
+
+                if (_parent)
+                {
+                    __validate(_parent, _parent_version, _restart);
+                    if (_restart)
+                        return nullptr;
+                }
+
+                __node *child = inner->children[__lower_bound(inner->keys, __count(inner, __inner_capacity), _key)].load();
+                __validate(inner, _version, _restart);
+                if (_restart)
+                    return nullptr;
+
+                _parent = inner;
+                _parent_version = _version;
+                node = child;
+                _version = __read_lock(node, _restart);
+                if (_restart)
+                    return nullptr;
+            }
+            return static_cast<__leaf *>(node);
+        }
+
+        /**
+         * @brief _value is moved into the leaf once the insertion can't fail anymore, so
+         * nothing is copied while the leaf is locked
+         */
+        template <bool _assign>
+        bool __try_insert(const _K &_key, _V &_value, bool &_inserted)
+        {
+            bool restart = false;
+            std::uint64_t version, parent_version = 0;
+            __inner *parent;
+            __leaf *leaf = __descend(_key, true, version, parent, parent_version, restart);
+            if (restart)
+                return false;
+
+            if (__count(leaf, __leaf_capacity) == __leaf_capacity)
+            {
+                std::unique_ptr<__leaf> right(new __leaf());
+                std::unique_ptr<__inner> root(parent ? nullptr : new __inner());
+                if (parent)
+                {
+                    __upgrade(parent, parent_version, restart);
+                    if (restart)
+                        return false;
+                }
+                __upgrade(leaf, version, restart);
+                if (restart)
+                {
+                    if (parent)
+                        __write_unlock(parent);
+                    return false;
+                }
+                if (!parent && leaf != __root.load(std::memory_order_acquire))
+                {
+                    __write_unlock(leaf);
+                    return false;
+                }
+                __split_and_unlock(leaf, parent, right.release(), root.release());
+                return false;
+            }
+
+            __upgrade(leaf, version, restart);
+            if (restart)
+                return false;
+            if (parent)
+            {
+                // make sure the leaf is still responsible for the key
+                __validate(parent, parent_version, restart);
+                if (restart)
+                {
+                    __write_unlock(leaf);
+                    return false;
+                }
+            }
+
+            std::size_t count = leaf->count.load(std::memory_order_relaxed);
+            std::size_t pos = __lower_bound(leaf->keys, count, _key);
+            if (pos < count && __equal(leaf->keys[pos].load(), _key))
+            {
+                if constexpr (_assign)
+                    leaf->values[pos].store(std::move(_value));
+                _inserted = false;
+            }
+            else
+            {
+                __move_slots(leaf->keys + pos + 1, leaf->keys + pos, count - pos);
+                __move_slots(leaf->values + pos + 1, leaf->values + pos, count - pos);
+                leaf->keys[pos].store(_key);
+                leaf->values[pos].store(std::move(_value));
+                leaf->count.store(static_cast<std::uint16_t>(count + 1), std::memory_order_relaxed);
+                _inserted = true;
+            }
+            __write_unlock(leaf);
+            return true;
+        }
+
+        bool __try_erase(const _K &_key, size_type &_erased)
+        {
+            bool restart = false;
+            std::uint64_t version, parent_version = 0;
+            __inner *parent;
+            __leaf *leaf = __descend(_key, false, version, parent, parent_version, restart);
+            if (restart)
+                return false;
+
+            __upgrade(leaf, version, restart);
+            if (restart)
+                return false;
+            if (parent)
+            {
+                __validate(parent, parent_version, restart);
+                if (restart)
+                {
+                    __write_unlock(leaf);
+                    return false;
+                }
+            }
+
+            std::size_t count = leaf->count.load(std::memory_order_relaxed);
+            std::size_t pos = __lower_bound(leaf->keys, count, _key);
+            _erased = 0;
+            if (pos < count && __equal(leaf->keys[pos].load(), _key))
+            {
+                __move_slots(leaf->keys + pos, leaf->keys + pos + 1, count - pos - 1);
+                __move_slots(leaf->values + pos, leaf->values + pos + 1, count - pos - 1);
+                leaf->values[count - 1].reset();
+                leaf->count.store(static_cast<std::uint16_t>(count - 1), std::memory_order_relaxed);
+                _erased = 1;
+            }
+            __write_unlock(leaf);
+            return true;
+        }
+
+        bool __try_find(const _K &_key, std::optional<_V> &_result)
+        {
+            bool restart = false;
+            std::uint64_t version, parent_version = 0;
+            __inner *parent;
+            __leaf *leaf = __descend(_key, false, version, parent, parent_version, restart);
+            if (restart)
+                return false;
+
+            if constexpr (!__optimistic_values)
+            {
+                // the value can't be copied optimistically, copy it with the leaf locked
+                __upgrade(leaf, version, restart);
+                if (restart)
+                    return false;
+                try
+                {
+                    if (parent)
+                        __validate(parent, parent_version, restart);
+                    if (!restart)
+                    {
+                        std::size_t count = leaf->count.load(std::memory_order_relaxed);
+                        std::size_t pos = __lower_bound(leaf->keys, count, _key);
+                        if (pos < count && __equal(leaf->keys[pos].load(), _key))
+                            _result = leaf->values[pos].load();
+                        else
+                            _result.reset();
+                    }
+                }
+                catch (...)
+                {
+                    __write_unlock(leaf);
+                    throw;
+                }
+                __write_unlock(leaf);
+                return !restart;
+            }
+
+            std::size_t count = __count(leaf, __leaf_capacity);
+            std::size_t pos = __lower_bound(leaf->keys, count, _key);
+            bool found = pos < count && __equal(leaf->keys[pos].load(), _key);
+            _V value;
+            if (found)
+                value = leaf->values[pos].load();
+
+            if (parent)
+            {
+                __validate(parent, parent_version, restart);
+                if (restart)
+                    return false;
+            }
+            __validate(leaf, version, restart);
+            if (restart)
+                return false;
+
+            if (found)
+                _result = value;
+            else
+                _result.reset();
+            return true;
+        }
+
+        /**
+         * @brief copies the elements of _leaf with keys >= _from (and > _last if _after_last
+         * is set) to _buffer.
+         * @return std::size_t number of copied elements
+         */
+        std::size_t __copy_leaf(const __leaf *_leaf, std::pair<_K, _V> *_buffer, const _K &_from, bool _after_last, const _K &_last) const
+        {
+            std::size_t count = __count(_leaf, __leaf_capacity);
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < count; i++)
+            {
+                _K key = _leaf->keys[i].load();
+                if (__comp(key, _from) || (_after_last && !__comp(_last, key)))
+                    continue;
+                _buffer[n++] = {key, _leaf->values[i].load()};
+            }
+            return n;
+        }
+
+        /**
+         * @brief calls _fn(key, value) for the elements with keys >= _from in key order
+         * until _fn returns false. Each leaf is copied and validated (or copied while locked,
+         * if the values can't be copied optimistically) before its elements are passed on.
+         * Keys only ever move to right siblings during splits, so the leaf chain
+         * can be followed without restarting from the root.
+         */
+        template <class _Fn>
+        void __scan(const _K &_from, _Fn &&_fn)
+        {
+            __leaf *leaf;
+            std::uint64_t version;
+            for (;;)
+            {
+                bool restart = false;
+                std::uint64_t parent_version = 0;
+                __inner *parent;
+                leaf = __descend(_from, false, version, parent, parent_version, restart);
+                if (!restart && parent)
+                    __validate(parent, parent_version, restart);
+                if (!restart)
+                    break;
+            }
+
+            std::pair<_K, _V> buffer[__leaf_capacity];
+            bool emitted_any = false;
+            _K last{};
+            for (;;)
+            {
+                std::size_t n = 0;
+                __leaf *next = nullptr;
+                bool restart = false;
+                if constexpr (__optimistic_values)
+                {
+                    n = __copy_leaf(leaf, buffer, _from, emitted_any, last);
+                    next = leaf->next.load(std::memory_order_relaxed);
+                    __validate(leaf, version, restart);
+                }
+                else
+                {
+                    __upgrade(leaf, version, restart);
+                    if (!restart)
+                    {
+                        try
+                        {
+                            n = __copy_leaf(leaf, buffer, _from, emitted_any, last);
+                        }
+                        catch (...)
+                        {
+                            __write_unlock(leaf);
+                            throw;
+                        }
+                        next = leaf->next.load(std::memory_order_relaxed);
+                        __write_unlock(leaf);
+                    }
+                }
+                if (restart)
+                {
+                    // re-read the same leaf, anything moved out of it is reachable through next
+                    do
+                    {
+                        restart = false;
+                        version = __read_lock(leaf, restart);
+                    } while (restart);
+                    continue;
+                }
+
+                for (std::size_t i = 0; i < n; i++)
+                {
+                    if (!_fn(buffer[i].first, buffer[i].second))
+                        return;
+                    last = buffer[i].first;
+                    emitted_any = true;
+                }
+
+                if (next == nullptr)
+                    return;
+                leaf = next;
+                bool locked;
+                do
+                {
+                    locked = false;
+                    version = __read_lock(leaf, locked);
+                } while (locked);
+            }
+        }
+
+        static void __destroy(__node *_n)
+        {
+            if (_n->leaf)
+            {
+                delete static_cast<__leaf *>(_n);
+                return;
+            }
+            __inner *inner = static_cast<__inner *>(_n);
+            std::size_t count = inner->count.load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i <= count; i++)
+                __destroy(inner->children[i].load());
+            delete inner;
+        }
+
+    public:
+        btree_map()
+            : __root(new __leaf())
+        {
+        }
+
+        explicit btree_map(const _Compare &_comp)
+            : __root(new __leaf()),
+            __comp(_comp)
+        {
+        }
+
+        // the map is shared between threads by reference, so copying it makes no sense
+        btree_map(const btree_map &) = delete;
+        btree_map &operator=(const btree_map &) = delete;
+
+        ~btree_map()
+        {
+            __destroy(__root.load(std::memory_order_relaxed));
+        }
+
+        /**
+         * @brief inserts _value for _key if the key is not present yet.
+         * @return bool true if the element was inserted
+         */
+        bool insert(const _K &_key, const _V &_value)
+        {
+            _V value(_value);
+            bool inserted = false;
+            while (!__try_insert<false>(_key, value, inserted))
+                ;
+            return inserted;
+        }
+
+        bool insert(const value_type &_element)
+        {
+            return insert(_element.first, _element.second);
+        }
+
+        /**
+         * @brief inserts _value for _key or overwrites the existing value.
+         * @return bool true if the element was inserted, false if it was assigned
+         */
+        bool insert_or_assign(const _K &_key, const _V &_value)
+        {
+            _V value(_value);
+            bool inserted = false;
+            while (!__try_insert<true>(_key, value, inserted))
+                ;
+            return inserted;
+        }
+
+        /**
+         * @brief removes _key from the map. Leaves are not merged when they become
+         * sparse, the tree keeps its shape until it is destroyed.
+         * @return size_type number of elements removed (0 or 1)
+         */
+        size_type erase(const _K &_key)
+        {
+            size_type erased = 0;
+            while (!__try_erase(_key, erased))
+                ;
+            return erased;
+        }
+
+        /**
+         * @return std::optional<_V> copy of the value mapped to _key, empty if there is none
+         */
+        std::optional<_V> find(const _K &_key)
+        {
+            std::optional<_V> result;
+            while (!__try_find(_key, result))
+                ;
+            return result;
+        }
+
+        bool contains(const _K &_key)
+        {
+            return find(_key).has_value();
+        }
+        size_type count(const _K &_key)
+        {
+            return contains(_key) ? 1 : 0;
+        }
+
+        /**
+         * @return std::optional<value_type> copy of the first element whose key is not
+         * less than _key, empty if there is none
+         */
+        std::optional<value_type> lower_bound(const _K &_key)
+        {
+            std::optional<value_type> result;
+            __scan(_key, [&](const _K &_k, const _V &_v)
+            {
+                result.emplace(_k, _v);
+                return false;
+            });
+            return result;
+        }
+
+        /**
+         * @brief calls _fn(key, value) for every element with _from <= key < _to in key order.
+         * Each leaf is read consistently, but the scan as a whole is not a snapshot:
+         * concurrent modifications of leaves that have not been reached yet are visible.
+         */
+        template <class _Fn>
+        void range(const _K &_from, const _K &_to, _Fn _fn)
+        {
+            __scan(_from, [&](const _K &_k, const _V &_v)
+            {
+                if (!__comp(_k, _to))
+                    return false;
+                _fn(_k, _v);
+                return true;
+            });
+        }
+
+        /**
+         * @brief calls _fn(key, value) for the elements with keys >= _from in key order
+         * until _fn returns false, with the same consistency guarantees as range().
+         */
+        template <class _Fn>
+        void scan(const _K &_from, _Fn _fn)
+        {
+            __scan(_from, _fn);
+        }
+
+        /**
+         * @brief counts the elements by walking all leaves (linear time).
+         * Under concurrent modification the result is only approximate.
+         */
+        size_type size()
+        {
+            __node *node;
+            for (;;)
+            {
+                bool restart = false;
+                node = __root.load(std::memory_order_acquire);
+                std::uint64_t version = __read_lock(node, restart);
+                if (restart)
+                    continue;
+                while (!node->leaf)
+                {
+                    __node *child = static_cast<__inner *>(node)->children[0].load();
+                    __validate(node, version, restart);
+                    if (restart)
+                        break;
+                    node = child;
+                    version = __read_lock(node, restart);
+                    if (restart)
+                        break;
+                }
+                if (!restart)
+                    break;
+            }
+
+            size_type total = 0;
+            for (__leaf *leaf = static_cast<__leaf *>(node); leaf != nullptr; leaf = leaf->next.load(std::memory_order_acquire))
+                total += __count(leaf, __leaf_capacity);
+            return total;
+        }
+
+        bool empty()
+        {
+            return size() == 0;
+        }
+    };
+};
@@ -0,0 +1,373 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 19:20
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+NUMA aware cohort lock keeping lock ownership on one socket.
+*/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "mcs_lock.hpp"
+
+namespace ts
+{
+    namespace __detail
+    {
+        /**
+         * @brief node the calling thread was assigned to with cohort_lock::set_thread_node(), -1 if none
+         */
+        inline int &__thread_numa_node() noexcept
+        {
+            thread_local int node = -1;
+            return node;
+        }
+
+        /**
+         * @brief NUMA nodes of the machine and the node every CPU belongs to, read once from
+         * /sys on Linux. Everywhere else (or if /sys is unavailable) there is a single node.
+         * The environment variable TS_STL_NUMA_NODES=<n> replaces the detected topology by n
+         * nodes that each get an equal, contiguous range of the CPUs.
+         */
+        class __numa_topology
+        {
+        private:
+            // upper limit for TS_STL_NUMA_NODES
+            static constexpr unsigned long __max_nodes = 1024;
+
+            unsigned __nodes = 1;
+            std::vector<unsigned> __cpu_nodes;
+
+            /**
+             * @brief parses a cpu list like "0-3,8-11" and assigns its CPUs to _node
+             */
+            void __assign(const std::string &_list, unsigned _node)
+            {
+                std::stringstream stream(_list);
+                std::string range;
+                while (std::getline(stream, range, ','))
+                {
+                    if (range.empty() || range == "\n")
+                        continue;
+                    auto dash = range.find('-');
+                    unsigned first = std::stoul(range.substr(0, dash));
+                    unsigned last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+                    if (__cpu_nodes.size() <= last)
+                        __cpu_nodes.resize(last + 1, 0);
+                    for (unsigned cpu = first; cpu <= last; cpu++)
+                        __cpu_nodes[cpu] = _node;
+                }
+            }
+
+            /**
+             * @brief applies TS_STL_NUMA_NODES if it is set to a valid node count
+             */
+            bool __override()
+            {
+                const char *value = std::getenv("TS_STL_NUMA_NODES");
+                if (value == nullptr)
+                    return false;
+                unsigned long nodes = std::strtoul(value, nullptr, 10);
+                if (nodes == 0 || nodes > __max_nodes)
+                    return false;
+                __nodes = static_cast<unsigned>(nodes);
+                unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+                __cpu_nodes.resize(cpus);
+                for (unsigned cpu = 0; cpu < cpus; cpu++)
+                    __cpu_nodes[cpu] = static_cast<unsigned>(static_cast<unsigned long long>(cpu) * __nodes / cpus);
+                return true;
+            }
+
+            __numa_topology()
+            {
+                if (__override())
+                {
+                    if (__nodes == 1)
+                        __cpu_nodes.clear();
+                    return;
+                }
+#ifdef __linux__
+                try
+                {
+                    unsigned node = 0;
+                    for (;; node++)
+                    {
+                        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                        if (!file)
+                            break;
+                        std::string list;
+                        std::getline(file, list);
+                        __assign(list, node);
+                    }
+                    if (node > 1)
+                        __nodes = node;
+                }
+                catch (...)
+                {
+                    // unexpected format, treat the machine as a single node
+                    __nodes = 1;
+                }
+#endif
+                if (__nodes == 1)
+                    __cpu_nodes.clear();
+            }
+
+        public:
+            static const __numa_topology &instance()
+            {
+                static const __numa_topology topology;
+                return topology;
+            }
+
+            unsigned nodes() const noexcept
+            {
+                return __nodes;
+            }
+
+            /**
+             * @brief node assigned to the calling thread, otherwise the node of the CPU it
+             * currently runs on
+             */
+            unsigned current_node() const noexcept
+            {
+                if (int assigned = __thread_numa_node(); assigned >= 0)
+                    return static_cast<unsigned>(assigned);
+#ifdef __linux__
+                if (__nodes > 1)
+                {
+                    int cpu = sched_getcpu();
+                    if (cpu >= 0 && static_cast<std::size_t>(cpu) < __cpu_nodes.size())
+                        return __cpu_nodes[cpu];
+                }
+#endif
+                return 0;
+            }
+        };
+    };
+
+    /**
+     * @brief NUMA aware cohort lock (C-MCS-MCS). Threads first take an MCS lock local to
+     * their NUMA node, and only the first of a cohort takes the global MCS lock. On release
+     * the global lock is passed along to a waiting thread of the same node, up to a bounded
+     * number of times in a row, before it is released to the other nodes. This keeps the
+     * protected container's cache lines on one node most of the time, while still being fair
+     * between nodes.
+     *
+     * On machines with a single NUMA node (or where the topology can't be detected) it is a
+     * plain MCS lock, unless a node count is passed to the constructor or set with the
+     * TS_STL_NUMA_NODES environment variable. Threads can also be assigned to a node with
+     * set_thread_node(), so the cohort path can be used (and tested) on any machine.
+     * Like mcs_lock it meets the (shared) timed mutex requirements so it can be used as the
+     * mutex of a ts::wrapper (e.g. ts::basic_umap<ts::cohort_lock, K, V>), and shared locks
+     * are exclusive.
+     */
+    class cohort_lock
+    {
+    private:
+        // consecutive hand-offs within a node before the global lock is released
+        static constexpr unsigned __max_passes = 64;
+
+        struct alignas(64) __cohort
+        {
+            mcs_lock local;
+            // the following are only accessed by the holder of the local lock
+            bool global_held = false;
+            unsigned passes = 0;
+        };
+
+        mcs_lock __global;
+        std::unique_ptr<__cohort[]> __cohorts;
+        unsigned __node_count;
+        // cohort of the current holder, only accessed by the holder
+        __cohort *__holder = nullptr;
+
+        bool __flat() const noexcept
+        {
+            return __node_count == 1;
+        }
+
+        __cohort &__local_cohort() const noexcept
+        {
+            return __cohorts[__detail::__numa_topology::instance().current_node() % __node_count];
+        }
+
+        /**
+         * @brief takes the global lock for _cohort unless it already holds it.
+         * The local lock of _cohort has to be held.
+         */
+        template <class _Acquire>
+        bool __acquire_global(__cohort &_cohort, _Acquire &&_acquire)
+        {
+            if (!_cohort.global_held)
+            {
+                if (!_acquire(__global))
+                {
+                    _cohort.local.unlock();
+                    return false;
+                }
+                _cohort.global_held = true;
+                _cohort.passes = 0;
+            }
+            __holder = &_cohort;
+            return true;
+        }
+
+        /**
+         * @brief releases the global lock of _cohort and then its local lock
+         */
+        void __release_global(__cohort &_cohort)
+        {
+            _cohort.global_held = false;
+            _cohort.passes = 0;
+            __global.unlock();
+            _cohort.local.unlock();
+        }
+
+    public:
+        /**
+         * @param _node_count number of cohorts, 0 to use the NUMA nodes of the machine (or
+         * TS_STL_NUMA_NODES). Threads whose node is not below it share cohorts round robin.
+         */
+        explicit cohort_lock(unsigned _node_count = 0)
+            : __node_count(_node_count != 0 ? _node_count : __detail::__numa_topology::instance().nodes())
+        {
+            if (!__flat())
+                __cohorts.reset(new __cohort[__node_count]);
+        }
+
+        cohort_lock(const cohort_lock &) = delete;
+        cohort_lock &operator=(const cohort_lock &) = delete;
+
+        /**
+         * @return unsigned number of NUMA nodes the lock distinguishes (1 = flat lock)
+         */
+        unsigned node_count() const noexcept
+        {
+            return __node_count;
+        }
+
+        /**
+         * @brief assigns the calling thread to NUMA node _node for all cohort_locks, instead of
+         * the node of the CPU it runs on. A negative value restores the detection.
+         */
+        static void set_thread_node(int _node) noexcept
+        {
+            __detail::__thread_numa_node() = _node;
+        }
+
+        void lock()
+        {
+            if (__flat())
+                return __global.lock();
+            __cohort &cohort = __local_cohort();
+            cohort.local.lock();
+            __acquire_global(cohort, [](mcs_lock &_global)
+            {
+                _global.lock();
+                return true;
+            });
+        }
+
+        bool try_lock()
+        {
+            if (__flat())
+                return __global.try_lock();
+            __cohort &cohort = __local_cohort();
+            if (!cohort.local.try_lock())
+                return false;
+            return __acquire_global(cohort, [](mcs_lock &_global)
+            {
+                return _global.try_lock();
+            });
+        }
+
+        template <class _Rep, class _Period>
+        bool try_lock_for(const std::chrono::duration<_Rep, _Period> &_duration)
+        {
+            return try_lock_until(std::chrono::steady_clock::now() + _duration);
+        }
+
+        template <class _Clock, class _Duration>
+        bool try_lock_until(const std::chrono::time_point<_Clock, _Duration> &_time)
+        {
+            if (__flat())
+                return __global.try_lock_until(_time);
+            __cohort &cohort = __local_cohort();
+            if (!cohort.local.try_lock_until(_time))
+                return false;
+            return __acquire_global(cohort, [&](mcs_lock &_global)
+            {
+                return _global.try_lock_until(_time);
+            });
+        }
+
+        void unlock()
+        {
+            if (__flat())
+                return __global.unlock();
+
+            __cohort &cohort = *__holder;
+            __holder = nullptr;
+            if (!cohort.local.has_waiters() || cohort.passes >= __max_passes)
+                return __release_global(cohort);
+
+            // pass the global lock on within the cohort
+            cohort.passes++;
+            if (cohort.local.unlock_handoff())
+                return;
+
+            // all local waiters timed out, so nobody took over the global lock. Whoever gets
+            // the local lock next inherits it, if that's us, release it to the other nodes.
+            if (cohort.local.try_lock())
+            {
+                if (cohort.global_held)
+                    __release_global(cohort);
+                else
+                    cohort.local.unlock();
+            }
+        }
+
+        // there is no shared mode, shared locks are exclusive
+        void lock_shared()
+        {
+            lock();
+        }
+        bool try_lock_shared()
+        {
+            return try_lock();
+        }
+        template <class _Rep, class _Period>
+        bool try_lock_shared_for(const std::chrono::duration<_Rep, _Period> &_duration)
+        {
+            return try_lock_for(_duration);
+        }
+        template <class _Clock, class _Duration>
+        bool try_lock_shared_until(const std::chrono::time_point<_Clock, _Duration> &_time)
+        {
+            return try_lock_until(_time);
+        }
+        void unlock_shared()
+        {
+            unlock();
+        }
+    };
+};
@@ -0,0 +1,201 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 21:17
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Background compaction of wrapped associative containers after mass deletions.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <future>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <optional>
+
+#include "wrapper.hpp"
+
+namespace ts
+{
+    /**
+     * @brief configuration of compact() and needs_compaction()
+     */
+    struct compaction_options
+    {
+        // hash containers with fewer elements per bucket than this need compaction
+        float min_load_factor = 0.25f;
+        // hash containers with fewer buckets are never considered to need compaction
+        std::size_t min_buckets = 1024;
+        // elements copied per shared access of the container
+        std::size_t batch_size = 1024;
+        // pause between two batches, leaving room for writers
+        std::chrono::microseconds pause{0};
+        // restarts because of concurrent modification before the copy is made under exclusive access
+        unsigned max_restarts = 8;
+    };
+
+    /**
+     * @brief outcome of a compaction
+     */
+    struct compaction_result
+    {
+        // approximate memory footprint of the container before and after (see container_metadata)
+        std::size_t bytes_before = 0;
+        std::size_t bytes_after = 0;
+        // times the copy was started over because the container was modified meanwhile
+        unsigned restarts = 0;
+        // whether the copy had to be made under exclusive access after max_restarts
+        bool exclusive_copy = false;
+    };
+
+    namespace __detail
+    {
+        /**
+         * @brief empty container with the hash/comparison functions and allocator of _container
+         */
+        template <class _T>
+        _T __empty_like(const _T &_container)
+        {
+            if constexpr (__has_buckets<_T>::value)
+                return _T(0, _container.hash_function(), _container.key_eq(), _container.get_allocator());
+            else
+                return _T(_container.key_comp(), _container.get_allocator());
+        }
+
+        /**
+         * @brief copies up to _count elements starting at _it into _shadow
+         */
+        template <class _T, class _It>
+        void __copy_batch(_T &_shadow, _It &_it, _It _end, std::size_t _count)
+        {
+            for (std::size_t i = 0; i < _count && _it != _end; i++, ++_it)
+                _shadow.emplace_hint(_shadow.end(), *_it);
+        }
+    };
+
+    /**
+     * @brief whether the container of _wrapper would profit from compact(). This is the case for
+     * hash containers whose bucket array is much larger than needed (e.g. after mass deletions).
+     * It only reads the published metadata, so it doesn't lock the container and can be polled.
+     * Ordered containers have no such signal, compacting them after erase waves is up to the caller.
+     */
+    template <class _T, class _MT>
+    bool needs_compaction(const wrapper<_T, _MT> &_wrapper, const compaction_options &_options = {})
+    {
+        container_metadata metadata = _wrapper.metadata();
+        return metadata.bucket_count >= _options.min_buckets && metadata.load_factor < _options.min_load_factor;
+    }
+
+    /**
+     * @brief rebuilds the associative container (unordered or ordered map/set) of _wrapper to
+     * reclaim memory and restore locality, without a long stop-the-world rehash.
+     *
+     * A shadow copy is built in batches of _options.batch_size elements, each under a short shared
+     * access, so readers are never blocked and writers only for the duration of one batch. Then
+     * the shadow copy is swapped in (O(1)) under a short exclusive access and the old contents are
+     * freed after the lock has been released. Hash containers get a bucket array sized for their
+     * current element count, ordered ones get their nodes allocated in order.
+     *
+     * If the container was modified between two batches (detected through the metadata generation,
+     * see wrapper::metadata()), the copy is started over. After _options.max_restarts it is made
+     * in one go under exclusive access instead.
+     *
+     * Lock timeouts are those configured on _wrapper.
+     */
+    template <class _T, class _MT>
+    compaction_result compact(wrapper<_T, _MT> &_wrapper, const compaction_options &_options = {})
+    {
+        compaction_result result;
+        result.bytes_before = _wrapper.metadata().bytes;
+        std::size_t batch_size = _options.batch_size == 0 ? 1 : _options.batch_size;
+
+        for (;; result.restarts++)
+        {
+            if (result.restarts >= _options.max_restarts)
+            {
+                result.exclusive_copy = true;
+                std::optional<_T> shadow;
+                {
+                    auto access = _wrapper.get_exclusive_access();
+                    shadow.emplace(__detail::__empty_like(*access));
+                    if constexpr (__detail::__has_buckets<_T>::value)
+                        shadow->reserve(access->size());
+                    auto it = access->begin();
+                    __detail::__copy_batch(*shadow, it, access->end(), access->size());
+                    using std::swap;
+                    swap(*access, *shadow);
+                }
+                // the old contents are destroyed here, after the lock has been released
+                break;
+            }
+
+            // constructed from the container, allocators may not be default constructible
+            std::optional<_T> shadow;
+            std::uint64_t generation;
+            typename _T::const_iterator it;
+            bool done = false;
+            {
+                auto access = _wrapper.get_shared_access();
+                generation = _wrapper.metadata().generation;
+                shadow.emplace(__detail::__empty_like(*access));
+                if constexpr (__detail::__has_buckets<_T>::value)
+                    shadow->reserve(access->size());
+                it = access->begin();
+                __detail::__copy_batch(*shadow, it, access->end(), batch_size);
+                done = it == access->end();
+            }
+
+            // iterators stay valid as long as the container is not modified
+            bool modified = false;
+            while (!done && !modified)
+            {
+                if (_options.pause.count() > 0)
+                    std::this_thread::sleep_for(_options.pause);
+                auto access = _wrapper.get_shared_access();
+                if (_wrapper.metadata().generation != generation)
+                {
+                    modified = true;
+                    break;
+                }
+                __detail::__copy_batch(*shadow, it, access->end(), batch_size);
+                done = it == access->end();
+            }
+            if (modified)
+                continue;
+
+            {
+                auto access = _wrapper.get_exclusive_access();
+                if (_wrapper.metadata().generation != generation)
+                    continue;
+                using std::swap;
+                swap(*access, *shadow);
+            }
+            // the old contents are destroyed here, after the lock has been released
+            break;
+        }
+
+        result.bytes_after = _wrapper.metadata().bytes;
+        return result;
+    }
+
+    /**
+     * @brief runs compact() on a new thread. _wrapper has to stay alive until the returned
+     * future is ready.
+     */
+    template <class _T, class _MT>
+    std::future<compaction_result> compact_async(wrapper<_T, _MT> &_wrapper, const compaction_options &_options = {})
+    {
+        return std::async(std::launch::async, [&_wrapper, _options]
+        {
+            return compact(_wrapper, _options);
+        });
+    }
+};
@@ -0,0 +1,266 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 13:05
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Epoch based memory reclamation for the lock-free read paths of ts-stl.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace ts
+{
+    /**
+     * @brief process wide epoch based memory reclamation (EBR).
+     * Readers that traverse a data structure without locks wrap the traversal in an
+     * epoch_guard. Writers that unlink an object retire() it instead of deleting it, and
+     * the object is only freed once every reader that might still see it has left its guard.
+     *
+     * Entering and leaving a guard only writes to a per-thread slot, so readers never
+     * contend with each other. Retiring and collecting is serialized by a mutex and
+     * therefore meant for writers that are serialized anyway or infrequent.
+     */
+    class epoch_manager
+    {
+    private:
+        static constexpr std::uint64_t __idle = UINT64_MAX;
+        // retired objects are collected every this many retirements
+        static constexpr std::size_t __collect_interval = 64;
+
+        struct alignas(64) __slot
+        {
+            std::atomic<std::uint64_t> epoch{__idle};
+            unsigned depth = 0;
+            bool in_use = false;
+        };
+
+        struct __retired
+        {
+            void *object;
+            void (*deleter)(void *);
+            std::uint64_t epoch;
+        };
+
+        /**
+         * @brief per thread registration of a slot, released when the thread exits
+         */
+        struct __thread_handle
+        {
+            __slot *slot = nullptr;
+
+            ~__thread_handle()
+            {
+                if (slot)
+                    instance().__release_slot(slot);
+            }
+        };
+
+        std::atomic<std::uint64_t> __global_epoch{1};
+        std::mutex __mutex;
+        std::deque<__slot> __slots;
+        std::vector<__retired> __retired_objects;
+        std::size_t __retired_since_collect = 0;
+
+        __slot *__acquire_slot()
+        {
+            std::lock_guard lock(__mutex);
+            for (auto &slot : __slots)
+            {
+                if (!slot.in_use)
+                {
+                    slot.in_use = true;
+                    return &slot;
+                }
+            }
+            __slot &slot = __slots.emplace_back();
+            slot.in_use = true;
+            return &slot;
+        }
+
+        void __release_slot(__slot *_slot)
+        {
+            std::lock_guard lock(__mutex);
+            _slot->epoch.store(__idle, std::memory_order_release);
+            _slot->depth = 0;
+            _slot->in_use = false;
+        }
+
+        __slot &__local_slot()
+        {
+            thread_local __thread_handle handle;
+            if (!handle.slot)
+                handle.slot = __acquire_slot();
+            return *handle.slot;
+        }
+
+        /**
+         * @brief tries to advance the global epoch and frees everything retired before
+         * the oldest epoch any reader is still in. __mutex has to be held.
+         */
+        void __collect_locked()
+        {
+            std::uint64_t global = __global_epoch.load(std::memory_order_seq_cst);
+            std::uint64_t oldest = global;
+            for (auto &slot : __slots)
+                oldest = std::min(oldest, slot.epoch.load(std::memory_order_seq_cst));
+
+            // all active readers have seen the current epoch, start a new one
+            if (oldest == global)
+                __global_epoch.compare_exchange_strong(global, global + 1, std::memory_order_seq_cst);
+
+            auto keep = std::partition(__retired_objects.begin(), __retired_objects.end(), [&](const __retired &_r)
+            {
+                return _r.epoch >= oldest;
+            });
+            for (auto it = keep; it != __retired_objects.end(); ++it)
+                it->deleter(it->object);
+            __retired_objects.erase(keep, __retired_objects.end());
+            __retired_since_collect = 0;
+        }
+
+        epoch_manager() = default;
+
+    public:
+        epoch_manager(const epoch_manager &) = delete;
+        epoch_manager &operator=(const epoch_manager &) = delete;
+
+        /**
+         * @brief the process wide manager. It is intentionally never destroyed so it
+         * outlives all thread local registrations.
+         */
+        static epoch_manager &instance()
+        {
+            static epoch_manager *manager = new epoch_manager();
+            return *manager;
+        }
+
+        /**
+         * @brief marks the calling thread as reading. Guards can be nested.
+         */
+        void enter()
+        {
+            __slot &slot = __local_slot();
+            if (slot.depth++ > 0)
+                return;
+
+            // re-check so a collector can't have started a new epoch unnoticed in between
+            std::uint64_t epoch = __global_epoch.load(std::memory_order_seq_cst);
+            for (;;)
+            {
+                slot.epoch.store(epoch, std::memory_order_seq_cst);
+                std::uint64_t current = __global_epoch.load(std::memory_order_seq_cst);
+                if (current == epoch)
+                    break;
+                epoch = current;
+            }
+        }
+
+        /**
+         * @brief marks the calling thread as no longer reading (when leaving the outermost guard).
+         */
+        void exit()
+        {
+            __slot &slot = __local_slot();
+            if (--slot.depth == 0)
+                slot.epoch.store(__idle, std::memory_order_release);
+        }
+
+        /**
+         * @brief schedules _object to be freed with _deleter once no reader can access it
+         * anymore. The object must already be unreachable for new readers.
+         */
+        void retire(void *_object, void (*_deleter)(void *))
+        {
+            std::lock_guard lock(__mutex);
+            __retired_objects.push_back({_object, _deleter, __global_epoch.load(std::memory_order_seq_cst)});
+            if (++__retired_since_collect >= __collect_interval)
+                __collect_locked();
+        }
+
+        /**
+         * @brief schedules _object to be deleted once no reader can access it anymore.
+         */
+        template <class _T>
+        void retire(_T *_object)
+        {
+            retire(static_cast<void *>(_object), [](void *_p)
+            {
+                delete static_cast<_T *>(_p);
+            });
+        }
+
+        /**
+         * @brief blocks until every reader that was inside a guard when this was called has
+         * left it. After publishing a new version of some pointer, this guarantees that no reader
+         * uses the previous one anymore. Must not be called from inside a guard.
+         */
+        void synchronize()
+        {
+            std::uint64_t target;
+            {
+                std::lock_guard lock(__mutex);
+                // start a new epoch so every reader entering from now on is recognizable
+                target = __global_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+            }
+            for (;;)
+            {
+                bool done = true;
+                {
+                    std::lock_guard lock(__mutex);
+                    for (auto &slot : __slots)
+                        if (slot.epoch.load(std::memory_order_seq_cst) < target)
+                            done = false;
+                }
+                if (done)
+                    return;
+                std::this_thread::yield();
+            }
+        }
+
+        /**
+         * @brief frees all retired objects that are no longer accessible. This happens
+         * automatically every few retirements, calling it manually is only needed to release
+         * memory early (e.g. after a burst of modifications).
+         */
+        void collect()
+        {
+            std::lock_guard lock(__mutex);
+            // two rounds, so objects retired in the current epoch can be freed as well
+            __collect_locked();
+            __collect_locked();
+        }
+    };
+
+    /**
+     * @brief RAII guard marking the calling thread as reading a structure protected by
+     * the epoch_manager for its lifetime.
+     */
+    class epoch_guard
+    {
+    public:
+        epoch_guard()
+        {
+            epoch_manager::instance().enter();
+        }
+        ~epoch_guard()
+        {
+            epoch_manager::instance().exit();
+        }
+
+        epoch_guard(const epoch_guard &) = delete;
+        epoch_guard &operator=(const epoch_guard &) = delete;
+    };
+};
@@ -13,14 +13,52 @@ Exception classes for ts-stl
 
 #pragma once
 
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cstddef>
 #include <exception>
 
+#include "hooks.hpp"
+
 namespace ts
 {
+    /**
+     * @brief lock mode an accessor requested
+     */
+    enum class lock_mode
+    {
+        exclusive,
+        shared,
+    };
+
+    /**
+     * @brief what was known about a lock when waiting for it timed out, see lock_timeout_error
+     */
+    struct lock_timeout_info
+    {
+        // name of the wrapper (see wrapper::set_name()), empty if it has none
+        std::string name;
+        lock_mode mode = lock_mode::exclusive;
+        // how long the caller waited before giving up
+        std::chrono::nanoseconds waited{0};
+        // whether holders and readers were recorded, which requires TS_STL_LOCK_DIAGNOSTICS (see hooks.hpp)
+        bool diagnostics = false;
+        // accessors holding the lock when the wait timed out
+        std::vector<lock_hold> holders;
+        // number of shared holders among them
+        std::size_t readers = 0;
+    };
+
     class lock_timeout_error : public std::exception
     {
     private:
         const char *message = nullptr;
+        // only set if constructed with a lock_timeout_info
+        bool __has_info = false;
+        lock_timeout_info __info;
+        std::string __what;
 
     public:
         lock_timeout_error(const char *_msg)
@@ -28,9 +66,56 @@ namespace ts
             message = _msg;
         }
 
+        /**
+         * @brief timeout error with diagnostics about the lock, included in what().
+         * Only constructed once waiting has already failed, so gathering them costs nothing
+         * on acquisitions that succeed.
+         */
+        lock_timeout_error(const char *_msg, lock_timeout_info _info)
+            : message(_msg),
+            __has_info(true),
+            __info(std::move(_info))
+        {
+            std::ostringstream what;
+            what << message;
+            if (!__info.name.empty())
+                what << " on '" << __info.name << "'";
+            what << ": " << (__info.mode == lock_mode::exclusive ? "exclusive" : "shared")
+                 << " lock not acquired after " << std::chrono::duration_cast<std::chrono::milliseconds>(__info.waited).count() << " ms";
+            if (__info.diagnostics)
+            {
+                what << ", " << __info.holders.size() << " holder(s), " << __info.readers << " reader(s)";
+                for (const lock_hold &hold : __info.holders)
+                    what << "\n    " << (hold.exclusive ? "exclusive" : "shared") << " by thread " << hold.thread
+                         << " for " << std::chrono::duration_cast<std::chrono::milliseconds>(hold.held).count() << " ms, taken at "
+                         << hold.site.file_name() << ":" << hold.site.line() << " (" << hold.site.function_name() << ")";
+            }
+            else
+            {
+                what << " (define TS_STL_LOCK_DIAGNOSTICS to see the holders)";
+            }
+            __what = what.str();
+        }
+
+        /**
+         * @brief whether info() is available. Errors thrown by wrapper accessors have it.
+         */
+        bool has_info() const noexcept
+        {
+            return __has_info;
+        }
+
+        /**
+         * @brief diagnostics about the lock, see has_info()
+         */
+        const lock_timeout_info &info() const noexcept
+        {
+            return __info;
+        }
+
         virtual const char *what() const noexcept override
         {
-            return message;
+            return __has_info ? __what.c_str() : message;
         }
     };
-};
\ No newline at end of file
+};
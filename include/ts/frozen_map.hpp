@@ -0,0 +1,318 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 10:03
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Immutable, cache-friendly snapshot of an ordered map for read-only phases.
+*/
+
+#pragma once
+
+#include <map>
+#include <vector>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <functional>
+#include <utility>
+
+#include "wrapper.hpp"
+
+namespace ts
+{
+    /**
+     * @brief immutable ordered map storing its keys and values in two contiguous arrays
+     * in Eytzinger (BFS) order instead of a tree of individually allocated nodes.
+     * Lookups walk the implicit tree with a branchless loop and prefetch the cache line
+     * holding the descendants a few levels ahead, so a search causes very few cache misses
+     * compared to std::map.
+     *
+     * A frozen_map never changes after construction, so any number of threads can read
+     * it simultaneously without any locking. Use ts::freeze() to create one from a
+     * ts::map and thaw() to turn it back into a mutable std::map.
+     *
+     * @tparam _K key type
+     * @tparam _V mapped type
+     * @tparam _Compare key comparator (same semantics as for std::map)
+     */
+    template <class _K, class _V, class _Compare = std::less<_K>>
+    class frozen_map
+    {
+    public:
+        typedef _K key_type;
+        typedef _V mapped_type;
+        typedef _Compare key_compare;
+        typedef std::size_t size_type;
+
+        /**
+         * @brief forward iterator visiting the elements in key order.
+         * Dereferencing yields a pair of references to the key and the value.
+         */
+        class const_iterator
+        {
+        private:
+            const frozen_map *__map = nullptr;
+            size_type __index = 0; // 1-based Eytzinger index, 0 = end
+
+            friend class frozen_map;
+
+            const_iterator(const frozen_map *_map, size_type _index)
+                : __map(_map),
+                __index(_index)
+            {
+            }
+
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef std::pair<const _K &, const _V &> value_type;
+            typedef std::pair<const _K &, const _V &> reference;
+            typedef std::ptrdiff_t difference_type;
+
+            struct pointer
+            {
+                reference __ref;
+                const reference *operator->() const
+                {
+                    return &__ref;
+                }
+            };
+
+            const_iterator() = default;
+
+            reference operator*() const
+            {
+                return reference(__map->__keys[__index - 1], __map->__values[__index - 1]);
+            }
+            pointer operator->() const
+            {
+                return pointer{**this};
+            }
+
+            const_iterator &operator++()
+            {
+                __index = __successor(__index, __map->__keys.size());
+                return *this;
+            }
+            const_iterator operator++(int)
+            {
+                const_iterator old = *this;
+                ++*this;
+                return old;
+            }
+
+            bool operator==(const const_iterator &_other) const
+            {
+                return __index == _other.__index;
+            }
+            bool operator!=(const const_iterator &_other) const
+            {
+                return __index != _other.__index;
+            }
+        };
+        typedef const_iterator iterator;
+
+    private:
+        std::vector<_K> __keys;
+        std::vector<_V> __values;
+        _Compare __comp;
+
+        // number of tree levels whose descendants of one node fit into a single cache line
+        static constexpr unsigned __prefetch_levels =
+            sizeof(_K) <= 4 ? 4 : sizeof(_K) <= 8 ? 3 : sizeof(_K) <= 16 ? 2 : 1;
+
+        /**
+         * @brief in-order successor of Eytzinger index _k in a tree of _n elements
+         * (0 if _k is the last element).
+         */
+        static size_type __successor(size_type _k, size_type _n)
+        {
+            if (2 * _k + 1 <= _n)
+            {
+                // leftmost element of the right subtree
+                _k = 2 * _k + 1;
+                while (2 * _k <= _n)
+                    _k = 2 * _k;
+                return _k;
+            }
+            // go up until we leave a left subtree
+            while (_k & 1)
+                _k >>= 1;
+            return _k >> 1;
+        }
+
+        /**
+         * @brief Eytzinger index of the smallest element in a tree of _n elements.
+         */
+        static size_type __first_index(size_type _n)
+        {
+            if (_n == 0)
+                return 0;
+            size_type k = 1;
+            while (2 * k <= _n)
+                k = 2 * k;
+            return k;
+        }
+
+        /**
+         * @brief Eytzinger index of the first key that is not less than _key
+         * (or greater than _key if _upper is set), 0 if there is none.
+         */
+        template <bool _upper>
+        size_type __search(const _K &_key) const
+        {
+            const size_type n = __keys.size();
+            const _K *keys = __keys.data();
+            size_type k = 1;
+            while (k <= n)
+            {
+#if defined(__GNUC__) || defined(__clang__)
+                // the descendants __prefetch_levels levels down share one cache line
+                size_type ahead = k << __prefetch_levels;
+                if (ahead <= n)
+                    __builtin_prefetch(keys + ahead - 1);
+#endif
+                if constexpr (_upper)
+                    k = 2 * k + !__comp(_key, keys[k - 1]);
+                else
+                    k = 2 * k + __comp(keys[k - 1], _key);
+            }
+            // undo the right turns taken after the last left turn
+#if defined(__GNUC__) || defined(__clang__)
+            return k >> (__builtin_ctzll(~static_cast<unsigned long long>(k)) + 1);
+#else
+            while (k & 1)
+                k >>= 1;
+            return k >> 1;
+#endif
+        }
+
+    public:
+        frozen_map() = default;
+
+        /**
+         * @brief creates a frozen copy of an ordered map.
+         */
+        template <class _Alloc>
+        explicit frozen_map(const std::map<_K, _V, _Compare, _Alloc> &_source)
+            : __comp(_source.key_comp())
+        {
+            size_type n = _source.size();
+            std::vector<const typename std::map<_K, _V, _Compare, _Alloc>::value_type *> sorted;
+            sorted.reserve(n);
+            for (const auto &element : _source)
+                sorted.push_back(&element);
+
+            // an in-order walk of the implicit tree assigns each slot its sorted rank
+            std::vector<size_type> rank(n);
+            size_type r = 0;
+            for (size_type k = __first_index(n); k != 0; k = __successor(k, n))
+                rank[k - 1] = r++;
+
+            __keys.reserve(n);
+            __values.reserve(n);
+            for (size_type k = 0; k < n; k++)
+            {
+                __keys.push_back(sorted[rank[k]]->first);
+                __values.push_back(sorted[rank[k]]->second);
+            }
+        }
+
+        size_type size() const noexcept
+        {
+            return __keys.size();
+        }
+        bool empty() const noexcept
+        {
+            return __keys.empty();
+        }
+        key_compare key_comp() const
+        {
+            return __comp;
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(this, __first_index(__keys.size()));
+        }
+        const_iterator end() const
+        {
+            return const_iterator(this, 0);
+        }
+
+        const_iterator lower_bound(const _K &_key) const
+        {
+            return const_iterator(this, __search<false>(_key));
+        }
+        const_iterator upper_bound(const _K &_key) const
+        {
+            return const_iterator(this, __search<true>(_key));
+        }
+
+        const_iterator find(const _K &_key) const
+        {
+            size_type k = __search<false>(_key);
+            if (k != 0 && !__comp(_key, __keys[k - 1]))
+                return const_iterator(this, k);
+            return end();
+        }
+
+        /**
+         * @return const _V* pointer to the value mapped to _key or nullptr if there is none
+         */
+        const _V *get(const _K &_key) const
+        {
+            size_type k = __search<false>(_key);
+            if (k != 0 && !__comp(_key, __keys[k - 1]))
+                return &__values[k - 1];
+            return nullptr;
+        }
+
+        const _V &at(const _K &_key) const
+        {
+            const _V *value = get(_key);
+            if (value == nullptr)
+                throw std::out_of_range("ts-stl/frozen_map::at() key not found");
+            return *value;
+        }
+
+        bool contains(const _K &_key) const
+        {
+            return get(_key) != nullptr;
+        }
+        size_type count(const _K &_key) const
+        {
+            return contains(_key) ? 1 : 0;
+        }
+
+        /**
+         * @brief creates a mutable std::map with the same contents. Since the elements
+         * are visited in order, this takes linear time.
+         */
+        std::map<_K, _V, _Compare> thaw() const
+        {
+            std::map<_K, _V, _Compare> result(__comp);
+            for (size_type k = __first_index(__keys.size()); k != 0; k = __successor(k, __keys.size()))
+                result.emplace_hint(result.end(), __keys[k - 1], __values[k - 1]);
+            return result;
+        }
+    };
+
+    /**
+     * @brief creates an immutable frozen_map snapshot of a ts::map, reading it with
+     * shared access. The snapshot can then be read by any number of threads without locking.
+     * To make the data mutable again, thaw() the snapshot and swap() it into a wrapper.
+     *
+     * @param _w map to freeze
+     */
+    template <class _K, class _V, class _Compare, class _Alloc, class _MT>
+    frozen_map<_K, _V, _Compare> freeze(wrapper<std::map<_K, _V, _Compare, _Alloc>, _MT> &_w)
+    {
+        auto access = _w.get_shared_access();
+        return frozen_map<_K, _V, _Compare>(*access);
+    }
+};
@@ -0,0 +1,289 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 11:20
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Immutable, perfectly hashed snapshot of an unordered map for read-only phases.
+*/
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <functional>
+#include <utility>
+
+#include "perfect_hash.hpp"
+#include "wrapper.hpp"
+
+namespace ts
+{
+    /**
+     * @brief immutable unordered map using a minimal perfect hash function over its keys.
+     * Keys and values are stored in two flat arrays without any empty slots or per element
+     * allocations, so every lookup takes exactly one probe and the memory footprint is a
+     * fraction of std::unordered_map's. Keys whose hashes collide with another key's are
+     * stored after the others, sorted by hash, and only searched when the probe finds a
+     * different key with the same hash.
+     * An additional array of 8 bit fingerprints (one byte per element) is checked before
+     * the key array, which lets ~255 of 256 misses be reported without touching the
+     * keys at all.
+     *
+     * A frozen_umap never changes after construction, so any number of threads can read
+     * it simultaneously without any locking. Use ts::freeze() to create one from a
+     * ts::umap and thaw() to turn it back into a mutable std::unordered_map.
+     *
+     * @tparam _K key type
+     * @tparam _V mapped type
+     * @tparam _Hash key hash function (same semantics as for std::unordered_map)
+     * @tparam _KeyEqual key equality predicate
+     */
+    template <class _K, class _V, class _Hash = std::hash<_K>, class _KeyEqual = std::equal_to<_K>>
+    class frozen_umap
+    {
+    public:
+        typedef _K key_type;
+        typedef _V mapped_type;
+        typedef _Hash hasher;
+        typedef _KeyEqual key_equal;
+        typedef std::size_t size_type;
+
+        /**
+         * @brief forward iterator visiting the elements in unspecified order.
+         * Dereferencing yields a pair of references to the key and the value.
+         */
+        class const_iterator
+        {
+        private:
+            const frozen_umap *__map = nullptr;
+            size_type __index = 0;
+
+            friend class frozen_umap;
+
+            const_iterator(const frozen_umap *_map, size_type _index)
+                : __map(_map),
+                __index(_index)
+            {
+            }
+
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef std::pair<const _K &, const _V &> value_type;
+            typedef std::pair<const _K &, const _V &> reference;
+            typedef std::ptrdiff_t difference_type;
+
+            struct pointer
+            {
+                reference __ref;
+                const reference *operator->() const
+                {
+                    return &__ref;
+                }
+            };
+
+            const_iterator() = default;
+
+            reference operator*() const
+            {
+                return reference(__map->__keys[__index], __map->__values[__index]);
+            }
+            pointer operator->() const
+            {
+                return pointer{**this};
+            }
+
+            const_iterator &operator++()
+            {
+                __index++;
+                return *this;
+            }
+            const_iterator operator++(int)
+            {
+                const_iterator old = *this;
+                ++*this;
+                return old;
+            }
+
+            bool operator==(const const_iterator &_other) const
+            {
+                return __index == _other.__index;
+            }
+            bool operator!=(const const_iterator &_other) const
+            {
+                return __index != _other.__index;
+            }
+        };
+        typedef const_iterator iterator;
+
+    private:
+        perfect_hash __phf;
+        // fingerprints of the first __phf.size() keys, one per distinct hash
+        std::vector<std::uint8_t> __fingerprints;
+        // hashes of the keys after the first __phf.size() ones, whose hashes collide with another key's
+        std::vector<std::uint64_t> __overflow;
+        std::vector<_K> __keys;
+        std::vector<_V> __values;
+        _Hash __hash;
+        _KeyEqual __equal;
+
+        static std::uint8_t __fingerprint(std::uint64_t _hash) noexcept
+        {
+            return static_cast<std::uint8_t>(_hash >> 56);
+        }
+
+        /**
+         * @return size_type slot holding _key or size() if there is none
+         */
+        size_type __slot(const _K &_key) const
+        {
+            if (__keys.empty())
+                return 0;
+            std::uint64_t hash = mix_hash(__hash(_key));
+            size_type slot = __phf(hash);
+            if (__fingerprints[slot] != __fingerprint(hash))
+                return __keys.size();
+            if (__equal(__keys[slot], _key))
+                return slot;
+
+            // another key with the same hash may be stored in the overflow range
+            auto range = std::equal_range(__overflow.begin(), __overflow.end(), hash);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                slot = __phf.size() + static_cast<size_type>(it - __overflow.begin());
+                if (__equal(__keys[slot], _key))
+                    return slot;
+            }
+            return __keys.size();
+        }
+
+    public:
+        frozen_umap() = default;
+
+        /**
+         * @brief creates a frozen copy of an unordered map. Keys whose hashes collide are
+         * supported, but every additional key sharing a hash makes lookups of that hash slower.
+         */
+        template <class _Alloc>
+        explicit frozen_umap(const std::unordered_map<_K, _V, _Hash, _KeyEqual, _Alloc> &_source)
+            : __hash(_source.hash_function()),
+            __equal(_source.key_eq())
+        {
+            std::vector<const typename std::unordered_map<_K, _V, _Hash, _KeyEqual, _Alloc>::value_type *> elements;
+            std::vector<std::uint64_t> hashes;
+            elements.reserve(_source.size());
+            hashes.reserve(_source.size());
+            for (const auto &element : _source)
+            {
+                elements.push_back(&element);
+                hashes.push_back(mix_hash(__hash(element.first)));
+            }
+
+            __phf = perfect_hash(hashes);
+            std::vector<size_type> order = __detail::__frozen_order(__phf, hashes, __overflow);
+
+            __fingerprints.resize(__phf.size());
+            for (size_type slot = 0; slot < __phf.size(); slot++)
+                __fingerprints[slot] = __fingerprint(hashes[order[slot]]);
+
+            __keys.reserve(elements.size());
+            __values.reserve(elements.size());
+            for (size_type i : order)
+            {
+                __keys.push_back(elements[i]->first);
+                __values.push_back(elements[i]->second);
+            }
+        }
+
+        size_type size() const noexcept
+        {
+            return __keys.size();
+        }
+        bool empty() const noexcept
+        {
+            return __keys.empty();
+        }
+        hasher hash_function() const
+        {
+            return __hash;
+        }
+        key_equal key_eq() const
+        {
+            return __equal;
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(this, 0);
+        }
+        const_iterator end() const
+        {
+            return const_iterator(this, __keys.size());
+        }
+
+        const_iterator find(const _K &_key) const
+        {
+            return const_iterator(this, __slot(_key));
+        }
+
+        /**
+         * @return const _V* pointer to the value mapped to _key or nullptr if there is none
+         */
+        const _V *get(const _K &_key) const
+        {
+            size_type slot = __slot(_key);
+            return slot == __keys.size() ? nullptr : &__values[slot];
+        }
+
+        const _V &at(const _K &_key) const
+        {
+            const _V *value = get(_key);
+            if (value == nullptr)
+                throw std::out_of_range("ts-stl/frozen_umap::at() key not found");
+            return *value;
+        }
+
+        bool contains(const _K &_key) const
+        {
+            return __slot(_key) != __keys.size();
+        }
+        size_type count(const _K &_key) const
+        {
+            return contains(_key) ? 1 : 0;
+        }
+
+        /**
+         * @brief creates a mutable std::unordered_map with the same contents.
+         */
+        std::unordered_map<_K, _V, _Hash, _KeyEqual> thaw() const
+        {
+            std::unordered_map<_K, _V, _Hash, _KeyEqual> result(__keys.size(), __hash, __equal);
+            for (size_type i = 0; i < __keys.size(); i++)
+                result.emplace(__keys[i], __values[i]);
+            return result;
+        }
+    };
+
+    /**
+     * @brief creates an immutable frozen_umap snapshot of a ts::umap, reading it with
+     * shared access. The snapshot can then be read by any number of threads without locking.
+     * To make the data mutable again, thaw() the snapshot and swap() it into a wrapper.
+     *
+     * @param _w unordered map to freeze
+     */
+    template <class _K, class _V, class _Hash, class _KeyEqual, class _Alloc, class _MT>
+    frozen_umap<_K, _V, _Hash, _KeyEqual> freeze(wrapper<std::unordered_map<_K, _V, _Hash, _KeyEqual, _Alloc>, _MT> &_w)
+    {
+        auto access = _w.get_shared_access();
+        return frozen_umap<_K, _V, _Hash, _KeyEqual>(*access);
+    }
+};
@@ -0,0 +1,191 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 11:41
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Immutable, perfectly hashed snapshot of an unordered set for read-only phases.
+*/
+
+#pragma once
+
+#include <unordered_set>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+#include "perfect_hash.hpp"
+#include "wrapper.hpp"
+
+namespace ts
+{
+    /**
+     * @brief immutable unordered set using a minimal perfect hash function over its keys.
+     * The keys are stored in one flat array, so every lookup takes exactly one probe
+     * (plus a search of the keys sharing its hash, if the hash collides, see frozen_umap).
+     * As with frozen_umap, a one byte fingerprint per key is checked first so most
+     * misses are reported without touching the key array.
+     *
+     * A frozen_uset never changes after construction, so any number of threads can read
+     * it simultaneously without any locking. Use ts::freeze() to create one from a
+     * ts::uset and thaw() to turn it back into a mutable std::unordered_set.
+     *
+     * @tparam _K key type
+     * @tparam _Hash key hash function (same semantics as for std::unordered_set)
+     * @tparam _KeyEqual key equality predicate
+     */
+    template <class _K, class _Hash = std::hash<_K>, class _KeyEqual = std::equal_to<_K>>
+    class frozen_uset
+    {
+    public:
+        typedef _K key_type;
+        typedef _K value_type;
+        typedef _Hash hasher;
+        typedef _KeyEqual key_equal;
+        typedef std::size_t size_type;
+        typedef typename std::vector<_K>::const_iterator const_iterator;
+        typedef const_iterator iterator;
+
+    private:
+        perfect_hash __phf;
+        // fingerprints of the first __phf.size() keys, one per distinct hash
+        std::vector<std::uint8_t> __fingerprints;
+        // hashes of the keys after the first __phf.size() ones, whose hashes collide with another key's
+        std::vector<std::uint64_t> __overflow;
+        std::vector<_K> __keys;
+        _Hash __hash;
+        _KeyEqual __equal;
+
+        static std::uint8_t __fingerprint(std::uint64_t _hash) noexcept
+        {
+            return static_cast<std::uint8_t>(_hash >> 56);
+        }
+
+        /**
+         * @return size_type slot holding _key or size() if there is none
+         */
+        size_type __slot(const _K &_key) const
+        {
+            if (__keys.empty())
+                return 0;
+            std::uint64_t hash = mix_hash(__hash(_key));
+            size_type slot = __phf(hash);
+            if (__fingerprints[slot] != __fingerprint(hash))
+                return __keys.size();
+            if (__equal(__keys[slot], _key))
+                return slot;
+
+            // another key with the same hash may be stored in the overflow range
+            auto range = std::equal_range(__overflow.begin(), __overflow.end(), hash);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                slot = __phf.size() + static_cast<size_type>(it - __overflow.begin());
+                if (__equal(__keys[slot], _key))
+                    return slot;
+            }
+            return __keys.size();
+        }
+
+    public:
+        frozen_uset() = default;
+
+        /**
+         * @brief creates a frozen copy of an unordered set. Keys whose hashes collide are
+         * supported, but every additional key sharing a hash makes lookups of that hash slower.
+         */
+        template <class _Alloc>
+        explicit frozen_uset(const std::unordered_set<_K, _Hash, _KeyEqual, _Alloc> &_source)
+            : __hash(_source.hash_function()),
+            __equal(_source.key_eq())
+        {
+            std::vector<const _K *> elements;
+            std::vector<std::uint64_t> hashes;
+            elements.reserve(_source.size());
+            hashes.reserve(_source.size());
+            for (const auto &element : _source)
+            {
+                elements.push_back(&element);
+                hashes.push_back(mix_hash(__hash(element)));
+            }
+
+            __phf = perfect_hash(hashes);
+            std::vector<size_type> order = __detail::__frozen_order(__phf, hashes, __overflow);
+
+            __fingerprints.resize(__phf.size());
+            for (size_type slot = 0; slot < __phf.size(); slot++)
+                __fingerprints[slot] = __fingerprint(hashes[order[slot]]);
+
+            __keys.reserve(elements.size());
+            for (size_type i : order)
+                __keys.push_back(*elements[i]);
+        }
+
+        size_type size() const noexcept
+        {
+            return __keys.size();
+        }
+        bool empty() const noexcept
+        {
+            return __keys.empty();
+        }
+        hasher hash_function() const
+        {
+            return __hash;
+        }
+        key_equal key_eq() const
+        {
+            return __equal;
+        }
+
+        const_iterator begin() const
+        {
+            return __keys.begin();
+        }
+        const_iterator end() const
+        {
+            return __keys.end();
+        }
+
+        const_iterator find(const _K &_key) const
+        {
+            return __keys.begin() + static_cast<std::ptrdiff_t>(__slot(_key));
+        }
+
+        bool contains(const _K &_key) const
+        {
+            return __slot(_key) != __keys.size();
+        }
+        size_type count(const _K &_key) const
+        {
+            return contains(_key) ? 1 : 0;
+        }
+
+        /**
+         * @brief creates a mutable std::unordered_set with the same contents.
+         */
+        std::unordered_set<_K, _Hash, _KeyEqual> thaw() const
+        {
+            return std::unordered_set<_K, _Hash, _KeyEqual>(__keys.begin(), __keys.end(), __keys.size(), __hash, __equal);
+        }
+    };
+
+    /**
+     * @brief creates an immutable frozen_uset snapshot of a ts::uset, reading it with
+     * shared access. The snapshot can then be read by any number of threads without locking.
+     * To make the data mutable again, thaw() the snapshot and swap() it into a wrapper.
+     *
+     * @param _w unordered set to freeze
+     */
+    template <class _K, class _Hash, class _KeyEqual, class _Alloc, class _MT>
+    frozen_uset<_K, _Hash, _KeyEqual> freeze(wrapper<std::unordered_set<_K, _Hash, _KeyEqual, _Alloc>, _MT> &_w)
+    {
+        auto access = _w.get_shared_access();
+        return frozen_uset<_K, _Hash, _KeyEqual>(*access);
+    }
+};
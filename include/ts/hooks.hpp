@@ -0,0 +1,271 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 22:24
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Lock diagnostics hooks recording which call sites currently hold wrapper locks.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace ts
+{
+    /**
+     * @brief call site of a function, like std::source_location which is not available in C++17.
+     * Used as a defaulted argument, current() captures the location of the caller.
+     */
+    class source_location
+    {
+    private:
+        const char *__file = "unknown";
+        const char *__function = "unknown";
+        unsigned __line = 0;
+
+    public:
+        constexpr source_location() noexcept = default;
+
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+        static constexpr source_location current(const char *_file = __builtin_FILE(), const char *_function = __builtin_FUNCTION(), unsigned _line = __builtin_LINE()) noexcept
+#else
+        static constexpr source_location current(const char *_file = "unknown", const char *_function = "unknown", unsigned _line = 0) noexcept
+#endif
+        {
+            source_location location;
+            location.__file = _file;
+            location.__function = _function;
+            location.__line = _line;
+            return location;
+        }
+
+        constexpr const char *file_name() const noexcept
+        {
+            return __file;
+        }
+        constexpr const char *function_name() const noexcept
+        {
+            return __function;
+        }
+        constexpr unsigned line() const noexcept
+        {
+            return __line;
+        }
+    };
+
+    /**
+     * @brief a lock currently held by an accessor, see lock_holders()
+     */
+    struct lock_hold
+    {
+        // mutex of the wrapper (identifies the wrapper)
+        const void *mutex = nullptr;
+        // where the accessor was created (e.g. the get_exclusive_access() call)
+        source_location site;
+        std::thread::id thread;
+        bool exclusive = false;
+        // how long the lock has been held so far
+        std::chrono::nanoseconds held{0};
+    };
+
+    namespace __detail
+    {
+        /**
+         * @brief record of one held lock. Written by the holding thread behind a sequence
+         * counter, so other threads (the watchdog) can read consistent snapshots without locking.
+         */
+        struct __hold_slot
+        {
+            std::atomic<bool> claimed{false};
+            // odd while the holder is writing
+            std::atomic<std::uint64_t> sequence{0};
+            std::atomic<bool> active{false};
+            std::atomic<const void *> mutex{nullptr};
+            std::atomic<const char *> file{nullptr};
+            std::atomic<const char *> function{nullptr};
+            std::atomic<unsigned> line{0};
+            std::atomic<std::thread::id> thread{};
+            std::atomic<bool> exclusive{false};
+            // steady clock time the lock was taken
+            std::atomic<std::int64_t> since{0};
+
+            template <class _Fn>
+            void write(_Fn &&_fn) noexcept
+            {
+                std::uint64_t before = sequence.load(std::memory_order_relaxed);
+                sequence.store(before + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                _fn();
+                sequence.store(before + 2, std::memory_order_release);
+            }
+
+            /**
+             * @brief reads the slot into _hold if it records a held lock
+             * @return std::uint64_t sequence of the snapshot (identifies the acquisition), 0 if there is none
+             */
+            std::uint64_t read(lock_hold &_hold, std::int64_t _now) const noexcept
+            {
+                std::uint64_t before = sequence.load(std::memory_order_acquire);
+                if (before & 1)
+                    return 0;
+                bool is_active = active.load(std::memory_order_relaxed);
+                _hold.mutex = mutex.load(std::memory_order_relaxed);
+                _hold.site = source_location::current(file.load(std::memory_order_relaxed), function.load(std::memory_order_relaxed), line.load(std::memory_order_relaxed));
+                _hold.thread = thread.load(std::memory_order_relaxed);
+                _hold.exclusive = exclusive.load(std::memory_order_relaxed);
+                _hold.held = std::chrono::nanoseconds(_now - since.load(std::memory_order_relaxed));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (!is_active || sequence.load(std::memory_order_relaxed) != before)
+                    return 0;
+                return before;
+            }
+        };
+
+        /**
+         * @brief fixed table of hold records shared by all threads. If all slots are in use,
+         * further locks are simply not recorded.
+         */
+        struct __hold_table
+        {
+            static constexpr std::size_t capacity = 4096;
+            __hold_slot slots[capacity];
+
+            static __hold_table &instance()
+            {
+                static __hold_table table;
+                return table;
+            }
+
+            __hold_slot *claim() noexcept
+            {
+                // start at a per thread offset so threads don't contend on the same slots
+                thread_local std::size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id()) % capacity;
+                for (std::size_t i = 0; i < capacity; i++)
+                {
+                    __hold_slot &slot = slots[(hint + i) % capacity];
+                    bool expected = false;
+                    if (!slot.claimed.load(std::memory_order_relaxed) && slot.claimed.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                    {
+                        hint = (hint + i) % capacity;
+                        return &slot;
+                    }
+                }
+                return nullptr;
+            }
+        };
+
+        inline std::int64_t __steady_now() noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /**
+         * @brief owned by an accessor, records the lock it holds in the hold table
+         */
+        class __hold_token
+        {
+        private:
+            __hold_slot *__slot = nullptr;
+
+        public:
+            __hold_token() = default;
+            __hold_token(__hold_token &&_other) noexcept
+                : __slot(_other.__slot)
+            {
+                _other.__slot = nullptr;
+            }
+            __hold_token &operator=(__hold_token &&_other) noexcept
+            {
+                if (this != &_other)
+                {
+                    end();
+                    __slot = _other.__slot;
+                    _other.__slot = nullptr;
+                }
+                return *this;
+            }
+            ~__hold_token()
+            {
+                end();
+            }
+
+            void begin(const void *_mutex, const source_location &_site, bool _exclusive) noexcept
+            {
+                end();
+                __slot = __hold_table::instance().claim();
+                if (__slot == nullptr)
+                    return;
+                std::int64_t now = __steady_now();
+                __slot->write([&]
+                {
+                    __slot->mutex.store(_mutex, std::memory_order_relaxed);
+                    __slot->file.store(_site.file_name(), std::memory_order_relaxed);
+                    __slot->function.store(_site.function_name(), std::memory_order_relaxed);
+                    __slot->line.store(_site.line(), std::memory_order_relaxed);
+                    __slot->thread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+                    __slot->exclusive.store(_exclusive, std::memory_order_relaxed);
+                    __slot->since.store(now, std::memory_order_relaxed);
+                    __slot->active.store(true, std::memory_order_relaxed);
+                });
+            }
+
+            void end() noexcept
+            {
+                if (__slot == nullptr)
+                    return;
+                __slot->write([&]
+                {
+                    __slot->active.store(false, std::memory_order_relaxed);
+                });
+                __slot->claimed.store(false, std::memory_order_release);
+                __slot = nullptr;
+            }
+        };
+
+        /**
+         * @brief calls _fn(hold, sequence) for every lock currently held
+         */
+        template <class _Fn>
+        void __for_each_hold(_Fn &&_fn)
+        {
+            std::int64_t now = __steady_now();
+            __hold_table &table = __hold_table::instance();
+            for (std::size_t i = 0; i < __hold_table::capacity; i++)
+            {
+                if (!table.slots[i].claimed.load(std::memory_order_relaxed))
+                    continue;
+                lock_hold hold;
+                if (std::uint64_t sequence = table.slots[i].read(hold, now))
+                    _fn(hold, i, sequence);
+            }
+        }
+    };
+
+    /**
+     * @brief locks of wrappers currently held by accessors, optionally only those of the wrapper
+     * whose mutex is _mutex. Locks are only recorded if TS_STL_LOCK_DIAGNOSTICS is defined for
+     * the whole build, in that case get_exclusive_access(), get_shared_access() and
+     * get_shared_lease() capture their call site and the time the lock was taken.
+     */
+    inline std::vector<lock_hold> lock_holders(const void *_mutex = nullptr)
+    {
+        std::vector<lock_hold> holds;
+        __detail::__for_each_hold([&](const lock_hold &_hold, std::size_t, std::uint64_t)
+        {
+            if (_mutex == nullptr || _hold.mutex == _mutex)
+                holds.push_back(_hold);
+        });
+        return holds;
+    }
+};
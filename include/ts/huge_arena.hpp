@@ -0,0 +1,430 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 21:52
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Huge page backed arena allocator for very large containers (POSIX only).
+*/
+
+#pragma once
+
+#include <map>
+#include <new>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <unordered_map>
+
+#include <sys/mman.h>
+
+#include "wrapper.hpp"
+
+namespace ts
+{
+    /**
+     * @brief kind of pages backing memory of a huge_arena
+     */
+    enum class page_kind
+    {
+        // explicitly reserved huge pages (hugetlbfs pool, MAP_HUGETLB)
+        hugetlb,
+        // normal memory the kernel was asked to back with transparent huge pages (MADV_HUGEPAGE)
+        // while they are enabled. The kernel only backs it on first touch and may still fall
+        // back to normal pages, see huge_arena::transparent_huge_bytes()
+        transparent,
+        // normal pages
+        normal,
+    };
+
+    /**
+     * @brief bytes of a huge_arena by the kind of pages backing them
+     */
+    struct huge_arena_stats
+    {
+        std::size_t hugetlb_bytes = 0;
+        std::size_t transparent_bytes = 0;
+        std::size_t normal_bytes = 0;
+        // bytes handed out and not yet returned
+        std::size_t allocated_bytes = 0;
+    };
+
+    /**
+     * @brief memory arena backed by 2 MB huge pages to reduce TLB misses of very large containers.
+     * Memory is mapped in large chunks, first trying the reserved huge page pool (MAP_HUGETLB), then
+     * normal memory aligned to huge pages with MADV_HUGEPAGE so the kernel uses transparent huge pages,
+     * and plain normal pages if neither is available. stats() tells which one was used. Memory only
+     * counts as transparent if transparent huge pages are enabled in
+     * /sys/kernel/mm/transparent_hugepage/enabled, and transparent_huge_bytes() reports how much
+     * of it the kernel really backs with huge pages.
+     *
+     * Small blocks (container nodes) are carved from the chunks and recycled through free lists per
+     * size class, so the nodes of a container stay packed into few huge pages. Blocks of a huge page
+     * or more (bucket arrays) get a mapping of their own that is unmapped again when freed.
+     * All memory is unmapped when the arena is destroyed. It is thread safe.
+     */
+    class huge_arena
+    {
+    public:
+        static constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+    private:
+        static constexpr std::size_t __alignment = 16;
+        static constexpr std::size_t __small_limit = 4096;
+        static constexpr std::size_t __small_classes = __small_limit / __alignment;
+
+        struct __free_block
+        {
+            __free_block *next;
+        };
+
+        struct __mapping
+        {
+            void *address;
+            std::size_t size;
+            page_kind kind;
+        };
+
+        std::mutex __mutex;
+        std::size_t __chunk_size;
+        bool __use_hugetlb;
+
+        std::vector<__mapping> __chunks;
+        char *__top = nullptr;
+        char *__end = nullptr;
+        // exact 16 byte classes up to __small_limit, then powers of two up to the huge page size
+        __free_block *__free[__small_classes + 10] = {};
+        std::unordered_map<void *, __mapping> __large;
+        huge_arena_stats __stats;
+
+        static std::size_t __round_up(std::size_t _value, std::size_t _to) noexcept
+        {
+            return (_value + _to - 1) / _to * _to;
+        }
+
+        /**
+         * @brief size class of a block of _bytes, and the size of blocks of that class
+         */
+        static std::size_t __class_of(std::size_t _bytes, std::size_t &_size) noexcept
+        {
+            if (_bytes <= __small_limit)
+            {
+                _size = __round_up(_bytes == 0 ? 1 : _bytes, __alignment);
+                return _size / __alignment - 1;
+            }
+            std::size_t index = __small_classes;
+            for (_size = __small_limit * 2; _size < _bytes; _size *= 2)
+                index++;
+            return index;
+        }
+
+        void __account(page_kind _kind, std::ptrdiff_t _bytes) noexcept
+        {
+            switch (_kind)
+            {
+            case page_kind::hugetlb:
+                __stats.hugetlb_bytes += _bytes;
+                break;
+            case page_kind::transparent:
+                __stats.transparent_bytes += _bytes;
+                break;
+            case page_kind::normal:
+                __stats.normal_bytes += _bytes;
+                break;
+            }
+        }
+
+        /**
+         * @brief whether the kernel may back MADV_HUGEPAGE memory with transparent huge pages
+         * (the selected mode in /sys/kernel/mm/transparent_hugepage/enabled is not "never")
+         */
+        static bool __transparent_enabled()
+        {
+            static const bool enabled = []
+            {
+                std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+                std::string modes;
+                if (!std::getline(file, modes))
+                    return false;
+                return modes.find("[always]") != std::string::npos || modes.find("[madvise]") != std::string::npos;
+            }();
+            return enabled;
+        }
+
+        /**
+         * @brief maps _bytes (a multiple of the huge page size) with the best kind of pages available
+         */
+        __mapping __map(std::size_t _bytes)
+        {
+#ifdef MAP_HUGETLB
+            if (__use_hugetlb)
+            {
+                void *address = mmap(nullptr, _bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (address != MAP_FAILED)
+                    return {address, _bytes, page_kind::hugetlb};
+            }
+#endif
+            // over-map to be able to align to a huge page boundary
+            std::size_t span = _bytes + huge_page_size;
+            void *raw = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED)
+                throw std::bad_alloc();
+            char *begin = reinterpret_cast<char *>(__round_up(reinterpret_cast<std::uintptr_t>(raw), huge_page_size));
+            char *end = begin + _bytes;
+            if (begin != raw)
+                munmap(raw, begin - static_cast<char *>(raw));
+            if (end != static_cast<char *>(raw) + span)
+                munmap(end, static_cast<char *>(raw) + span - end);
+
+#ifdef MADV_HUGEPAGE
+            // madvise also succeeds if transparent huge pages are disabled system wide
+            if (madvise(begin, _bytes, MADV_HUGEPAGE) == 0 && __transparent_enabled())
+                return {begin, _bytes, page_kind::transparent};
+#endif
+            return {begin, _bytes, page_kind::normal};
+        }
+
+        void *__allocate_small(std::size_t _size)
+        {
+            if (static_cast<std::size_t>(__end - __top) < _size)
+            {
+                // the rest of the current chunk is left unused
+                __mapping chunk = __map(__chunk_size);
+                __chunks.push_back(chunk);
+                __account(chunk.kind, chunk.size);
+                __top = static_cast<char *>(chunk.address);
+                __end = __top + chunk.size;
+            }
+            void *block = __top;
+            __top += _size;
+            return block;
+        }
+
+    public:
+        /**
+         * @param _chunk_size size of the chunks small blocks are carved from (rounded up to huge pages)
+         * @param _use_hugetlb whether to try the reserved huge page pool before transparent huge pages
+         */
+        huge_arena(std::size_t _chunk_size = std::size_t(64) << 20, bool _use_hugetlb = true)
+            : __chunk_size(__round_up(_chunk_size == 0 ? 1 : _chunk_size, huge_page_size)),
+            __use_hugetlb(_use_hugetlb)
+        {
+        }
+
+        ~huge_arena()
+        {
+            for (const __mapping &chunk : __chunks)
+                munmap(chunk.address, chunk.size);
+            for (const auto &[address, mapping] : __large)
+                munmap(mapping.address, mapping.size);
+        }
+
+        huge_arena(const huge_arena &) = delete;
+        huge_arena &operator=(const huge_arena &) = delete;
+
+        /**
+         * @brief process-wide arena used by default constructed arena_allocators
+         */
+        static const std::shared_ptr<huge_arena> &shared()
+        {
+            static const std::shared_ptr<huge_arena> arena = std::make_shared<huge_arena>();
+            return arena;
+        }
+
+        /**
+         * @brief returns a 16 byte aligned block of at least _bytes
+         */
+        void *allocate(std::size_t _bytes)
+        {
+            std::lock_guard lock(__mutex);
+            if (_bytes >= huge_page_size)
+            {
+                __mapping mapping = __map(__round_up(_bytes, huge_page_size));
+                __large.emplace(mapping.address, mapping);
+                __account(mapping.kind, mapping.size);
+                __stats.allocated_bytes += mapping.size;
+                return mapping.address;
+            }
+
+            std::size_t size;
+            std::size_t index = __class_of(_bytes, size);
+            __stats.allocated_bytes += size;
+            if (__free_block *block = __free[index])
+            {
+                __free[index] = block->next;
+                return block;
+            }
+            return __allocate_small(size);
+        }
+
+        /**
+         * @brief returns a block of _bytes allocated from this arena
+         */
+        void deallocate(void *_block, std::size_t _bytes) noexcept
+        {
+            std::lock_guard lock(__mutex);
+            if (_bytes >= huge_page_size)
+            {
+                auto it = __large.find(_block);
+                if (it == __large.end())
+                    return;
+                munmap(it->second.address, it->second.size);
+                __account(it->second.kind, -static_cast<std::ptrdiff_t>(it->second.size));
+                __stats.allocated_bytes -= it->second.size;
+                __large.erase(it);
+                return;
+            }
+
+            std::size_t size;
+            std::size_t index = __class_of(_bytes, size);
+            __stats.allocated_bytes -= size;
+            __free_block *block = static_cast<__free_block *>(_block);
+            block->next = __free[index];
+            __free[index] = block;
+        }
+
+        huge_arena_stats stats()
+        {
+            std::lock_guard lock(__mutex);
+            return __stats;
+        }
+
+        /**
+         * @brief bytes of the transparent memory that the kernel currently backs with huge pages,
+         * according to AnonHugePages in /proc/self/smaps. Pages are only backed once touched,
+         * so this grows as the arena is used. The kernel may merge a mapping with neighbouring
+         * memory, so the huge pages of such a merged area are attributed to the arena up to its
+         * own size. This parses smaps and is meant for diagnostics, not for frequent polling.
+         *
+         * @return std::size_t 0 if smaps can't be read
+         */
+        std::size_t transparent_huge_bytes()
+        {
+            std::vector<std::pair<std::uintptr_t, std::uintptr_t>> ranges;
+            {
+                std::lock_guard lock(__mutex);
+                auto add = [&](const __mapping &_m)
+                {
+                    if (_m.kind == page_kind::transparent)
+                        ranges.emplace_back(reinterpret_cast<std::uintptr_t>(_m.address), reinterpret_cast<std::uintptr_t>(_m.address) + _m.size);
+                };
+                for (const __mapping &chunk : __chunks)
+                    add(chunk);
+                for (const auto &[address, mapping] : __large)
+                    add(mapping);
+            }
+            if (ranges.empty())
+                return 0;
+
+            std::ifstream smaps("/proc/self/smaps");
+            std::string line;
+            std::size_t total = 0;
+            // bytes of the current area that belong to the arena
+            std::size_t overlap = 0;
+            while (std::getline(smaps, line))
+            {
+                // area headers look like "7f0000000000-7f0000200000 rw-p ...", fields like "AnonHugePages:  2048 kB"
+                char *dash;
+                std::uintptr_t begin = std::strtoull(line.c_str(), &dash, 16);
+                if (*dash == '-' && dash != line.c_str())
+                {
+                    std::uintptr_t end = std::strtoull(dash + 1, nullptr, 16);
+                    overlap = 0;
+                    for (const auto &[r_begin, r_end] : ranges)
+                        if (r_begin < end && begin < r_end)
+                            overlap += std::min(end, r_end) - std::max(begin, r_begin);
+                }
+                else if (overlap != 0 && line.compare(0, 14, "AnonHugePages:") == 0)
+                {
+                    std::size_t huge = std::strtoull(line.c_str() + 14, nullptr, 10) * 1024;
+                    total += std::min(huge, overlap);
+                }
+            }
+            return total;
+        }
+    };
+
+    /**
+     * @brief allocator taking its memory from a huge_arena. Default constructed ones use the
+     * process-wide huge_arena::shared(), containers can also be given an arena of their own.
+     *
+     * @tparam _T value type
+     */
+    template <class _T>
+    class arena_allocator
+    {
+        template <class _U>
+        friend class arena_allocator;
+
+    private:
+        std::shared_ptr<huge_arena> __arena;
+
+    public:
+        typedef _T value_type;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        arena_allocator()
+            : __arena(huge_arena::shared())
+        {
+        }
+        arena_allocator(std::shared_ptr<huge_arena> _arena) noexcept
+            : __arena(std::move(_arena))
+        {
+        }
+        // no moves, a moved-from container still has to be able to allocate from the arena
+        arena_allocator(const arena_allocator &) = default;
+        arena_allocator &operator=(const arena_allocator &) = default;
+        template <class _U>
+        arena_allocator(const arena_allocator<_U> &_other) noexcept
+            : __arena(_other.__arena)
+        {
+        }
+
+        _T *allocate(std::size_t _n)
+        {
+            static_assert(alignof(_T) <= 16, "ts-stl/arena_allocator over-aligned types are not supported");
+            return static_cast<_T *>(__arena->allocate(_n * sizeof(_T)));
+        }
+
+        void deallocate(_T *_pointer, std::size_t _n) noexcept
+        {
+            __arena->deallocate(_pointer, _n * sizeof(_T));
+        }
+
+        const std::shared_ptr<huge_arena> &arena() const noexcept
+        {
+            return __arena;
+        }
+
+        template <class _U>
+        bool operator==(const arena_allocator<_U> &_other) const noexcept
+        {
+            return __arena == _other.__arena;
+        }
+        template <class _U>
+        bool operator!=(const arena_allocator<_U> &_other) const noexcept
+        {
+            return __arena != _other.__arena;
+        }
+    };
+
+    // wrappers backed by huge pages
+
+    template <class _K, class _V, class _Hash = std::hash<_K>, class _Eq = std::equal_to<_K>>
+    using huge_umap = wrapper<std::unordered_map<_K, _V, _Hash, _Eq, arena_allocator<std::pair<const _K, _V>>>>;
+
+    template <class _K, class _V, class _Cmp = std::less<_K>>
+    using huge_map = wrapper<std::map<_K, _V, _Cmp, arena_allocator<std::pair<const _K, _V>>>>;
+};
@@ -0,0 +1,239 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 16:14
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Left-right concurrency control: two instances of a container with wait-free readers.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <chrono>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#include "except.hpp"
+
+namespace ts
+{
+    /**
+     * @brief keeps two instances of a container (left and right) so readers never block.
+     * Readers always read the instance that is currently published, which is wait-free: they
+     * only increment and decrement a per-thread read indicator. A single writer at a time
+     * applies its modification to the other instance, publishes it, waits for readers still on
+     * the old instance to drain and then replays the same modification on the old instance.
+     *
+     * Unlike copy-on-write (RCU), updates don't copy the whole container, so this suits large
+     * containers that are read a lot and modified occasionally, at the cost of twice the memory
+     * and every modification being done twice.
+     *
+     * Usage:
+     * @code
+     * ts::left_right<std::unordered_map<int, std::string>> lr;
+     * lr.write([](auto &_m) { _m[1] = "one"; });
+     * auto size = lr.read([](const auto &_m) { return _m.size(); });
+     * @endcode
+     *
+     * @tparam _T container type (copy assignable, a failed modification is undone by copying)
+     */
+    template <class _T>
+    class left_right
+    {
+        static_assert(std::is_copy_assignable_v<_T>, "ts::left_right requires a copy assignable container type");
+
+    private:
+        struct alignas(64) __counter
+        {
+            std::atomic<std::int64_t> value{0};
+        };
+
+        _T __instances[2];
+        // instance readers are currently directed to
+        std::atomic<unsigned> __left_right{0};
+        // read indicator new readers arrive at
+        std::atomic<unsigned> __version_index{0};
+        std::unique_ptr<__counter[]> __read_indicators[2];
+        std::size_t __stripes;
+
+        std::timed_mutex __writer_mutex;
+        std::chrono::milliseconds __lock_timeout{10000};
+
+        std::size_t __reader_stripe() const
+        {
+            static std::atomic<std::size_t> next{0};
+            thread_local std::size_t stripe = next.fetch_add(1, std::memory_order_relaxed);
+            return stripe % __stripes;
+        }
+
+        bool __drained(unsigned _version) const
+        {
+            for (std::size_t i = 0; i < __stripes; i++)
+                if (__read_indicators[_version][i].value.load() != 0)
+                    return false;
+            return true;
+        }
+
+        void __wait_until_empty(unsigned _version) const
+        {
+            while (!__drained(_version))
+                std::this_thread::yield();
+        }
+
+        /**
+         * @brief makes new readers arrive at the other read indicator and waits for all
+         * readers that may still be reading the previously published instance.
+         */
+        void __toggle_version_and_wait()
+        {
+            unsigned previous = __version_index.load();
+            unsigned next = 1 - previous;
+            // readers from before the previous toggle have to be gone before reusing next
+            __wait_until_empty(next);
+            __version_index.store(next);
+            __wait_until_empty(previous);
+        }
+
+        void __lock_writer()
+        {
+            if (__lock_timeout.count() < 0)
+                __writer_mutex.lock();
+            else if (!__writer_mutex.try_lock_for(__lock_timeout))
+                throw lock_timeout_error("ts-stl/left_right write() timeout");
+        }
+
+    public:
+        /**
+         * @brief creates both instances as copies of _initial
+         */
+        explicit left_right(const _T &_initial = _T())
+            : __instances{_initial, _initial},
+            __stripes(std::max(1u, std::thread::hardware_concurrency()))
+        {
+            __read_indicators[0].reset(new __counter[__stripes]);
+            __read_indicators[1].reset(new __counter[__stripes]);
+        }
+
+        // readers and writers refer to the instances by address, so copying makes no sense
+        left_right(const left_right &) = delete;
+        left_right &operator=(const left_right &) = delete;
+
+        /**
+         * @brief Set the lock timeout used by writers waiting for another writer.
+         * If it is configured to a negative number (preferably -1) the timeout is disabled.
+         * Readers never wait.
+         *
+         * Default: 10000 ms
+         *
+         * @param _ms timeout value
+         */
+        void set_lock_timeout(std::chrono::milliseconds _ms)
+        {
+            __lock_timeout = _ms;
+        }
+
+        /**
+         * @brief calls _fn with a const reference to the published instance and returns its result.
+         * This never blocks. The reference must not be used after _fn returns, and _fn must not
+         * call write() on the same object (the writer would wait for this read forever).
+         */
+        template <class _Fn>
+        auto read(_Fn &&_fn) const -> decltype(_fn(std::declval<const _T &>()))
+        {
+            unsigned version = __version_index.load();
+            std::atomic<std::int64_t> &indicator = __read_indicators[version][__reader_stripe()].value;
+            indicator.fetch_add(1);
+
+            struct __depart
+            {
+                std::atomic<std::int64_t> &indicator;
+                ~__depart()
+                {
+                    indicator.fetch_sub(1);
+                }
+            } depart{indicator};
+
+            return _fn(static_cast<const _T &>(__instances[__left_right.load()]));
+        }
+
+        /**
+         * @brief applies _fn to both instances, one after the other, while readers keep reading
+         * the instance that is not being modified. Only one writer runs at a time, others wait
+         * (with the configured timeout, throwing ts::lock_timeout_error when exceeded).
+         *
+         * _fn is called twice and has to do exactly the same thing both times (e.g. it must
+         * not move from captured values). If the first call throws, the instance it was modifying
+         * is restored by copying the other one and the exception is rethrown, nothing has changed.
+         * If the second call (the replay) throws, the modification is already visible to readers,
+         * so the write counts as done: the replayed instance is overwritten with a copy of the
+         * published one and the exception is NOT rethrown.
+         *
+         * @return the result of the first call of _fn
+         */
+        template <class _Fn>
+        auto write(_Fn &&_fn) -> decltype(_fn(std::declval<_T &>()))
+        {
+            typedef decltype(_fn(std::declval<_T &>())) result_type;
+
+            __lock_writer();
+            std::lock_guard lock(__writer_mutex, std::adopt_lock);
+
+            unsigned published = __left_right.load();
+            unsigned other = 1 - published;
+            _T &first = __instances[other];
+            _T &second = __instances[published];
+
+            // no reader is on the instance being modified, so a failed modification can be undone
+            auto apply = [&]() -> result_type
+            {
+                try
+                {
+                    return _fn(first);
+                }
+                catch (...)
+                {
+                    first = second;
+                    throw;
+                }
+            };
+            // the modification is published already, a failed replay is repaired and ignored
+            auto replay = [&]()
+            {
+                try
+                {
+                    _fn(second);
+                }
+                catch (...)
+                {
+                    second = first;
+                }
+            };
+
+            if constexpr (std::is_void_v<result_type>)
+            {
+                apply();
+                __left_right.store(other);
+                __toggle_version_and_wait();
+                replay();
+            }
+            else
+            {
+                result_type result = apply();
+                __left_right.store(other);
+                __toggle_version_and_wait();
+                replay();
+                return result;
+            }
+        }
+    };
+};
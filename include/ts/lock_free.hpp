@@ -0,0 +1,357 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 18:03
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Lock-free wrappers for small trivially copyable values.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "wrapper.hpp"
+
+namespace ts
+{
+    /**
+     * @brief synchronization policy of a wrapper keeping its value in a lock-free std::atomic.
+     * Selected by atomic_wrapper for trivially copyable types if the platform has lock-free
+     * atomics of that size.
+     */
+    struct lock_free
+    {
+    };
+
+    /**
+     * @brief synchronization policy of a wrapper keeping its value behind a sequence lock:
+     * readers never write to shared memory and retry if a writer was active while they
+     * copied the value, writers are serialized by the sequence counter itself.
+     * Selected by atomic_wrapper for trivially copyable types that have no lock-free
+     * std::atomic (e.g. 16 byte structs without double word CAS).
+     */
+    struct seqlock
+    {
+    };
+
+    /**
+     * @brief wrapper holding a small trivially copyable value in a std::atomic. Instead of
+     * accessors it provides load(), store() and update(), none of which ever block or
+     * throw ts::lock_timeout_error.
+     *
+     * @tparam _T trivially copyable value type
+     */
+    template <class _T>
+    class wrapper<_T, lock_free>
+    {
+        static_assert(std::is_trivially_copyable_v<_T>, "ts-stl/wrapper lock_free requires a trivially copyable type");
+
+    private:
+        std::atomic<_T> __value;
+
+    public:
+        wrapper()
+            : __value(_T())
+        {
+        }
+        wrapper(const _T &_init)
+            : __value(_init)
+        {
+        }
+        wrapper(const wrapper &_other)
+            : __value(_other.load())
+        {
+        }
+        wrapper &operator=(const wrapper &_rhs)
+        {
+            store(_rhs.load());
+            return *this;
+        }
+
+        /**
+         * @brief does nothing, there is no lock to time out.
+         */
+        constexpr void set_lock_timeout(std::chrono::milliseconds) noexcept {}
+
+        /**
+         * @brief does nothing, there is no lock to time out.
+         */
+        constexpr void set_name(const char *) noexcept {}
+        constexpr const char *name() const noexcept
+        {
+            return "";
+        }
+
+        _T load() const noexcept
+        {
+            return __value.load();
+        }
+
+        void store(const _T &_value) noexcept
+        {
+            __value.store(_value);
+        }
+
+        /**
+         * @brief stores _value and returns the previous value
+         */
+        _T exchange(const _T &_value) noexcept
+        {
+            return __value.exchange(_value);
+        }
+
+        /**
+         * @brief stores _desired if the current value equals _expected (bytewise), otherwise
+         * loads the current value into _expected.
+         * @return bool true if _desired was stored
+         */
+        bool compare_exchange(_T &_expected, const _T &_desired) noexcept
+        {
+            return __value.compare_exchange_strong(_expected, _desired);
+        }
+
+        /**
+         * @brief atomically modifies the value by calling _fn with a reference to a copy of it
+         * and storing the copy back if the value has not changed in the meantime.
+         * Under contention _fn may be called multiple times, so it should have no side effects.
+         * @return _T the value stored
+         */
+        template <class _Fn>
+        _T update(_Fn &&_fn)
+        {
+            _T expected = __value.load();
+            _T desired;
+            do
+            {
+                desired = expected;
+                _fn(desired);
+            } while (!__value.compare_exchange_weak(expected, desired));
+            return desired;
+        }
+
+        /**
+         * @brief exchanges the value with _other
+         */
+        void swap(_T &_other) noexcept
+        {
+            _other = exchange(_other);
+        }
+    };
+
+    /**
+     * @brief wrapper holding a small trivially copyable value behind a seqlock. The value is
+     * stored in atomic words, so concurrent reads during a write are well defined and simply
+     * retried. It has the same interface as the lock_free wrapper and never throws
+     * ts::lock_timeout_error.
+     *
+     * @tparam _T trivially copyable value type
+     */
+    template <class _T>
+    class wrapper<_T, seqlock>
+    {
+        static_assert(std::is_trivially_copyable_v<_T>, "ts-stl/wrapper seqlock requires a trivially copyable type");
+
+    private:
+        static constexpr std::size_t __word_count = (sizeof(_T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+        // even: no writer, odd: a writer is modifying the words
+        std::atomic<std::uint64_t> __sequence{0};
+        std::atomic<std::uint64_t> __words[__word_count];
+
+        _T __read_words() const noexcept
+        {
+            std::uint64_t buffer[__word_count];
+            for (std::size_t i = 0; i < __word_count; i++)
+                buffer[i] = __words[i].load(std::memory_order_relaxed);
+            _T value;
+            std::memcpy(&value, buffer, sizeof(_T));
+            return value;
+        }
+
+        void __write_words(const _T &_value) noexcept
+        {
+            std::uint64_t buffer[__word_count] = {};
+            std::memcpy(buffer, &_value, sizeof(_T));
+            for (std::size_t i = 0; i < __word_count; i++)
+                __words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief makes the sequence odd, waiting for other writers
+         * @return std::uint64_t the (even) sequence before
+         */
+        std::uint64_t __begin_write() noexcept
+        {
+            for (unsigned spins = 0;; spins++)
+            {
+                std::uint64_t sequence = __sequence.load(std::memory_order_relaxed);
+                if ((sequence & 1) == 0 && __sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire))
+                {
+                    // the odd sequence has to be visible before any of the words change
+                    std::atomic_thread_fence(std::memory_order_release);
+                    return sequence;
+                }
+                if (spins >= 64)
+                    std::this_thread::yield();
+            }
+        }
+
+        void __end_write(std::uint64_t _sequence) noexcept
+        {
+            __sequence.store(_sequence + 2, std::memory_order_release);
+        }
+
+    public:
+        wrapper()
+        {
+            __write_words(_T());
+        }
+        wrapper(const _T &_init)
+        {
+            __write_words(_init);
+        }
+        wrapper(const wrapper &_other)
+        {
+            __write_words(_other.load());
+        }
+        wrapper &operator=(const wrapper &_rhs)
+        {
+            store(_rhs.load());
+            return *this;
+        }
+
+        /**
+         * @brief does nothing, there is no lock to time out.
+         */
+        constexpr void set_lock_timeout(std::chrono::milliseconds) noexcept {}
+
+        /**
+         * @brief does nothing, there is no lock to time out.
+         */
+        constexpr void set_name(const char *) noexcept {}
+        constexpr const char *name() const noexcept
+        {
+            return "";
+        }
+
+        _T load() const noexcept
+        {
+            for (;;)
+            {
+                std::uint64_t before = __sequence.load(std::memory_order_acquire);
+                if (before & 1)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                _T value = __read_words();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (__sequence.load(std::memory_order_relaxed) == before)
+                    return value;
+            }
+        }
+
+        void store(const _T &_value) noexcept
+        {
+            std::uint64_t sequence = __begin_write();
+            __write_words(_value);
+            __end_write(sequence);
+        }
+
+        /**
+         * @brief stores _value and returns the previous value
+         */
+        _T exchange(const _T &_value) noexcept
+        {
+            std::uint64_t sequence = __begin_write();
+            _T previous = __read_words();
+            __write_words(_value);
+            __end_write(sequence);
+            return previous;
+        }
+
+        /**
+         * @brief stores _desired if the current value equals _expected (bytewise), otherwise
+         * loads the current value into _expected.
+         * @return bool true if _desired was stored
+         */
+        bool compare_exchange(_T &_expected, const _T &_desired) noexcept
+        {
+            std::uint64_t sequence = __begin_write();
+            _T current = __read_words();
+            bool equal = std::memcmp(&current, &_expected, sizeof(_T)) == 0;
+            if (equal)
+                __write_words(_desired);
+            else
+                _expected = current;
+            __end_write(sequence);
+            return equal;
+        }
+
+        /**
+         * @brief modifies the value by calling _fn with a reference to a copy of it, while
+         * holding the write side of the seqlock. _fn is called exactly once.
+         * @return _T the value stored
+         */
+        template <class _Fn>
+        _T update(_Fn &&_fn)
+        {
+            std::uint64_t sequence = __begin_write();
+            _T value = __read_words();
+            try
+            {
+                _fn(value);
+            }
+            catch (...)
+            {
+                __end_write(sequence);
+                throw;
+            }
+            __write_words(value);
+            __end_write(sequence);
+            return value;
+        }
+
+        /**
+         * @brief exchanges the value with _other
+         */
+        void swap(_T &_other) noexcept
+        {
+            _other = exchange(_other);
+        }
+    };
+
+    namespace __detail
+    {
+        template <class _T>
+        struct __atomic_policy_for
+        {
+            static_assert(std::is_trivially_copyable_v<_T> && std::is_default_constructible_v<_T> && !std::is_array_v<_T>,
+                          "ts-stl/atomic_wrapper requires a default constructible, trivially copyable non-array type");
+            typedef std::conditional_t<std::atomic<_T>::is_always_lock_free, lock_free, seqlock> type;
+        };
+    };
+
+    /**
+     * @brief wrapper of a small trivially copyable value without a mutex: the value is kept in
+     * a std::atomic if that is lock-free on the platform (ts::lock_free), or behind a seqlock
+     * otherwise (ts::seqlock). Instead of accessors it provides load(), store(), exchange(),
+     * compare_exchange() and update(). Plain ts::wrapper<_T> keeps using default_mutex and
+     * accessors for all types.
+     *
+     * @tparam _T trivially copyable value type, e.g. a counter or a small struct
+     */
+    template <class _T>
+    using atomic_wrapper = wrapper<_T, typename __detail::__atomic_policy_for<_T>::type>;
+};
@@ -0,0 +1,335 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 23:46
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Lock order checking: detects potential deadlocks between wrappers from the order they are locked in.
+*/
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <utility>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "hooks.hpp"
+
+namespace ts
+{
+    /**
+     * @brief a thread locked the wrapper whose mutex is to while holding the one whose mutex is from
+     */
+    struct lock_order_edge
+    {
+        const void *from = nullptr;
+        const void *to = nullptr;
+        // names of the wrappers (see wrapper::set_name()), empty if they have none
+        std::string from_name;
+        std::string to_name;
+        // where the held lock was taken and where the second one was requested
+        source_location from_site;
+        source_location to_site;
+        bool from_exclusive = false;
+        bool to_exclusive = false;
+        // the thread that first locked in this order
+        std::thread::id thread;
+    };
+
+    /**
+     * @brief wrappers locked in orders that contradict each other. Every edge goes from one
+     * wrapper to the next and the last edge leads back to the first one, so threads following
+     * these orders at the same time can deadlock.
+     */
+    struct lock_order_cycle
+    {
+        std::vector<lock_order_edge> edges;
+    };
+
+    /**
+     * @brief writes _cycle to stderr, the default report of the lock order check
+     */
+    inline void print_lock_order_cycle(const lock_order_cycle &_cycle)
+    {
+        auto describe = [](const void *_mutex, const std::string &_name, bool _exclusive, const source_location &_site)
+        {
+            std::ostringstream text;
+            if (!_name.empty())
+                text << "'" << _name << "' ";
+            text << "(" << _mutex << ") " << (_exclusive ? "exclusive" : "shared")
+                 << " at " << _site.file_name() << ":" << _site.line() << " (" << _site.function_name() << ")";
+            return text.str();
+        };
+
+        std::ostringstream report;
+        report << "ts-stl/lock_order potential deadlock, " << _cycle.edges.size() << " wrappers locked in a cycle:\n";
+        for (const lock_order_edge &edge : _cycle.edges)
+            report << "    thread " << edge.thread << " held " << describe(edge.from, edge.from_name, edge.from_exclusive, edge.from_site)
+                   << "\n        and locked " << describe(edge.to, edge.to_name, edge.to_exclusive, edge.to_site) << "\n";
+        std::fputs(report.str().c_str(), stderr);
+    }
+
+    namespace __detail
+    {
+        /**
+         * @brief a lock held by the current thread
+         */
+        struct __held_lock
+        {
+            const void *mutex;
+            source_location site;
+            bool exclusive;
+        };
+
+        /**
+         * @brief process-wide graph of the orders wrappers have been locked in
+         */
+        struct __order_graph
+        {
+            std::mutex mutex;
+            // edges by their from and to mutex
+            std::unordered_map<const void *, std::unordered_map<const void *, lock_order_edge>> edges;
+            std::unordered_map<const void *, std::string> names;
+            std::vector<lock_order_cycle> cycles;
+            std::function<void(const lock_order_cycle &)> reporter;
+            // incremented when mutexes are forgotten, invalidates the per-thread edge caches
+            std::atomic<std::uint64_t> generation{0};
+
+            static __order_graph &instance()
+            {
+                static __order_graph graph;
+                return graph;
+            }
+
+            /**
+             * @brief finds a path of edges from _from to _to (breadth first, so a shortest one)
+             */
+            bool find_path(const void *_from, const void *_to, std::vector<lock_order_edge> &_path)
+            {
+                std::unordered_map<const void *, const lock_order_edge *> reached_by;
+                std::vector<const void *> queue{_from};
+                reached_by[_from] = nullptr;
+                for (std::size_t i = 0; i < queue.size(); i++)
+                {
+                    auto it = edges.find(queue[i]);
+                    if (it == edges.end())
+                        continue;
+                    for (auto &[next, edge] : it->second)
+                    {
+                        if (reached_by.count(next))
+                            continue;
+                        reached_by[next] = &edge;
+                        if (next == _to)
+                        {
+                            for (const void *at = _to; at != _from; at = reached_by[at]->from)
+                                _path.push_back(*reached_by[at]);
+                            std::reverse(_path.begin(), _path.end());
+                            return true;
+                        }
+                        queue.push_back(next);
+                    }
+                }
+                return false;
+            }
+        };
+
+        inline std::vector<__held_lock> &__held_locks()
+        {
+            thread_local std::vector<__held_lock> held;
+            return held;
+        }
+
+        /**
+         * @brief records that the current thread is about to lock _mutex while holding its other
+         * locks and reports cycles this closes. Called before waiting, so a deadlock that
+         * actually happens is reported as well.
+         */
+        inline void __order_acquiring(const void *_mutex, const source_location &_site, bool _exclusive)
+        {
+            std::vector<__held_lock> &held = __held_locks();
+            if (held.empty())
+                return;
+
+            // edges this thread already knows to be in the graph, so they cost no global lock
+            thread_local std::unordered_map<const void *, std::unordered_set<const void *>> known;
+            thread_local std::uint64_t known_generation = 0;
+            __order_graph &graph = __order_graph::instance();
+            std::uint64_t generation = graph.generation.load(std::memory_order_acquire);
+            if (generation != known_generation)
+            {
+                known.clear();
+                known_generation = generation;
+            }
+
+            std::vector<lock_order_cycle> found;
+            for (const __held_lock &lock : held)
+            {
+                // recursive shared locking of the same wrapper is not an ordering problem
+                if (lock.mutex == _mutex)
+                    continue;
+                std::unordered_set<const void *> &known_from = known[lock.mutex];
+                if (known_from.count(_mutex))
+                    continue;
+
+                std::lock_guard guard(graph.mutex);
+                auto &from = graph.edges[lock.mutex];
+                if (from.count(_mutex))
+                {
+                    known_from.insert(_mutex);
+                    continue;
+                }
+
+                lock_order_edge edge;
+                edge.from = lock.mutex;
+                edge.to = _mutex;
+                edge.from_site = lock.site;
+                edge.to_site = _site;
+                edge.from_exclusive = lock.exclusive;
+                edge.to_exclusive = _exclusive;
+                edge.thread = std::this_thread::get_id();
+                auto name = graph.names.find(lock.mutex);
+                if (name != graph.names.end())
+                    edge.from_name = name->second;
+                name = graph.names.find(_mutex);
+                if (name != graph.names.end())
+                    edge.to_name = name->second;
+
+                lock_order_cycle cycle;
+                if (graph.find_path(_mutex, lock.mutex, cycle.edges))
+                {
+                    cycle.edges.push_back(edge);
+                    graph.cycles.push_back(cycle);
+                    found.push_back(std::move(cycle));
+                }
+                from.emplace(_mutex, std::move(edge));
+                known_from.insert(_mutex);
+            }
+
+            // reported without holding the graph lock, the reporter may lock wrappers itself
+            if (!found.empty())
+            {
+                std::function<void(const lock_order_cycle &)> reporter;
+                {
+                    std::lock_guard guard(graph.mutex);
+                    reporter = graph.reporter;
+                }
+                for (const lock_order_cycle &cycle : found)
+                {
+                    if (reporter)
+                        reporter(cycle);
+                    else
+                        print_lock_order_cycle(cycle);
+                }
+            }
+        }
+
+        inline void __order_acquired(const void *_mutex, const source_location &_site, bool _exclusive)
+        {
+            __held_locks().push_back({_mutex, _site, _exclusive});
+        }
+
+        inline void __order_released(const void *_mutex) noexcept
+        {
+            std::vector<__held_lock> &held = __held_locks();
+            // usually the most recently taken lock is released first
+            for (auto it = held.rbegin(); it != held.rend(); ++it)
+            {
+                if (it->mutex == _mutex)
+                {
+                    held.erase(std::next(it).base());
+                    return;
+                }
+            }
+        }
+
+        /**
+         * @brief names the wrapper whose mutex is _mutex in cycle reports. If the name can't
+         * be stored, the wrapper is reported without it.
+         */
+        inline void __order_name(const void *_mutex, const char *_name) noexcept
+        {
+            __order_graph &graph = __order_graph::instance();
+            try
+            {
+                std::lock_guard guard(graph.mutex);
+                graph.names[_mutex] = _name;
+            }
+            catch (...)
+            {
+                // out of memory, the name is only cosmetic
+            }
+        }
+
+        /**
+         * @brief removes _mutex from the graph when its wrapper is destroyed, so a new wrapper
+         * at the same address doesn't inherit its edges
+         */
+        inline void __order_forget(const void *_mutex)
+        {
+            __order_graph &graph = __order_graph::instance();
+            std::lock_guard guard(graph.mutex);
+            bool changed = graph.edges.erase(_mutex) != 0;
+            graph.names.erase(_mutex);
+            for (auto &[from, to] : graph.edges)
+                changed |= to.erase(_mutex) != 0;
+            if (changed)
+                graph.generation.fetch_add(1, std::memory_order_release);
+        }
+    };
+
+    /**
+     * @brief sets the function called with every new lock order cycle, instead of printing it
+     * with print_lock_order_cycle(). It is called on the thread that closed the cycle, before
+     * that thread waits for the lock.
+     *
+     * The lock order check is enabled by defining TS_STL_LOCK_ORDER_CHECK for the whole build.
+     * Then every accessor records which wrappers its thread already holds when it locks one,
+     * and these orders are collected in a process-wide graph. A cycle in the graph means the
+     * wrappers can deadlock when the threads involved run at the same time, even if they
+     * didn't in this run. Cycles are reported once, when the edge closing them is first seen.
+     * Checking takes a thread-local lookup per held lock, and a global lock the first time a
+     * thread sees an order. It is meant for debug builds and load tests.
+     */
+    inline void set_lock_order_reporter(std::function<void(const lock_order_cycle &)> _reporter)
+    {
+        __detail::__order_graph &graph = __detail::__order_graph::instance();
+        std::lock_guard guard(graph.mutex);
+        graph.reporter = std::move(_reporter);
+    }
+
+    /**
+     * @brief all lock order cycles found so far, e.g. to fail a test if there are any
+     */
+    inline std::vector<lock_order_cycle> lock_order_cycles()
+    {
+        __detail::__order_graph &graph = __detail::__order_graph::instance();
+        std::lock_guard guard(graph.mutex);
+        return graph.cycles;
+    }
+
+    /**
+     * @brief forgets all recorded lock orders and found cycles
+     */
+    inline void clear_lock_order()
+    {
+        __detail::__order_graph &graph = __detail::__order_graph::instance();
+        std::lock_guard guard(graph.mutex);
+        graph.edges.clear();
+        graph.cycles.clear();
+        graph.generation.fetch_add(1, std::memory_order_release);
+    }
+};
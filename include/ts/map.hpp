@@ -23,4 +23,18 @@ namespace ts
 
     template <class... _Args>
     using multimap = wrapper<std::multimap<_Args...>>;
+
+    // with explicit mutex type
+    template <class _MT, class... _Args>
+    using basic_map = wrapper<std::map<_Args...>, _MT>;
+
+    template <class _MT, class... _Args>
+    using basic_multimap = wrapper<std::multimap<_Args...>, _MT>;
+
+    // unsynchronized, for single threaded use (see null_lock.hpp)
+    template <class... _Args>
+    using unlocked_map = basic_map<null_lock, _Args...>;
+
+    template <class... _Args>
+    using unlocked_multimap = basic_multimap<null_lock, _Args...>;
 };
\ No newline at end of file
@@ -0,0 +1,254 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 18:41
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+MCS queue lock with timeouts for heavily contended exclusive access.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <optional>
+#include <cstddef>
+
+namespace ts
+{
+    /**
+     * @brief MCS queue lock. Waiters form a queue in which every waiter spins on a flag in
+     * its own queue node (its own cache line) instead of on one shared word, and the lock is
+     * handed over to the waiters in FIFO order. Under heavy contention this avoids the cache
+     * line storms and unfair hand-offs of a shared_timed_mutex, so throughput stays stable as
+     * the number of threads grows.
+     *
+     * Timed waits are supported: a waiter that times out marks its node as abandoned and
+     * leaves it in the queue, the unlocking thread skips abandoned nodes and recycles them.
+     * Queue nodes are taken from a small per-thread pool, so locking doesn't allocate.
+     *
+     * It meets the (shared) timed mutex requirements so it can be used as the mutex of a
+     * ts::wrapper (e.g. ts::basic_umap<ts::mcs_lock, K, V>). There is no shared mode, shared
+     * locks are exclusive as well, so it is meant for write heavy workloads.
+     */
+    class mcs_lock
+    {
+    private:
+        enum : int
+        {
+            __waiting = 0,
+            __granted = 1,
+            __abandoned = 2,
+        };
+
+        struct alignas(64) __node
+        {
+            std::atomic<__node *> next{nullptr};
+            std::atomic<int> state{__waiting};
+        };
+
+        /**
+         * @brief per thread cache of unused queue nodes
+         */
+        struct __node_pool
+        {
+            static constexpr std::size_t capacity = 8;
+            std::vector<__node *> nodes;
+
+            ~__node_pool()
+            {
+                for (__node *node : nodes)
+                    delete node;
+            }
+        };
+
+        // spins between checks of the clock / before yielding
+        static constexpr unsigned __spin_limit = 64;
+
+        std::atomic<__node *> __tail{nullptr};
+        // node of the current holder, only accessed by the holder
+        __node *__owner = nullptr;
+
+        static __node_pool &__pool()
+        {
+            thread_local __node_pool pool;
+            return pool;
+        }
+
+        static __node *__take_node()
+        {
+            __node_pool &pool = __pool();
+            __node *node;
+            if (pool.nodes.empty())
+                node = new __node();
+            else
+            {
+                node = pool.nodes.back();
+                pool.nodes.pop_back();
+            }
+            node->next.store(nullptr, std::memory_order_relaxed);
+            node->state.store(__waiting, std::memory_order_relaxed);
+            return node;
+        }
+
+        /**
+         * @brief returns a node nobody references anymore. Abandoned nodes of other
+         * threads end up in the pool of the thread that skipped them.
+         */
+        static void __recycle(__node *_node)
+        {
+            __node_pool &pool = __pool();
+            if (pool.nodes.size() < __node_pool::capacity)
+                pool.nodes.push_back(_node);
+            else
+                delete _node;
+        }
+
+        /**
+         * @brief enqueues and waits until the lock is granted or _deadline has passed
+         */
+        bool __acquire(const std::optional<std::chrono::steady_clock::time_point> &_deadline)
+        {
+            __node *node = __take_node();
+            __node *predecessor = __tail.exchange(node, std::memory_order_acq_rel);
+            if (predecessor == nullptr)
+            {
+                __owner = node;
+                return true;
+            }
+            predecessor->next.store(node, std::memory_order_release);
+
+            for (unsigned spins = 0; node->state.load(std::memory_order_acquire) == __waiting; spins++)
+            {
+                if (spins < __spin_limit)
+                    continue;
+                spins = 0;
+                if (_deadline && std::chrono::steady_clock::now() >= *_deadline)
+                {
+                    int expected = __waiting;
+                    // the node stays in the queue and is recycled by whoever skips it
+                    if (node->state.compare_exchange_strong(expected, __abandoned, std::memory_order_acq_rel))
+                        return false;
+                    break;
+                }
+                std::this_thread::yield();
+            }
+            __owner = node;
+            return true;
+        }
+
+    public:
+        mcs_lock() = default;
+        mcs_lock(const mcs_lock &) = delete;
+        mcs_lock &operator=(const mcs_lock &) = delete;
+
+        void lock()
+        {
+            __acquire(std::nullopt);
+        }
+
+        bool try_lock()
+        {
+            __node *expected = nullptr;
+            __node *node = __take_node();
+            if (__tail.compare_exchange_strong(expected, node, std::memory_order_acq_rel))
+            {
+                __owner = node;
+                return true;
+            }
+            __recycle(node);
+            return false;
+        }
+
+        template <class _Rep, class _Period>
+        bool try_lock_for(const std::chrono::duration<_Rep, _Period> &_duration)
+        {
+            if (try_lock())
+                return true;
+            return __acquire(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(_duration));
+        }
+
+        template <class _Clock, class _Duration>
+        bool try_lock_until(const std::chrono::time_point<_Clock, _Duration> &_time)
+        {
+            return try_lock_for(_time - _Clock::now());
+        }
+
+        /**
+         * @brief releases the lock, handing it to the next waiter that has not timed out.
+         * @return bool true if the lock was handed to a waiter, false if it is free now
+         */
+        bool unlock_handoff()
+        {
+            __node *node = __owner;
+            __owner = nullptr;
+            for (;;)
+            {
+                __node *next = node->next.load(std::memory_order_acquire);
+                if (next == nullptr)
+                {
+                    __node *expected = node;
+                    if (__tail.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel))
+                    {
+                        __recycle(node);
+                        return false;
+                    }
+                    // a new waiter swapped itself in but has not linked yet
+                    while ((next = node->next.load(std::memory_order_acquire)) == nullptr)
+                        ;
+                }
+                __recycle(node);
+
+                int expected = __waiting;
+                if (next->state.compare_exchange_strong(expected, __granted, std::memory_order_acq_rel))
+                    return true;
+                // next timed out, take over its node and try its successor
+                node = next;
+            }
+        }
+
+        void unlock()
+        {
+            unlock_handoff();
+        }
+
+        /**
+         * @brief whether other threads are queued behind the holder (possibly ones that are
+         * about to time out). Only meaningful for the thread holding the lock.
+         */
+        bool has_waiters() const noexcept
+        {
+            return __tail.load(std::memory_order_acquire) != __owner;
+        }
+
+        // there is no shared mode, shared locks are exclusive
+        void lock_shared()
+        {
+            lock();
+        }
+        bool try_lock_shared()
+        {
+            return try_lock();
+        }
+        template <class _Rep, class _Period>
+        bool try_lock_shared_for(const std::chrono::duration<_Rep, _Period> &_duration)
+        {
+            return try_lock_for(_duration);
+        }
+        template <class _Clock, class _Duration>
+        bool try_lock_shared_until(const std::chrono::time_point<_Clock, _Duration> &_time)
+        {
+            return try_lock_until(_time);
+        }
+        void unlock_shared()
+        {
+            unlock();
+        }
+    };
+};
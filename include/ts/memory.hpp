@@ -0,0 +1,320 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 20:48
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Counting allocator attributing heap usage to individual wrappers.
+*/
+
+#pragma once
+
+#include <set>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "wrapper.hpp"
+
+namespace ts
+{
+    /**
+     * @brief memory usage of one memory_account at the time it was reported
+     */
+    struct memory_usage
+    {
+        std::string name;
+        // bytes currently allocated
+        std::size_t live_bytes = 0;
+        // allocations currently alive (nodes for node based containers)
+        std::size_t live_allocations = 0;
+        // highest live_bytes so far
+        std::size_t peak_bytes = 0;
+        // allocations made so far
+        std::uint64_t total_allocations = 0;
+    };
+
+    class memory_account;
+
+    namespace __detail
+    {
+        /**
+         * @brief process-wide set of all existing memory accounts
+         */
+        struct __account_registry
+        {
+            std::mutex mutex;
+            std::set<memory_account *> accounts;
+
+            static __account_registry &instance()
+            {
+                static __account_registry registry;
+                return registry;
+            }
+        };
+    };
+
+    /**
+     * @brief counts the memory allocated through counting_allocators sharing it, usually all
+     * allocations of one container. Every account is listed in memory_report() while it exists.
+     * Counting only uses relaxed atomics, so it is cheap enough to stay enabled in production.
+     */
+    class memory_account
+    {
+    private:
+        std::atomic<std::size_t> __live_bytes{0};
+        std::atomic<std::size_t> __live_allocations{0};
+        std::atomic<std::size_t> __peak_bytes{0};
+        std::atomic<std::uint64_t> __total_allocations{0};
+
+        mutable std::mutex __name_mutex;
+        std::string __name;
+
+    public:
+        memory_account(std::string _name = "")
+            : __name(std::move(_name))
+        {
+            auto &registry = __detail::__account_registry::instance();
+            std::lock_guard lock(registry.mutex);
+            registry.accounts.insert(this);
+        }
+        ~memory_account()
+        {
+            auto &registry = __detail::__account_registry::instance();
+            std::lock_guard lock(registry.mutex);
+            registry.accounts.erase(this);
+        }
+
+        memory_account(const memory_account &) = delete;
+        memory_account &operator=(const memory_account &) = delete;
+
+        void record_allocation(std::size_t _bytes) noexcept
+        {
+            std::size_t live = __live_bytes.fetch_add(_bytes, std::memory_order_relaxed) + _bytes;
+            __live_allocations.fetch_add(1, std::memory_order_relaxed);
+            __total_allocations.fetch_add(1, std::memory_order_relaxed);
+            std::size_t peak = __peak_bytes.load(std::memory_order_relaxed);
+            while (live > peak && !__peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+                ;
+        }
+
+        void record_deallocation(std::size_t _bytes) noexcept
+        {
+            __live_bytes.fetch_sub(_bytes, std::memory_order_relaxed);
+            __live_allocations.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief names the account in memory reports, e.g. after the container it belongs to
+         */
+        void set_name(std::string _name)
+        {
+            std::lock_guard lock(__name_mutex);
+            __name = std::move(_name);
+        }
+
+        std::string name() const
+        {
+            std::lock_guard lock(__name_mutex);
+            return __name;
+        }
+
+        std::size_t live_bytes() const noexcept
+        {
+            return __live_bytes.load(std::memory_order_relaxed);
+        }
+        std::size_t live_allocations() const noexcept
+        {
+            return __live_allocations.load(std::memory_order_relaxed);
+        }
+        std::size_t peak_bytes() const noexcept
+        {
+            return __peak_bytes.load(std::memory_order_relaxed);
+        }
+        std::uint64_t total_allocations() const noexcept
+        {
+            return __total_allocations.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief resets the peak to the current live bytes, e.g. at the start of a measurement
+         */
+        void reset_peak() noexcept
+        {
+            __peak_bytes.store(live_bytes(), std::memory_order_relaxed);
+        }
+
+        memory_usage usage() const
+        {
+            memory_usage usage;
+            usage.name = name();
+            usage.live_bytes = live_bytes();
+            usage.live_allocations = live_allocations();
+            usage.peak_bytes = peak_bytes();
+            usage.total_allocations = total_allocations();
+            return usage;
+        }
+    };
+
+    /**
+     * @brief allocator counting its allocations in a memory_account. A default constructed
+     * counting_allocator creates a new account, so every container default constructed with it
+     * (e.g. every ts::counted_umap) gets an account of its own. Rebound copies used by the
+     * container internally share it, and copying a container gives the copy a new account.
+     *
+     * @tparam _T value type
+     * @tparam _A underlying allocator doing the actual allocations
+     */
+    template <class _T, class _A = std::allocator<_T>>
+    class counting_allocator
+    {
+        template <class _U, class _B>
+        friend class counting_allocator;
+
+    private:
+        typedef std::allocator_traits<_A> __traits;
+
+        _A __allocator;
+        std::shared_ptr<memory_account> __account;
+
+    public:
+        typedef _T value_type;
+        typedef std::false_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        template <class _U>
+        struct rebind
+        {
+            typedef counting_allocator<_U, typename __traits::template rebind_alloc<_U>> other;
+        };
+
+        counting_allocator()
+            : __account(std::make_shared<memory_account>())
+        {
+        }
+        counting_allocator(std::shared_ptr<memory_account> _account, const _A &_allocator = _A())
+            : __allocator(_allocator),
+            __account(std::move(_account))
+        {
+        }
+        // no moves, a moved-from container still has to be able to allocate from the account
+        counting_allocator(const counting_allocator &) = default;
+        counting_allocator &operator=(const counting_allocator &) = default;
+        template <class _U, class _B>
+        counting_allocator(const counting_allocator<_U, _B> &_other)
+            : __allocator(_other.__allocator),
+            __account(_other.__account)
+        {
+        }
+
+        _T *allocate(std::size_t _n)
+        {
+            _T *pointer = __traits::allocate(__allocator, _n);
+            __account->record_allocation(_n * sizeof(_T));
+            return pointer;
+        }
+
+        void deallocate(_T *_pointer, std::size_t _n) noexcept
+        {
+            __account->record_deallocation(_n * sizeof(_T));
+            __traits::deallocate(__allocator, _pointer, _n);
+        }
+
+        counting_allocator select_on_container_copy_construction() const
+        {
+            return counting_allocator(std::make_shared<memory_account>(), __traits::select_on_container_copy_construction(__allocator));
+        }
+
+        const std::shared_ptr<memory_account> &account() const noexcept
+        {
+            return __account;
+        }
+
+        template <class _U, class _B>
+        bool operator==(const counting_allocator<_U, _B> &_other) const noexcept
+        {
+            return __account == _other.__account && __allocator == _other.__allocator;
+        }
+        template <class _U, class _B>
+        bool operator!=(const counting_allocator<_U, _B> &_other) const noexcept
+        {
+            return !(*this == _other);
+        }
+    };
+
+    // wrappers accounting their memory, see memory_account_of()
+
+    template <class _K, class _V, class _Hash = std::hash<_K>, class _Eq = std::equal_to<_K>>
+    using counted_umap = wrapper<std::unordered_map<_K, _V, _Hash, _Eq, counting_allocator<std::pair<const _K, _V>>>>;
+
+    template <class _K, class _V, class _Cmp = std::less<_K>>
+    using counted_map = wrapper<std::map<_K, _V, _Cmp, counting_allocator<std::pair<const _K, _V>>>>;
+
+    template <class _K, class _Hash = std::hash<_K>, class _Eq = std::equal_to<_K>>
+    using counted_uset = wrapper<std::unordered_set<_K, _Hash, _Eq, counting_allocator<_K>>>;
+
+    using counted_string = wrapper<std::basic_string<char, std::char_traits<char>, counting_allocator<char>>>;
+
+    /**
+     * @brief returns the memory account of the container in _wrapper, which has to use a
+     * counting_allocator (e.g. a ts::counted_umap). Name it with memory_account::set_name()
+     * to find it in memory_report().
+     */
+    template <class _T, class _MT>
+    std::shared_ptr<memory_account> memory_account_of(wrapper<_T, _MT> &_wrapper)
+    {
+        return _wrapper.get_shared_access()->get_allocator().account();
+    }
+
+    /**
+     * @brief usage of all existing memory accounts, largest live_bytes first
+     */
+    inline std::vector<memory_usage> memory_report()
+    {
+        std::vector<memory_usage> report;
+        {
+            auto &registry = __detail::__account_registry::instance();
+            std::lock_guard lock(registry.mutex);
+            report.reserve(registry.accounts.size());
+            for (memory_account *account : registry.accounts)
+                report.push_back(account->usage());
+        }
+        std::sort(report.begin(), report.end(), [](const memory_usage &_a, const memory_usage &_b)
+        {
+            return _a.live_bytes > _b.live_bytes;
+        });
+        return report;
+    }
+
+    /**
+     * @brief writes memory_report() to _stream as a table, leaving out accounts without live
+     * allocations unless _all is set
+     */
+    inline void print_memory_report(std::ostream &_stream, bool _all = false)
+    {
+        _stream << "live bytes\tpeak bytes\tlive allocs\ttotal allocs\tname\n";
+        for (const memory_usage &usage : memory_report())
+        {
+            if (!_all && usage.live_allocations == 0)
+                continue;
+            _stream << usage.live_bytes << '\t' << usage.peak_bytes << '\t'
+                    << usage.live_allocations << '\t' << usage.total_allocations << '\t'
+                    << (usage.name.empty() ? "(unnamed)" : usage.name) << '\n';
+        }
+    }
+};
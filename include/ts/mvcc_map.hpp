@@ -0,0 +1,501 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 16:52
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Multi-version map with snapshot isolated reads.
+*/
+
+#pragma once
+
+#include <unordered_map>
+#include <set>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <functional>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#include "epoch.hpp"
+#include "except.hpp"
+
+namespace ts
+{
+    /**
+     * @brief unordered map keeping multiple versions of every value (MVCC), so readers can
+     * look at a consistent point in time without blocking writers.
+     *
+     * Every commit (a single modification or a batch of them) gets a timestamp, and every key
+     * has a chain of versions tagged with the timestamp of the commit that created them.
+     * A snapshot remembers the timestamp it was taken at and for every key returns the newest
+     * version not newer than that, so any number of lookups through one snapshot see the map
+     * exactly as it was when the snapshot was taken, including all or none of a batch.
+     *
+     * Versions no snapshot can see anymore (older than the watermark, the timestamp of the
+     * oldest open snapshot) are garbage collected when their key is written and by collect().
+     *
+     * Usage:
+     * @code
+     * ts::mvcc_map<std::string, int> m;
+     * m.insert_or_assign("a", 1);
+     * auto batch = m.begin_batch();
+     * batch.insert_or_assign("a", 2);
+     * batch.erase("b");
+     * batch.commit();
+     * auto snapshot = m.begin_snapshot();
+     * auto a = snapshot.find("a");    // consistent with all other lookups through snapshot
+     * @endcode
+     *
+     * @tparam _K key type
+     * @tparam _V mapped type (copyable, lookups return copies)
+     * @tparam _Hash key hash function
+     * @tparam _KeyEqual key equality predicate
+     */
+    template <class _K, class _V, class _Hash = std::hash<_K>, class _KeyEqual = std::equal_to<_K>>
+    class mvcc_map
+    {
+    public:
+        typedef _K key_type;
+        typedef _V mapped_type;
+        typedef std::size_t size_type;
+        typedef std::uint64_t timestamp_type;
+
+    private:
+        struct __version
+        {
+            const timestamp_type commit;
+            // empty if the key was erased by this commit
+            const std::optional<_V> value;
+            std::atomic<__version *> older;
+        };
+
+        struct __chain
+        {
+            const _K key;
+            std::atomic<__version *> head{nullptr};
+            // versions older than this commit have been collected
+            std::atomic<timestamp_type> pruned_below{0};
+        };
+
+        struct __operation
+        {
+            _K key;
+            std::optional<_V> value;
+        };
+
+        std::unordered_map<_K, std::unique_ptr<__chain>, _Hash, _KeyEqual> __index;
+        // only held for index lookups and insertions, never while reading versions
+        std::shared_mutex __index_mutex;
+
+        std::timed_mutex __write_mutex;
+        std::chrono::milliseconds __lock_timeout{10000};
+        std::atomic<timestamp_type> __clock{0};
+
+        std::mutex __snapshot_mutex;
+        std::multiset<timestamp_type> __snapshots;
+
+        static void __delete_versions(void *_versions)
+        {
+            auto *version = static_cast<__version *>(_versions);
+            while (version)
+            {
+                __version *older = version->older.load(std::memory_order_relaxed);
+                delete version;
+                version = older;
+            }
+        }
+
+        static void __delete_chain(void *_chain)
+        {
+            auto *chain = static_cast<__chain *>(_chain);
+            __delete_versions(chain->head.load(std::memory_order_relaxed));
+            delete chain;
+        }
+
+        __chain *__find_chain(const _K &_key)
+        {
+            std::shared_lock lock(__index_mutex);
+            auto it = __index.find(_key);
+            return it == __index.end() ? nullptr : it->second.get();
+        }
+
+        /**
+         * @brief the newest version of _chain visible at _ts, or nullptr if there is none.
+         * If the versions needed were already collected, _ts is moved forward to the current
+         * time, which is only allowed for reads without a snapshot.
+         */
+        __version *__visible(__chain *_chain, timestamp_type &_ts, bool _may_advance)
+        {
+            for (;;)
+            {
+                __version *version = _chain->head.load(std::memory_order_seq_cst);
+                while (version && version->commit > _ts)
+                    version = version->older.load(std::memory_order_seq_cst);
+                if (version || !_may_advance || _ts >= _chain->pruned_below.load(std::memory_order_seq_cst))
+                    return version;
+                _ts = __clock.load(std::memory_order_seq_cst);
+            }
+        }
+
+        std::optional<_V> __read(const _K &_key, timestamp_type _ts, bool _may_advance)
+        {
+            epoch_guard guard;
+            __chain *chain = __find_chain(_key);
+            if (chain == nullptr)
+                return std::nullopt;
+            __version *version = __visible(chain, _ts, _may_advance);
+            if (version == nullptr)
+                return std::nullopt;
+            return version->value;
+        }
+
+        /**
+         * @brief timestamp below which no snapshot can see versions anymore
+         */
+        timestamp_type __watermark()
+        {
+            std::lock_guard lock(__snapshot_mutex);
+            timestamp_type now = __clock.load(std::memory_order_seq_cst);
+            return __snapshots.empty() ? now : std::min(now, *__snapshots.begin());
+        }
+
+        /**
+         * @brief cuts off all versions of _chain older than the newest one visible at _watermark.
+         * __write_mutex has to be held.
+         */
+        void __prune(__chain *_chain, timestamp_type _watermark)
+        {
+            __version *keep = _chain->head.load(std::memory_order_relaxed);
+            while (keep && keep->commit > _watermark)
+                keep = keep->older.load(std::memory_order_relaxed);
+            if (keep == nullptr || keep->older.load(std::memory_order_relaxed) == nullptr)
+                return;
+
+            // readers that run into the cut have to see why
+            _chain->pruned_below.store(keep->commit, std::memory_order_seq_cst);
+            __version *cut = keep->older.exchange(nullptr, std::memory_order_seq_cst);
+            epoch_manager::instance().retire(cut, &__delete_versions);
+        }
+
+        void __lock_writer()
+        {
+            if (__lock_timeout.count() < 0)
+                __write_mutex.lock();
+            else if (!__write_mutex.try_lock_for(__lock_timeout))
+                throw lock_timeout_error("ts-stl/mvcc_map commit timeout");
+        }
+
+        /**
+         * @brief applies all _operations with one new timestamp, making them visible atomically.
+         * All versions are created before the first one is linked, so if copying a key or value
+         * or an allocation throws, none of the operations is applied.
+         */
+        timestamp_type __commit(const std::vector<__operation> &_operations)
+        {
+            __lock_writer();
+            std::lock_guard lock(__write_mutex, std::adopt_lock);
+
+            timestamp_type ts = __clock.load(std::memory_order_relaxed) + 1;
+            std::vector<std::pair<__chain *, std::unique_ptr<__version>>> pending;
+            pending.reserve(_operations.size());
+            for (const auto &operation : _operations)
+            {
+                __chain *chain = __find_chain(operation.key);
+                if (chain == nullptr)
+                {
+                    // erasing a key that never existed needs no version
+                    if (!operation.value)
+                        continue;
+                    // a chain left without versions by a failed commit reads as absent
+                    std::unique_lock index_lock(__index_mutex);
+                    chain = __index.emplace(operation.key, std::unique_ptr<__chain>(new __chain{operation.key})).first->second.get();
+                }
+                pending.emplace_back(chain, std::unique_ptr<__version>(new __version{ts, operation.value, {nullptr}}));
+            }
+
+            // linking can't fail, in order so later operations on a key override earlier ones
+            for (auto &[chain, version] : pending)
+            {
+                version->older.store(chain->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                chain->head.store(version.release(), std::memory_order_seq_cst);
+            }
+            // publishing the new time makes the whole commit visible at once
+            __clock.store(ts, std::memory_order_seq_cst);
+
+            timestamp_type watermark = __watermark();
+            for (auto &[chain, version] : pending)
+                __prune(chain, watermark);
+            return ts;
+        }
+
+    public:
+        /**
+         * @brief consistent, read-only view of the map at the time it was taken.
+         * While it exists, the versions it can see are not collected, so long lived snapshots
+         * make the map keep old versions. A snapshot can be moved between threads but must not
+         * be used by multiple threads at the same time.
+         */
+        class snapshot
+        {
+        private:
+            mvcc_map *__map;
+            timestamp_type __ts;
+            typename std::multiset<timestamp_type>::iterator __registration;
+
+            friend class mvcc_map;
+
+            snapshot(mvcc_map &_map)
+                : __map(&_map)
+            {
+                std::lock_guard lock(__map->__snapshot_mutex);
+                __ts = __map->__clock.load(std::memory_order_seq_cst);
+                __registration = __map->__snapshots.insert(__ts);
+            }
+
+        public:
+            snapshot(snapshot &&_other) noexcept
+                : __map(_other.__map),
+                __ts(_other.__ts),
+                __registration(_other.__registration)
+            {
+                _other.__map = nullptr;
+            }
+
+            snapshot(const snapshot &) = delete;
+            snapshot &operator=(const snapshot &) = delete;
+            snapshot &operator=(snapshot &&) = delete;
+
+            ~snapshot()
+            {
+                if (__map == nullptr)
+                    return;
+                std::lock_guard lock(__map->__snapshot_mutex);
+                __map->__snapshots.erase(__registration);
+            }
+
+            /**
+             * @return timestamp_type timestamp of the last commit visible in this snapshot
+             */
+            timestamp_type timestamp() const noexcept
+            {
+                return __ts;
+            }
+
+            /**
+             * @return std::optional<_V> copy of the value _key had at the time of the snapshot
+             */
+            std::optional<_V> find(const _K &_key) const
+            {
+                return __map->__read(_key, __ts, false);
+            }
+
+            bool contains(const _K &_key) const
+            {
+                return find(_key).has_value();
+            }
+
+            /**
+             * @brief calls _fn(key, value) for every element present at the time of the snapshot.
+             * Writers are not blocked while this runs.
+             */
+            template <class _Fn>
+            void for_each(_Fn &&_fn) const
+            {
+                epoch_guard guard;
+                std::vector<__chain *> chains;
+                {
+                    std::shared_lock lock(__map->__index_mutex);
+                    chains.reserve(__map->__index.size());
+                    for (const auto &[key, chain] : __map->__index)
+                        chains.push_back(chain.get());
+                }
+                timestamp_type ts = __ts;
+                for (__chain *chain : chains)
+                {
+                    __version *version = __map->__visible(chain, ts, false);
+                    if (version && version->value)
+                        _fn(chain->key, *version->value);
+                }
+            }
+
+            /**
+             * @return size_type number of elements present at the time of the snapshot
+             */
+            size_type size() const
+            {
+                size_type count = 0;
+                for_each([&](const _K &, const _V &)
+                {
+                    count++;
+                });
+                return count;
+            }
+        };
+
+        /**
+         * @brief collects several modifications that become visible atomically with commit().
+         * Snapshots see either all or none of them. Later modifications of the same key in one
+         * batch override earlier ones.
+         */
+        class batch
+        {
+        private:
+            mvcc_map *__map;
+            std::vector<__operation> __operations;
+
+            friend class mvcc_map;
+
+            batch(mvcc_map &_map)
+                : __map(&_map)
+            {
+            }
+
+        public:
+            void insert_or_assign(const _K &_key, const _V &_value)
+            {
+                __operations.push_back({_key, _value});
+            }
+
+            void erase(const _K &_key)
+            {
+                __operations.push_back({_key, std::nullopt});
+            }
+
+            /**
+             * @brief makes all modifications visible and clears the batch so it can be reused
+             * @return timestamp_type timestamp of the commit
+             */
+            timestamp_type commit()
+            {
+                timestamp_type ts = __map->__commit(__operations);
+                __operations.clear();
+                return ts;
+            }
+        };
+
+        mvcc_map() = default;
+
+        // snapshots and batches refer to the map, so copying makes no sense
+        mvcc_map(const mvcc_map &) = delete;
+        mvcc_map &operator=(const mvcc_map &) = delete;
+
+        ~mvcc_map()
+        {
+            for (auto &[key, chain] : __index)
+                __delete_versions(chain->head.load(std::memory_order_relaxed));
+        }
+
+        /**
+         * @brief Set the lock timeout used by writers waiting for other writers to commit.
+         * If it is configured to a negative number (preferably -1) the timeout is disabled.
+         *
+         * Default: 10000 ms
+         *
+         * @param _ms timeout value
+         */
+        void set_lock_timeout(std::chrono::milliseconds _ms)
+        {
+            __lock_timeout = _ms;
+        }
+
+        /**
+         * @brief takes a snapshot of the current state of the map
+         */
+        snapshot begin_snapshot()
+        {
+            return snapshot(*this);
+        }
+
+        /**
+         * @brief creates an empty batch of modifications
+         */
+        batch begin_batch()
+        {
+            return batch(*this);
+        }
+
+        /**
+         * @return timestamp_type timestamp of the latest commit
+         */
+        timestamp_type timestamp() const noexcept
+        {
+            return __clock.load(std::memory_order_seq_cst);
+        }
+
+        /**
+         * @return std::optional<_V> copy of the latest committed value of _key
+         */
+        std::optional<_V> find(const _K &_key)
+        {
+            return __read(_key, __clock.load(std::memory_order_seq_cst), true);
+        }
+
+        bool contains(const _K &_key)
+        {
+            return find(_key).has_value();
+        }
+
+        /**
+         * @brief commits a single insertion or assignment
+         * @return timestamp_type timestamp of the commit
+         */
+        timestamp_type insert_or_assign(const _K &_key, const _V &_value)
+        {
+            return __commit({__operation{_key, _value}});
+        }
+
+        /**
+         * @brief commits the removal of _key
+         * @return timestamp_type timestamp of the commit
+         */
+        timestamp_type erase(const _K &_key)
+        {
+            return __commit({__operation{_key, std::nullopt}});
+        }
+
+        /**
+         * @brief collects all versions older than the watermark and removes keys that have been
+         * erased before it. Writers wait while this runs, readers don't.
+         */
+        void collect()
+        {
+            __lock_writer();
+            std::lock_guard lock(__write_mutex, std::adopt_lock);
+            timestamp_type watermark = __watermark();
+
+            std::vector<const _K *> erased;
+            {
+                std::shared_lock index_lock(__index_mutex);
+                for (auto &[key, chain] : __index)
+                {
+                    __prune(chain.get(), watermark);
+                    __version *head = chain->head.load(std::memory_order_relaxed);
+                    if (head == nullptr || (head->commit <= watermark && !head->value))
+                        erased.push_back(&key);
+                }
+            }
+            if (erased.empty())
+                return;
+
+            // no snapshot can see these keys anymore, and writers are blocked, so they stay erased
+            std::unique_lock index_lock(__index_mutex);
+            for (const _K *key : erased)
+            {
+                auto it = __index.find(*key);
+                epoch_manager::instance().retire(it->second.release(), &__delete_chain);
+                __index.erase(it);
+            }
+        }
+    };
+};
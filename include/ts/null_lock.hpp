@@ -0,0 +1,251 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 17:26
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Null lock policy turning wrappers into plain containers for single threaded use.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <utility>
+
+#include "wrapper.hpp"
+
+namespace ts
+{
+    /**
+     * @brief mutex type that doesn't synchronize anything. Using it as the mutex of a
+     * ts::wrapper (e.g. ts::unlocked_umap or any wrapper when TS_STL_NULL_LOCK is defined)
+     * selects specializations of the wrapper and its accessors that only hold a reference
+     * to the container, so accessing it compiles down to using the container directly.
+     *
+     * It also satisfies the (shared) timed lockable requirements so it can be used with
+     * the standard lock types in generic code.
+     */
+    struct null_lock
+    {
+        constexpr void lock() noexcept {}
+        constexpr bool try_lock() noexcept { return true; }
+        constexpr void unlock() noexcept {}
+        constexpr void lock_shared() noexcept {}
+        constexpr bool try_lock_shared() noexcept { return true; }
+        constexpr void unlock_shared() noexcept {}
+
+        template <class _Rep, class _Period>
+        constexpr bool try_lock_for(const std::chrono::duration<_Rep, _Period> &) noexcept { return true; }
+        template <class _Clock, class _Duration>
+        constexpr bool try_lock_until(const std::chrono::time_point<_Clock, _Duration> &) noexcept { return true; }
+        template <class _Rep, class _Period>
+        constexpr bool try_lock_shared_for(const std::chrono::duration<_Rep, _Period> &) noexcept { return true; }
+        template <class _Clock, class _Duration>
+        constexpr bool try_lock_shared_until(const std::chrono::time_point<_Clock, _Duration> &) noexcept { return true; }
+    };
+
+    /**
+     * @brief shared accessor of an unsynchronized wrapper: a const reference to the container
+     * with the interface of the synchronized accessor.
+     */
+    template <class _CT>
+    class shared_accessor<_CT, null_lock>
+    {
+    private:
+        const _CT &__container;
+
+    public:
+        constexpr shared_accessor(const _CT &_c, null_lock &) noexcept
+            : __container(_c)
+        {
+        }
+
+        constexpr void set_lock_timeout(std::chrono::milliseconds) noexcept {}
+        constexpr void set_name(const char *) noexcept {}
+        constexpr void lock() noexcept {}
+        constexpr void unlock() noexcept {}
+
+        constexpr const _CT *operator->() const noexcept
+        {
+            return &__container;
+        }
+        constexpr const _CT &operator*() const noexcept
+        {
+            return __container;
+        }
+    };
+
+    /**
+     * @brief unique accessor of an unsynchronized wrapper: a reference to the container
+     * with the interface of the synchronized accessor.
+     */
+    template <class _CT>
+    class unique_accessor<_CT, null_lock>
+    {
+    private:
+        _CT &__container;
+
+    public:
+        constexpr unique_accessor(_CT &_c, null_lock &) noexcept
+            : __container(_c)
+        {
+        }
+
+        constexpr void set_lock_timeout(std::chrono::milliseconds) noexcept {}
+        constexpr void set_name(const char *) noexcept {}
+        constexpr void lock() noexcept {}
+        constexpr void unlock() noexcept {}
+
+        constexpr _CT *operator->() const noexcept
+        {
+            return &__container;
+        }
+        constexpr _CT &operator*() const noexcept
+        {
+            return __container;
+        }
+    };
+
+    /**
+     * @brief shared lease of an unsynchronized wrapper: a const reference to the container
+     * with the interface of the synchronized lease. There are never writers to step aside for.
+     */
+    template <class _CT>
+    class shared_lease<_CT, null_lock>
+    {
+    private:
+        const _CT &__container;
+
+    public:
+        constexpr shared_lease(const _CT &_c, null_lock &) noexcept
+            : __container(_c)
+        {
+        }
+
+        constexpr void set_lock_timeout(std::chrono::milliseconds) noexcept {}
+        constexpr void set_name(const char *) noexcept {}
+        constexpr void lock() noexcept {}
+        constexpr void unlock() noexcept {}
+        constexpr bool writer_waiting() const noexcept
+        {
+            return false;
+        }
+        constexpr bool checkpoint() noexcept
+        {
+            return false;
+        }
+
+        constexpr const _CT *operator->() const noexcept
+        {
+            return &__container;
+        }
+        constexpr const _CT &operator*() const noexcept
+        {
+            return __container;
+        }
+    };
+
+    /**
+     * @brief unsynchronized wrapper. It has the same interface as a synchronized one,
+     * so code written against ts::wrapper can be reused in single threaded programs,
+     * but it contains nothing but the container and never locks, times out or throws
+     * ts::lock_timeout_error. It must only ever be used by one thread at a time.
+     *
+     * @tparam _T container type
+     */
+    template <class _T>
+    class wrapper<_T, null_lock>
+    {
+    private:
+        _T __container;
+
+        // accessors take a mutex reference to match the synchronized interface
+        static null_lock &__null_mutex() noexcept
+        {
+            static null_lock mutex;
+            return mutex;
+        }
+
+    public:
+        wrapper(_T &&_stl_init)
+            : __container(std::move(_stl_init))
+        {
+        }
+        wrapper(const _T &_stl_init)
+            : __container(_stl_init)
+        {
+        }
+        wrapper() = default;
+
+        wrapper(const wrapper &) = default;
+        wrapper(wrapper &&) = default;
+        wrapper &operator=(const wrapper &) = default;
+        wrapper &operator=(wrapper &&) = default;
+
+        /**
+         * @brief does nothing, there is no lock to time out.
+         */
+        constexpr void set_lock_timeout(std::chrono::milliseconds) noexcept {}
+
+        /**
+         * @brief does nothing, there is no lock to time out.
+         */
+        constexpr void set_name(const char *) noexcept {}
+        constexpr const char *name() const noexcept
+        {
+            return "";
+        }
+
+        unique_accessor<_T, null_lock> get_exclusive_access(bool = true) noexcept
+        {
+            return unique_accessor<_T, null_lock>(__container, __null_mutex());
+        }
+
+        shared_accessor<_T, null_lock> get_shared_access(bool = true) noexcept
+        {
+            return shared_accessor<_T, null_lock>(__container, __null_mutex());
+        }
+
+        shared_lease<_T, null_lock> get_shared_lease(bool = true) noexcept
+        {
+            return shared_lease<_T, null_lock>(__container, __null_mutex());
+        }
+
+        void swap(_T &_other)
+        {
+            using std::swap;
+            swap(__container, _other);
+        }
+
+        // metadata is read directly from the container
+
+        template <class _C = _T, std::enable_if_t<__detail::__has_size<_C>::value, int> = 0>
+        std::size_t size() const noexcept
+        {
+            return __container.size();
+        }
+        template <class _C = _T, std::enable_if_t<__detail::__knows_empty<_C>, int> = 0>
+        bool empty() const noexcept
+        {
+            if constexpr (__detail::__has_size<_C>::value)
+                return __container.size() == 0;
+            else
+                return __container.begin() == __container.end();
+        }
+        container_metadata metadata() const noexcept
+        {
+            return __detail::__measure(__container);
+        }
+    };
+
+    // unsynchronized wrappers and accessors must not cost anything over the plain container
+    static_assert(sizeof(wrapper<long, null_lock>) == sizeof(long));
+    static_assert(sizeof(unique_accessor<long, null_lock>) == sizeof(long *));
+    static_assert(sizeof(shared_accessor<long, null_lock>) == sizeof(const long *));
+    static_assert(sizeof(shared_lease<long, null_lock>) == sizeof(const long *));
+};
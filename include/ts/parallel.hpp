@@ -0,0 +1,573 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 09:12
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Parallel algorithms operating on and bulk construction of the contents of ts-stl wrappers.
+*/
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <iterator>
+#include <optional>
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+#include "wrapper.hpp"
+
+namespace ts
+{
+    namespace __detail
+    {
+        /**
+         * @brief detects whether a container provides the bucket interface of the
+         * unordered STL containers (bucket_count() and per-bucket iterators).
+         * Such containers can be partitioned into bucket ranges without walking them.
+         */
+        template <class _CT, class = void>
+        struct __has_bucket_interface : std::false_type
+        {
+        };
+
+        template <class _CT>
+        struct __has_bucket_interface<_CT, std::void_t<
+            decltype(std::declval<const _CT &>().bucket_count()),
+            decltype(std::declval<const _CT &>().cbegin(std::size_t{})),
+            decltype(std::declval<const _CT &>().cend(std::size_t{}))>> : std::true_type
+        {
+        };
+
+        /**
+         * @brief detects map containers, whose elements are key/value pairs
+         */
+        template <class _CT, class = void>
+        struct __has_mapped_type : std::false_type
+        {
+        };
+
+        template <class _CT>
+        struct __has_mapped_type<_CT, std::void_t<typename _CT::mapped_type>> : std::true_type
+        {
+        };
+
+        /**
+         * @brief the key of an input element of a container of type _CT, the element itself
+         * for sets and its first member for maps
+         */
+        template <class _CT, class _E>
+        const auto &__element_key(const _E &_element) noexcept
+        {
+            if constexpr (__has_mapped_type<_CT>::value)
+                return _element.first;
+            else
+                return _element;
+        }
+
+        /**
+         * @brief determines how many workers to use for an amount of work units.
+         * A thread count of 0 selects the hardware concurrency. There are never more
+         * workers than work units and always at least one.
+         */
+        inline unsigned __resolve_thread_count(unsigned _threads, std::size_t _work_units)
+        {
+            if (_threads == 0)
+                _threads = std::thread::hardware_concurrency();
+            if (_threads == 0)
+                _threads = 1;
+            if (_work_units < _threads)
+                _threads = _work_units == 0 ? 1 : static_cast<unsigned>(_work_units);
+            return _threads;
+        }
+
+        /**
+         * @brief process wide pool of worker threads used by the parallel algorithms, so they
+         * don't create and join threads on every call. Workers are started lazily when a batch
+         * needs more of them than exist, up to the hardware concurrency, and then wait for the
+         * next batch. If a thread can't be started, the pool just keeps its current size.
+         *
+         * The thread submitting a batch works on it as well and only waits for the tasks other
+         * threads have already taken. A batch therefore always completes, even if every worker
+         * is busy (e.g. with the batch a nested parallel call was made from), if there are no
+         * workers at all or in the child of a fork(), which inherits none of the threads.
+         */
+        class __worker_pool
+        {
+        public:
+            /**
+             * @brief _count tasks calling run(context, i) for every i in [0, _count)
+             */
+            struct __batch
+            {
+                void (*run)(void *, unsigned) noexcept;
+                void *context;
+                unsigned count;
+                // next task to hand out, guarded by the pool's mutex
+                unsigned next = 0;
+                // finished tasks, guarded by mutex
+                unsigned done = 0;
+                std::mutex mutex;
+                std::condition_variable finished;
+            };
+
+        private:
+            std::mutex __mutex;
+            std::condition_variable __wake;
+            // batches with tasks that have not been handed out yet
+            std::deque<__batch *> __queue;
+            unsigned __workers = 0;
+            bool __spawn_failed = false;
+
+            __worker_pool() = default;
+
+            /**
+             * @brief hands out the next task of _batch. __mutex has to be held and the batch
+             * must have a task left.
+             */
+            unsigned __claim_locked(__batch &_batch)
+            {
+                unsigned index = _batch.next++;
+                if (_batch.next == _batch.count)
+                    __queue.erase(std::find(__queue.begin(), __queue.end(), &_batch));
+                return index;
+            }
+
+            static void __finish(__batch &_batch)
+            {
+                // notified while holding the mutex, the submitter may destroy the batch right after
+                std::lock_guard lock(_batch.mutex);
+                if (++_batch.done == _batch.count)
+                    _batch.finished.notify_all();
+            }
+
+            void __work()
+            {
+                for (;;)
+                {
+                    __batch *batch;
+                    unsigned index;
+                    {
+                        std::unique_lock lock(__mutex);
+                        __wake.wait(lock, [&]
+                        {
+                            return !__queue.empty();
+                        });
+                        batch = __queue.front();
+                        index = __claim_locked(*batch);
+                    }
+                    batch->run(batch->context, index);
+                    __finish(*batch);
+                }
+            }
+
+            /**
+             * @brief starts workers until there are _wanted (at most the hardware concurrency).
+             * __mutex has to be held.
+             */
+            void __grow_locked(unsigned _wanted)
+            {
+                unsigned limit = std::max(1u, std::thread::hardware_concurrency());
+                _wanted = std::min(_wanted, limit);
+                while (__workers < _wanted && !__spawn_failed)
+                {
+                    try
+                    {
+                        std::thread(&__worker_pool::__work, this).detach();
+                        __workers++;
+                    }
+                    catch (...)
+                    {
+                        __spawn_failed = true;
+                    }
+                }
+            }
+
+        public:
+            /**
+             * @brief the process wide pool. It is intentionally never destroyed, its workers
+             * keep waiting for work until the process exits.
+             */
+            static __worker_pool &instance()
+            {
+                static __worker_pool *pool = new __worker_pool();
+                return *pool;
+            }
+
+            /**
+             * @brief runs all tasks of _batch on the workers and the calling thread and returns
+             * once all of them have finished
+             */
+            void run(__batch &_batch)
+            {
+                {
+                    std::lock_guard lock(__mutex);
+                    __grow_locked(_batch.count - 1);
+                    __queue.push_back(&_batch);
+                }
+                __wake.notify_all();
+
+                for (;;)
+                {
+                    unsigned index;
+                    {
+                        std::lock_guard lock(__mutex);
+                        if (_batch.next == _batch.count)
+                            break;
+                        index = __claim_locked(_batch);
+                    }
+                    _batch.run(_batch.context, index);
+                    __finish(_batch);
+                }
+
+                std::unique_lock lock(_batch.mutex);
+                _batch.finished.wait(lock, [&]
+                {
+                    return _batch.done == _batch.count;
+                });
+            }
+        };
+
+        /**
+         * @brief runs _task(i) for every i in [0, _n) on the workers of the __worker_pool and
+         * the calling thread. With more tasks than the pool has workers, some threads run several
+         * of them one after the other. Returns once all tasks have finished, after which the first
+         * exception thrown by any task (if any) is rethrown.
+         */
+        template <class _Fn>
+        void __run_parallel(unsigned _n, _Fn &&_task)
+        {
+            std::vector<std::exception_ptr> errors(_n);
+            auto guarded = [&](unsigned _i) noexcept
+            {
+                try
+                {
+                    _task(_i);
+                }
+                catch (...)
+                {
+                    errors[_i] = std::current_exception();
+                }
+            };
+
+            if (_n <= 1)
+                guarded(0);
+            else
+            {
+                __worker_pool::__batch batch;
+                batch.run = [](void *_context, unsigned _i) noexcept
+                {
+                    (*static_cast<decltype(guarded) *>(_context))(_i);
+                };
+                batch.context = &guarded;
+                batch.count = _n;
+                __worker_pool::instance().run(batch);
+            }
+
+            for (auto &error : errors)
+                if (error)
+                    std::rethrow_exception(error);
+        }
+
+        /**
+         * @brief builds one container of type _CT per partition in [0, _partitions) from the
+         * range [_first, _last) using multiple threads. Every element goes to partition
+         * _partition_of(element). First every thread sorts the element indices of one chunk of
+         * the input into the partitions, then every thread builds the containers of some of
+         * the partitions (allocating and constructing all nodes in parallel), visiting the chunks
+         * in input order, so the first occurrence of a key in the input wins.
+         * Needs one index per input element of temporary memory.
+         */
+        template <class _CT, class _It, class _PartitionOf>
+        std::vector<_CT> __build_partitions(_It _first, _It _last, std::size_t _partitions, _PartitionOf &&_partition_of, unsigned _threads)
+        {
+            std::size_t count = static_cast<std::size_t>(std::distance(_first, _last));
+            unsigned n = __resolve_thread_count(_threads, count);
+
+            // indices[c][p]: indices of the elements of chunk c in partition p, in input order
+            std::vector<std::vector<std::vector<std::size_t>>> indices(n, std::vector<std::vector<std::size_t>>(_partitions));
+            __run_parallel(n, [&](unsigned _i)
+            {
+                std::size_t end = count * (_i + 1) / n;
+                for (std::size_t k = count * _i / n; k < end; k++)
+                    indices[_i][_partition_of(_first[k])].push_back(k);
+            });
+
+            std::vector<_CT> partitions(_partitions);
+            __run_parallel(n, [&](unsigned _i)
+            {
+                for (std::size_t p = _i; p < _partitions; p += n)
+                {
+                    _CT &partition = partitions[p];
+                    std::size_t size = 0;
+                    for (unsigned c = 0; c < n; c++)
+                        size += indices[c][p].size();
+                    partition.reserve(size);
+                    for (unsigned c = 0; c < n; c++)
+                        for (std::size_t k : indices[c][p])
+                            partition.insert(_first[k]);
+                }
+            });
+            return partitions;
+        }
+
+        /**
+         * @brief splits a container into one range of roughly equal size per thread and calls
+         * _task(i, visit) for each range i on its own thread, where visit(fn) calls
+         * fn for every element of range i.
+         * Unordered containers are split into bucket ranges, all other containers
+         * into iterator ranges which requires one walk over the container up front.
+         */
+        template <class _CT, class _Fn>
+        void __for_each_partition(const _CT &_c, unsigned _threads, _Fn &&_task)
+        {
+            if constexpr (__has_bucket_interface<_CT>::value)
+            {
+                std::size_t buckets = _c.bucket_count();
+                unsigned n = __resolve_thread_count(_threads, buckets);
+                __run_parallel(n, [&](unsigned _i)
+                {
+                    std::size_t first = buckets * _i / n;
+                    std::size_t last = buckets * (_i + 1) / n;
+                    _task(_i, [&](auto &&_fn)
+                    {
+                        for (std::size_t b = first; b < last; b++)
+                            for (auto it = _c.cbegin(b); it != _c.cend(b); ++it)
+                                _fn(*it);
+                    });
+                });
+            }
+            else
+            {
+                std::size_t count = static_cast<std::size_t>(std::distance(_c.cbegin(), _c.cend()));
+                unsigned n = __resolve_thread_count(_threads, count);
+
+                // collect the range boundaries in one pass
+                std::vector<typename _CT::const_iterator> bounds;
+                bounds.reserve(n + 1);
+                auto it = _c.cbegin();
+                std::size_t pos = 0;
+                for (unsigned i = 0; i < n; i++)
+                {
+                    std::size_t target = count * i / n;
+                    std::advance(it, target - pos);
+                    pos = target;
+                    bounds.push_back(it);
+                }
+                bounds.push_back(_c.cend());
+
+                __run_parallel(n, [&](unsigned _i)
+                {
+                    _task(_i, [&](auto &&_fn)
+                    {
+                        for (auto eit = bounds[_i]; eit != bounds[_i + 1]; ++eit)
+                            _fn(*eit);
+                    });
+                });
+            }
+        }
+    };
+
+    /**
+     * @brief calls _fn for every element of the wrapped container, spreading the work
+     * over multiple threads. The container is locked with shared access for the entire
+     * operation, so _fn may only read the elements and has to be safe to call from
+     * multiple threads simultaneously.
+     * Unordered containers are split into bucket ranges, other containers into
+     * iterator ranges of equal length.
+     *
+     * If _fn throws, the remaining elements of the throwing thread's range are skipped,
+     * all threads are joined and the first exception is rethrown.
+     *
+     * @param _w wrapper to iterate over
+     * @param _fn function called with a const reference to each element
+     * @param _threads number of threads to use (0 = hardware concurrency)
+     */
+    template <class _T, class _MT, class _Fn>
+    void parallel_for_each(wrapper<_T, _MT> &_w, _Fn _fn, unsigned _threads = 0)
+    {
+        auto access = _w.get_shared_access();
+        const _T &container = *access;
+
+        __detail::__for_each_partition(container, _threads, [&](unsigned, auto &&_visit)
+        {
+            _visit(_fn);
+        });
+    }
+
+    /**
+     * @brief maps every element of the wrapped container to a value of type _R and
+     * combines all of those values into one, spreading the work over multiple threads.
+     * The container is locked with shared access for the entire operation.
+     *
+     * Each thread combines the mapped values of its own range in iteration order,
+     * after which the partial results are combined with _init in range order.
+     * _combine therefore has to be associative but not necessarily commutative
+     * (for unordered containers the iteration order is unspecified anyway).
+     *
+     * @param _w wrapper to reduce
+     * @param _init initial value the partial results are combined into
+     * @param _map function converting a const reference to an element into _R
+     * @param _combine function combining two _R values into one
+     * @param _threads number of threads to use (0 = hardware concurrency)
+     * @return _R the combined result (_init if the container is empty)
+     */
+    template <class _T, class _MT, class _R, class _Map, class _Combine>
+    _R parallel_reduce(wrapper<_T, _MT> &_w, _R _init, _Map _map, _Combine _combine, unsigned _threads = 0)
+    {
+        auto access = _w.get_shared_access();
+        const _T &container = *access;
+
+        std::vector<std::optional<_R>> partials(__detail::__resolve_thread_count(_threads, SIZE_MAX));
+        __detail::__for_each_partition(container, _threads, [&](unsigned _i, auto &&_visit)
+        {
+            std::optional<_R> &partial = partials[_i];
+            _visit([&](const auto &_element)
+            {
+                if (partial)
+                    partial = _combine(std::move(*partial), _map(_element));
+                else
+                    partial.emplace(_map(_element));
+            });
+        });
+
+        for (auto &partial : partials)
+            if (partial)
+                _init = _combine(std::move(_init), std::move(*partial));
+        return _init;
+    }
+    /**
+     * @brief builds an unordered container of type _CT from the range [_first, _last)
+     * using multiple threads. The keys are partitioned by their hash, one partition per
+     * thread, and the container of every partition is built on its own thread (see
+     * __detail::__build_partitions()). The partial containers hold disjoint keys and are then
+     * moved into the result (reserved for all of them up front) with merge(). That relinks
+     * the nodes without allocating or copying any elements, but it is a serial pass that
+     * hashes (unless the container caches hash codes) and looks up every key. If that pass
+     * dominates, build a sharded_umap with sharded_umap::build_parallel() instead, which keeps
+     * the partitions as its shards and needs no merge.
+     * As with insert(), the first occurrence of a key in the input wins. The elements of
+     * maps are key/value pairs (with the key in first), those of sets are the keys.
+     *
+     * @tparam _CT unordered container type to build (e.g. std::unordered_map<K, V>)
+     * @param _first begin of the input range (random access)
+     * @param _last end of the input range
+     * @param _threads number of threads to use (0 = hardware concurrency)
+     * @return _CT the built container
+     */
+    template <class _CT, class _It>
+    _CT build_parallel(_It _first, _It _last, unsigned _threads = 0)
+    {
+        static_assert(
+            std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<_It>::iterator_category>,
+            "ts-stl/parallel build_parallel() requires random access iterators");
+
+        unsigned n = __detail::__resolve_thread_count(_threads, static_cast<std::size_t>(std::distance(_first, _last)));
+        typename _CT::hasher hash = _CT().hash_function();
+        std::vector<_CT> partials = __detail::__build_partitions<_CT>(_first, _last, n, [&](const auto &_element)
+        {
+            std::uint64_t h = hash(__detail::__element_key<_CT>(_element));
+            // mix the bits, identity hashes would otherwise partition by the low bits only
+            return static_cast<std::size_t>((h * 0x9E3779B97F4A7C15ull) >> 32) % n;
+        }, n);
+
+        std::size_t total = 0;
+        for (const _CT &partial : partials)
+            total += partial.size();
+        _CT result = std::move(partials[0]);
+        result.reserve(total);
+        for (unsigned i = 1; i < n; i++)
+            result.merge(partials[i]);
+        return result;
+    }
+
+    /**
+     * @brief builds a new unordered container from the range [_first, _last) using
+     * build_parallel() and publishes it into _target with a single O(1) swap.
+     * The previous contents of _target are destroyed after the lock has been released.
+     *
+     * @param _target wrapper to publish the built container into
+     * @param _first begin of the input range (random access)
+     * @param _last end of the input range
+     * @param _threads number of threads to use (0 = hardware concurrency)
+     */
+    template <class _T, class _MT, class _It>
+    void build_parallel(wrapper<_T, _MT> &_target, _It _first, _It _last, unsigned _threads = 0)
+    {
+        _T built = build_parallel<_T>(_first, _last, _threads);
+        _target.swap(built);
+    }
+
+    /**
+     * @brief builds an ordered container of type _CT from the range [_first, _last),
+     * which has to be sorted according to the container's comparator. Every element is
+     * inserted with an end() hint, so building takes linear instead of O(n log n) time.
+     * The input is split into one chunk per thread, each thread builds a container from
+     * its chunk and the partial containers are spliced together in order afterwards,
+     * which does not allocate or copy any elements.
+     * As with insert(), the first occurrence of a key in the input wins. If the input
+     * is not sorted, the result is still correct but building is not linear anymore.
+     *
+     * @tparam _CT ordered container type to build (e.g. std::map<K, V>)
+     * @param _first begin of the sorted input range (random access)
+     * @param _last end of the sorted input range
+     * @param _threads number of threads to use (0 = hardware concurrency)
+     * @return _CT the built container
+     */
+    template <class _CT, class _It>
+    _CT build_sorted(_It _first, _It _last, unsigned _threads = 0)
+    {
+        static_assert(
+            std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<_It>::iterator_category>,
+            "ts-stl/parallel build_sorted() requires random access iterators");
+
+        std::size_t count = static_cast<std::size_t>(std::distance(_first, _last));
+        unsigned n = __detail::__resolve_thread_count(_threads, count);
+
+        std::vector<_CT> partials(n);
+        __detail::__run_parallel(n, [&](unsigned _i)
+        {
+            auto begin = _first + count * _i / n;
+            auto end = _first + count * (_i + 1) / n;
+            _CT &partial = partials[_i];
+            for (auto it = begin; it != end; ++it)
+                partial.emplace_hint(partial.end(), *it);
+        });
+
+        _CT result = std::move(partials[0]);
+        for (unsigned i = 1; i < n; i++)
+        {
+            while (!partials[i].empty())
+                result.insert(result.end(), partials[i].extract(partials[i].begin()));
+        }
+        return result;
+    }
+
+    /**
+     * @brief builds a new ordered container from the sorted range [_first, _last) using
+     * build_sorted() and publishes it into _target with a single O(1) swap.
+     * The previous contents of _target are destroyed after the lock has been released.
+     *
+     * @param _target wrapper to publish the built container into
+     * @param _first begin of the sorted input range (random access)
+     * @param _last end of the sorted input range
+     * @param _threads number of threads to use (0 = hardware concurrency)
+     */
+    template <class _T, class _MT, class _It>
+    void build_sorted(wrapper<_T, _MT> &_target, _It _first, _It _last, unsigned _threads = 0)
+    {
+        _T built = build_sorted<_T>(_first, _last, _threads);
+        _target.swap(built);
+    }
+};
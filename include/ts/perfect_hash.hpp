@@ -0,0 +1,237 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 10:48
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Minimal perfect hash function used by the frozen unordered containers.
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace ts
+{
+    /**
+     * @brief 64 bit finalizer (splitmix64) used to spread the bits of std::hash
+     * results, which are often just the identity for integral keys.
+     */
+    inline std::uint64_t mix_hash(std::uint64_t _x) noexcept
+    {
+        _x ^= _x >> 30;
+        _x *= 0xbf58476d1ce4e5b9ull;
+        _x ^= _x >> 27;
+        _x *= 0x94d049bb133111ebull;
+        _x ^= _x >> 31;
+        return _x;
+    }
+
+    /**
+     * @brief minimal perfect hash function over a fixed set of 64 bit hash values,
+     * built with a PTHash-style "hash and displace" construction:
+     * The hashes are distributed into small buckets and for every bucket (largest first)
+     * a pilot value is searched so that all of the bucket's hashes land on free slots of a
+     * table slightly larger than the set. Slots beyond the set size are then remapped
+     * to the free slots below it, which makes the function minimal.
+     *
+     * Evaluating the function costs two hash mixes, one pilot load and (rarely) one
+     * remap load. It needs about 1 byte of pilots per key.
+     * For hash values that are not part of the set, an arbitrary slot is returned.
+     * Duplicate hash values are mapped to the same slot, the slots are numbered over the
+     * distinct values.
+     */
+    class perfect_hash
+    {
+    private:
+        // average number of keys per bucket
+        static constexpr std::size_t __bucket_size = 4;
+        // number of pilots tried per bucket before retrying with a different seed
+        static constexpr std::uint32_t __max_pilot = 1u << 20;
+        static constexpr unsigned __max_attempts = 16;
+
+        std::uint64_t __seed = 0;
+        std::size_t __size = 0;
+        std::size_t __table_size = 0;
+        std::vector<std::uint32_t> __pilots;
+        std::vector<std::uint32_t> __remap;
+
+        std::size_t __bucket(std::uint64_t _hash) const noexcept
+        {
+            return static_cast<std::size_t>(mix_hash(_hash ^ __seed) % __pilots.size());
+        }
+
+        std::size_t __position(std::uint64_t _hash, std::uint32_t _pilot) const noexcept
+        {
+            return static_cast<std::size_t>(mix_hash(_hash ^ mix_hash(__seed + _pilot)) % __table_size);
+        }
+
+        bool __try_build(const std::vector<std::uint64_t> &_hashes)
+        {
+            std::size_t n = _hashes.size();
+            std::size_t buckets = (n + __bucket_size - 1) / __bucket_size;
+            __table_size = n + n / 64 + 1;
+            __pilots.assign(buckets, 0);
+
+            // group the hashes by bucket (counting sort)
+            std::vector<std::size_t> bucket_start(buckets + 1, 0);
+            for (std::uint64_t hash : _hashes)
+                bucket_start[__bucket(hash) + 1]++;
+            for (std::size_t b = 0; b < buckets; b++)
+                bucket_start[b + 1] += bucket_start[b];
+            std::vector<std::uint64_t> grouped(n);
+            {
+                std::vector<std::size_t> fill(bucket_start.begin(), bucket_start.end() - 1);
+                for (std::uint64_t hash : _hashes)
+                    grouped[fill[__bucket(hash)]++] = hash;
+            }
+
+            // place the largest buckets first while the table is still mostly empty
+            std::vector<std::size_t> order(buckets);
+            for (std::size_t b = 0; b < buckets; b++)
+                order[b] = b;
+            std::stable_sort(order.begin(), order.end(), [&](std::size_t _a, std::size_t _b)
+            {
+                return bucket_start[_a + 1] - bucket_start[_a] > bucket_start[_b + 1] - bucket_start[_b];
+            });
+
+            std::vector<bool> taken(__table_size, false);
+            std::vector<std::size_t> positions;
+            for (std::size_t b : order)
+            {
+                std::size_t first = bucket_start[b], last = bucket_start[b + 1];
+                if (first == last)
+                    break;
+
+                std::uint32_t pilot = 0;
+                for (; pilot < __max_pilot; pilot++)
+                {
+                    positions.clear();
+                    bool ok = true;
+                    for (std::size_t i = first; i < last && ok; i++)
+                    {
+                        std::size_t p = __position(grouped[i], pilot);
+                        ok = !taken[p] && std::find(positions.begin(), positions.end(), p) == positions.end();
+                        positions.push_back(p);
+                    }
+                    if (ok)
+                        break;
+                }
+                if (pilot == __max_pilot)
+                    return false;
+
+                __pilots[b] = pilot;
+                for (std::size_t p : positions)
+                    taken[p] = true;
+            }
+
+            // remap the slots beyond the key count to the unused ones below it
+            __remap.assign(__table_size - n, 0);
+            std::size_t free_slot = 0;
+            for (std::size_t p = n; p < __table_size; p++)
+            {
+                if (!taken[p])
+                    continue;
+                while (taken[free_slot])
+                    free_slot++;
+                __remap[p - n] = static_cast<std::uint32_t>(free_slot++);
+            }
+            return true;
+        }
+
+    public:
+        perfect_hash() = default;
+
+        /**
+         * @brief builds the function for a set of hash values. Duplicates are allowed
+         * and share a slot, size() is the number of distinct values.
+         *
+         * @param _hashes hash values to build the function for
+         */
+        explicit perfect_hash(const std::vector<std::uint64_t> &_hashes)
+        {
+            std::vector<std::uint64_t> distinct(_hashes);
+            std::sort(distinct.begin(), distinct.end());
+            distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+            __size = distinct.size();
+            if (__size == 0)
+                return;
+            if (__size > UINT32_MAX)
+                throw std::invalid_argument("ts-stl/perfect_hash too many keys");
+
+            for (unsigned attempt = 0; attempt < __max_attempts; attempt++)
+            {
+                __seed = mix_hash(attempt + 1);
+                if (__try_build(distinct))
+                    return;
+            }
+            throw std::runtime_error("ts-stl/perfect_hash construction failed");
+        }
+
+        /**
+         * @return std::size_t number of distinct hash values the function was built for
+         */
+        std::size_t size() const noexcept
+        {
+            return __size;
+        }
+
+        /**
+         * @brief maps a hash value of the set to its unique slot in [0, size()).
+         * Must not be called on an empty function.
+         */
+        std::size_t operator()(std::uint64_t _hash) const noexcept
+        {
+            std::size_t p = __position(_hash, __pilots[__bucket(_hash)]);
+            if (p >= __size)
+                p = __remap[p - __size];
+            return p;
+        }
+    };
+
+    namespace __detail
+    {
+        /**
+         * @brief storage order of the elements of a frozen container, given the hash of every
+         * element and the perfect hash function built over them. The first _phf.size() positions
+         * hold one element per distinct hash, at the slot of its hash. Elements whose hash is
+         * shared with an earlier one (distinct keys with colliding hashes) follow, sorted by hash,
+         * and their hashes are stored in _overflow in the same order.
+         *
+         * @return std::vector<std::size_t> index of the element stored at every position
+         */
+        inline std::vector<std::size_t> __frozen_order(const perfect_hash &_phf, const std::vector<std::uint64_t> &_hashes, std::vector<std::uint64_t> &_overflow)
+        {
+            static constexpr std::size_t unset = SIZE_MAX;
+            std::vector<std::size_t> order(_phf.size(), unset);
+            std::vector<std::pair<std::uint64_t, std::size_t>> colliding;
+            for (std::size_t i = 0; i < _hashes.size(); i++)
+            {
+                std::size_t &slot = order[_phf(_hashes[i])];
+                if (slot == unset)
+                    slot = i;
+                else
+                    colliding.emplace_back(_hashes[i], i);
+            }
+
+            std::sort(colliding.begin(), colliding.end());
+            _overflow.clear();
+            _overflow.reserve(colliding.size());
+            for (const auto &[hash, index] : colliding)
+            {
+                order.push_back(index);
+                _overflow.push_back(hash);
+            }
+            return order;
+        }
+    };
+};
@@ -0,0 +1,841 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 14:47
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Unordered map split into independently locked shards, with hot key detection
+and per-core read replication of hot keys.
+*/
+
+#pragma once
+
+#include <unordered_map>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+#include "wrapper.hpp"
+#include "epoch.hpp"
+#include "parallel.hpp"
+
+namespace ts
+{
+    namespace __detail
+    {
+        /**
+         * @brief small per thread index assigned round robin, used to spread threads
+         * over per-core structures without querying the CPU number on every access.
+         */
+        inline std::size_t __thread_index()
+        {
+            static std::atomic<std::size_t> next{0};
+            thread_local std::size_t index = next.fetch_add(1, std::memory_order_relaxed);
+            return index;
+        }
+
+        /**
+         * @brief returns true on every _interval'th call on the calling thread
+         */
+        inline bool __sample_tick(unsigned _interval)
+        {
+            thread_local unsigned tick = 0;
+            return ++tick % _interval == 0;
+        }
+    };
+
+    /**
+     * @brief configuration of the hot key detection of a sharded_umap.
+     */
+    struct hot_key_options
+    {
+        // detection and replication can be disabled entirely
+        bool enabled = true;
+        // only every n'th access of a thread is sampled
+        unsigned sample_interval = 64;
+        // number of samples after which the hot key set is re-evaluated
+        std::size_t window = 4096;
+        // minimum share of the sampled reads a key needs to be considered hot
+        double read_share = 0.01;
+        // keys written more often than this fraction of their reads are not replicated
+        double max_write_ratio = 0.1;
+        // maximum number of hot keys
+        std::size_t max_hot_keys = 32;
+    };
+
+    /**
+     * @brief lock contention measured on sampled accesses of a sharded_umap.
+     * The counters only ever grow, compare two snapshots to get the values of an interval.
+     */
+    struct contention_stats
+    {
+        // number of sampled accesses that took a shard lock
+        std::uint64_t sampled_reads = 0;
+        std::uint64_t sampled_writes = 0;
+        // total time the sampled accesses waited for and held the shard locks
+        std::chrono::nanoseconds wait{0};
+        std::chrono::nanoseconds hold{0};
+
+        /**
+         * @return double fraction of the time spent waiting for locks (0 if nothing was sampled)
+         */
+        double wait_ratio() const noexcept
+        {
+            auto total = wait + hold;
+            return total.count() == 0 ? 0.0 : static_cast<double>(wait.count()) / static_cast<double>(total.count());
+        }
+    };
+
+    /**
+     * @brief unordered map split into a number of shards, each being a separately locked
+     * ts::wrapper of a std::unordered_map. Operations on keys in different shards don't
+     * contend for the same lock.
+     *
+     * For skewed access patterns the map samples accesses and detects hot keys that are
+     * read much more often than they are written. The values of hot keys are replicated
+     * into per-core read caches, so reads of hot keys are served without touching the
+     * (otherwise very contended) lock of their shard. A cached copy is immutable once
+     * published through an atomic pointer and reclaimed through the epoch_manager, so cache
+     * hits don't take any lock. Every hot key has a version that is incremented by writers
+     * while they still hold the shard lock, which invalidates all cached copies, so reads
+     * always return the latest value.
+     *
+     * Sampled accesses are first counted per core and only merged into the map wide
+     * counts in batches, so sampling doesn't serialize all threads on one lock either.
+     *
+     * Since the caches are kept coherent by the modifiers of this class, the shards can only
+     * be accessed read-only from the outside.
+     *
+     * @tparam _K key type
+     * @tparam _V mapped type (copyable, lookups return copies)
+     * @tparam _Hash key hash function
+     * @tparam _KeyEqual key equality predicate
+     */
+    template <class _K, class _V, class _Hash = std::hash<_K>, class _KeyEqual = std::equal_to<_K>>
+    class sharded_umap
+    {
+    public:
+        typedef _K key_type;
+        typedef _V mapped_type;
+        typedef std::size_t size_type;
+        typedef std::unordered_map<_K, _V, _Hash, _KeyEqual> shard_container_type;
+        typedef wrapper<shard_container_type> shard_type;
+
+        /**
+         * @brief snapshot of the map's statistics
+         */
+        struct stats_t
+        {
+            // currently replicated keys
+            std::vector<_K> hot_keys;
+            // incremented whenever the hot key set changes
+            std::uint64_t hot_set_generation = 0;
+            // reads of hot keys served from / missing the per-core caches
+            std::uint64_t cache_hits = 0;
+            std::uint64_t cache_misses = 0;
+            // number of elements per shard
+            std::vector<size_type> shard_sizes;
+            // lock wait and hold times of sampled accesses
+            ts::contention_stats contention;
+        };
+
+    private:
+        struct alignas(64) __shard
+        {
+            shard_type map;
+        };
+
+        /**
+         * @brief immutable copy of a hot key's value at a certain version
+         */
+        struct __replica
+        {
+            std::optional<_V> value;
+            std::uint64_t version;
+        };
+
+        struct alignas(64) __replica_slot
+        {
+            std::atomic<__replica *> replica{nullptr};
+        };
+
+        struct __hot_entry
+        {
+            std::atomic<std::uint64_t> version{0};
+            // one replica per core, replaced replicas are reclaimed through the epoch_manager
+            std::size_t cores;
+            std::unique_ptr<__replica_slot[]> replicas;
+
+            explicit __hot_entry(std::size_t _cores)
+                : cores(_cores),
+                replicas(new __replica_slot[_cores])
+            {}
+
+            // only destroyed once no reader can access the hot set anymore
+            ~__hot_entry()
+            {
+                for (std::size_t i = 0; i < cores; i++)
+                    delete replicas[i].replica.load(std::memory_order_relaxed);
+            }
+        };
+
+        /**
+         * @brief set of hot keys, immutable once published (except the entry versions).
+         * Replaced sets are reclaimed through the epoch_manager.
+         */
+        struct __hot_set
+        {
+            std::uint64_t generation = 0;
+            std::unordered_map<_K, std::unique_ptr<__hot_entry>, _Hash, _KeyEqual> entries;
+        };
+
+        struct __sample_counts
+        {
+            std::uint32_t reads = 0;
+            std::uint32_t writes = 0;
+        };
+
+        struct alignas(64) __cache_slot
+        {
+            std::atomic<std::uint64_t> hits{0};
+            std::atomic<std::uint64_t> misses{0};
+            // samples of the threads using this slot, not merged into __samples yet
+            std::mutex sample_mutex;
+            std::unordered_map<_K, __sample_counts, _Hash, _KeyEqual> samples;
+            std::size_t sample_count = 0;
+        };
+
+        struct alignas(64) __contention_counters
+        {
+            std::atomic<std::uint64_t> reads{0};
+            std::atomic<std::uint64_t> writes{0};
+            std::atomic<std::uint64_t> wait_ns{0};
+            std::atomic<std::uint64_t> hold_ns{0};
+        };
+
+        /**
+         * @brief measures how long a sampled access waited for and held a shard lock.
+         * Must be constructed before the accessor, so it is destroyed after the lock is released.
+         */
+        class __probe
+        {
+        private:
+            __contention_counters *__counters;
+            std::chrono::steady_clock::time_point __start;
+            std::chrono::steady_clock::time_point __acquired;
+            bool __locked = false;
+
+        public:
+            __probe(__contention_counters *_counters, bool _write)
+                : __counters(_counters)
+            {
+                if (!__counters)
+                    return;
+                (_write ? __counters->writes : __counters->reads).fetch_add(1, std::memory_order_relaxed);
+                __start = std::chrono::steady_clock::now();
+            }
+
+            void acquired()
+            {
+                if (!__counters)
+                    return;
+                __acquired = std::chrono::steady_clock::now();
+                __locked = true;
+            }
+
+            ~__probe()
+            {
+                if (!__locked)
+                    return;
+                auto released = std::chrono::steady_clock::now();
+                __counters->wait_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(__acquired - __start).count(), std::memory_order_relaxed);
+                __counters->hold_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(released - __acquired).count(), std::memory_order_relaxed);
+            }
+        };
+
+        // capacity of the space saving sampler
+        static constexpr std::size_t __sampler_capacity = 256;
+        // number of samples a cache slot collects before merging them into __samples
+        static constexpr std::size_t __merge_batch = 32;
+
+        std::unique_ptr<__shard[]> __shards;
+        size_type __shard_count;
+        _Hash __hash;
+        hot_key_options __options;
+
+        std::atomic<__hot_set *> __hot{nullptr};
+        std::mutex __sampler_mutex;
+        std::unordered_map<_K, __sample_counts, _Hash, _KeyEqual> __samples;
+        std::size_t __sample_count = 0;
+
+        std::unique_ptr<__cache_slot[]> __caches;
+        size_type __cache_count;
+
+        __contention_counters __contention;
+
+        shard_type &__shard_for(const _K &_key)
+        {
+            return __shards[__hash(_key) % __shard_count].map;
+        }
+
+        __cache_slot &__local_cache()
+        {
+            return __caches[__detail::__thread_index() % __cache_count];
+        }
+
+        /**
+         * @brief invalidates the cached copies of _key if it is hot. Has to be called
+         * while holding the exclusive lock of the key's shard, after modifying it.
+         */
+        void __invalidate(const _K &_key)
+        {
+            if (!__options.enabled)
+                return;
+            epoch_guard guard;
+            __hot_set *hot = __hot.load(std::memory_order_seq_cst);
+            if (hot == nullptr)
+                return;
+            auto it = hot->entries.find(_key);
+            if (it != hot->entries.end())
+                it->second->version.fetch_add(1, std::memory_order_release);
+        }
+
+        /**
+         * @brief invalidates the cached copies of all hot keys of shard _index. Has to be
+         * called while holding the exclusive lock of the shard, after modifying it.
+         */
+        void __invalidate_shard(size_type _index)
+        {
+            if (!__options.enabled)
+                return;
+            epoch_guard guard;
+            if (__hot_set *hot = __hot.load(std::memory_order_seq_cst))
+                for (auto &[key, entry] : hot->entries)
+                    if (shard_index(key) == _index)
+                        entry->version.fetch_add(1, std::memory_order_release);
+        }
+
+        /**
+         * @brief decides whether the current access of the calling thread is sampled
+         */
+        bool __sampled()
+        {
+            return __detail::__sample_tick(__options.sample_interval);
+        }
+
+        /**
+         * @brief records a sampled access in the local cache slot and merges the slot's
+         * samples into the map wide counts once a batch is full
+         */
+        void __sample(const _K &_key, bool _write)
+        {
+            if (!__options.enabled)
+                return;
+
+            __cache_slot &local = __local_cache();
+            std::unordered_map<_K, __sample_counts, _Hash, _KeyEqual> batch;
+            {
+                std::lock_guard lock(local.sample_mutex);
+                __sample_counts &counts = local.samples[_key];
+                if (_write)
+                    counts.writes++;
+                else
+                    counts.reads++;
+
+                if (++local.sample_count < std::min(__merge_batch, __options.window))
+                    return;
+                batch.swap(local.samples);
+                local.sample_count = 0;
+            }
+            __merge(batch);
+        }
+
+        /**
+         * @brief adds a batch of samples to the map wide counts and re-evaluates the hot
+         * key set at the end of a window
+         */
+        void __merge(const std::unordered_map<_K, __sample_counts, _Hash, _KeyEqual> &_batch)
+        {
+            std::lock_guard lock(__sampler_mutex);
+            for (const auto &[key, sampled] : _batch)
+            {
+                auto it = __samples.find(key);
+                if (it == __samples.end())
+                {
+                    if (__samples.size() >= __sampler_capacity)
+                    {
+                        // space saving: the new key takes over the counts of the least frequent one
+                        auto min = std::min_element(__samples.begin(), __samples.end(), [](const auto &_a, const auto &_b)
+                        {
+                            return _a.second.reads + _a.second.writes < _b.second.reads + _b.second.writes;
+                        });
+                        __sample_counts counts = min->second;
+                        __samples.erase(min);
+                        it = __samples.emplace(key, counts).first;
+                    }
+                    else
+                        it = __samples.emplace(key, __sample_counts()).first;
+                }
+                it->second.reads += sampled.reads;
+                it->second.writes += sampled.writes;
+                __sample_count += sampled.reads + sampled.writes;
+            }
+
+            if (__sample_count >= __options.window)
+                __evaluate_locked();
+        }
+
+        /**
+         * @brief publishes a new hot key set from the samples of the finished window.
+         * __sampler_mutex has to be held.
+         */
+        void __evaluate_locked()
+        {
+            std::uint64_t total_reads = 0;
+            for (const auto &[key, counts] : __samples)
+                total_reads += counts.reads;
+
+            std::vector<std::pair<std::uint32_t, const _K *>> candidates;
+            for (const auto &[key, counts] : __samples)
+            {
+                if (counts.reads < __options.read_share * static_cast<double>(total_reads) || counts.reads == 0)
+                    continue;
+                if (counts.writes > __options.max_write_ratio * counts.reads)
+                    continue;
+                candidates.emplace_back(counts.reads, &key);
+            }
+            std::sort(candidates.begin(), candidates.end(), [](const auto &_a, const auto &_b)
+            {
+                return _a.first > _b.first;
+            });
+            if (candidates.size() > __options.max_hot_keys)
+                candidates.resize(__options.max_hot_keys);
+
+            __hot_set *current = __hot.load(std::memory_order_relaxed);
+            bool changed = current == nullptr ? !candidates.empty() : candidates.size() != current->entries.size();
+            for (std::size_t i = 0; i < candidates.size() && !changed; i++)
+                changed = current->entries.find(*candidates[i].second) == current->entries.end();
+
+            if (changed)
+            {
+                __hot_set *next = new __hot_set();
+                next->generation = current == nullptr ? 1 : current->generation + 1;
+                for (const auto &candidate : candidates)
+                    next->entries.emplace(*candidate.second, std::make_unique<__hot_entry>(__cache_count));
+                __hot.store(next, std::memory_order_seq_cst);
+                if (current)
+                    epoch_manager::instance().retire(current);
+            }
+
+            __samples.clear();
+            __sample_count = 0;
+        }
+
+        /**
+         * @brief reads a hot key through the local replica, which only takes the shard
+         * lock if the replica is missing or outdated.
+         * @return bool false if _key is not hot (and the value has not been read)
+         */
+        bool __find_hot(const _K &_key, std::optional<_V> &_result)
+        {
+            epoch_guard guard;
+            __hot_set *hot = __hot.load(std::memory_order_seq_cst);
+            if (hot == nullptr)
+                return false;
+            auto it = hot->entries.find(_key);
+            if (it == hot->entries.end())
+                return false;
+
+            std::size_t core = __detail::__thread_index() % __cache_count;
+            __hot_entry &entry = *it->second;
+            __cache_slot &cache = __caches[core];
+            std::atomic<__replica *> &slot = entry.replicas[core].replica;
+
+            // the version is loaded first, a replica of that version can't be older than it
+            std::uint64_t version = entry.version.load(std::memory_order_acquire);
+            __replica *replica = slot.load(std::memory_order_acquire);
+            if (replica != nullptr && replica->version == version)
+            {
+                cache.hits.fetch_add(1, std::memory_order_relaxed);
+                _result = replica->value;
+                return true;
+            }
+
+            // read value and version together under the shard lock so they match
+            auto fresh = std::make_unique<__replica>();
+            {
+                auto access = __shard_for(_key).get_shared_access();
+                auto found = access->find(_key);
+                if (found != access->end())
+                    fresh->value = found->second;
+                fresh->version = entry.version.load(std::memory_order_acquire);
+            }
+            _result = fresh->value;
+            cache.misses.fetch_add(1, std::memory_order_relaxed);
+
+            // threads sharing the slot may race here, whichever replica is left is still valid
+            // for its version, and an outdated one is just replaced by the next miss
+            if (__replica *replaced = slot.exchange(fresh.release(), std::memory_order_acq_rel))
+                epoch_manager::instance().retire(replaced);
+            return true;
+        }
+
+        /**
+         * @brief runs _fn with the container of _key's shard while holding its exclusive lock
+         */
+        template <class _Fn>
+        auto __write(const _K &_key, _Fn &&_fn)
+        {
+            bool sampled = __sampled();
+            if (sampled)
+                __sample(_key, true);
+
+            __probe probe(sampled ? &__contention : nullptr, true);
+            auto access = __shard_for(_key).get_exclusive_access(false);
+            access.lock();
+            probe.acquired();
+            return _fn(*access);
+        }
+
+    public:
+        /**
+         * @brief creates a map with _shard_count shards
+         *
+         * @param _shard_count number of shards (at least 1)
+         * @param _options hot key detection configuration
+         */
+        explicit sharded_umap(size_type _shard_count = 16, hot_key_options _options = hot_key_options())
+            : __shards(new __shard[_shard_count == 0 ? 1 : _shard_count]),
+            __shard_count(_shard_count == 0 ? 1 : _shard_count),
+            __options(_options),
+            __cache_count(std::max(1u, std::thread::hardware_concurrency()))
+        {
+            if (__options.sample_interval == 0)
+                __options.sample_interval = 1;
+            if (__options.enabled)
+                __caches.reset(new __cache_slot[__cache_count]);
+        }
+
+        // the map is shared between threads by reference, so copying it makes no sense
+        sharded_umap(const sharded_umap &) = delete;
+        sharded_umap &operator=(const sharded_umap &) = delete;
+
+        ~sharded_umap()
+        {
+            delete __hot.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Set the lock timeout of all shards (see wrapper::set_lock_timeout())
+         */
+        void set_lock_timeout(std::chrono::milliseconds _ms)
+        {
+            for (size_type i = 0; i < __shard_count; i++)
+                __shards[i].map.set_lock_timeout(_ms);
+        }
+
+        size_type shard_count() const noexcept
+        {
+            return __shard_count;
+        }
+
+        /**
+         * @return const hot_key_options& the hot key detection configuration
+         */
+        const hot_key_options &hot_keys() const noexcept
+        {
+            return __options;
+        }
+
+        /**
+         * @return size_type index of the shard responsible for _key
+         */
+        size_type shard_index(const _K &_key) const
+        {
+            return __hash(_key) % __shard_count;
+        }
+
+        /**
+         * @brief creates a shared accessor to shard _index. Shards can only be read from
+         * the outside, modifications have to go through the map so hot key caches stay coherent.
+         */
+        auto get_shared_shard_access(size_type _index, bool _aquire = true)
+        {
+            return __shards[_index].map.get_shared_access(_aquire);
+        }
+
+        /**
+         * @return std::optional<_V> copy of the value mapped to _key, empty if there is none
+         */
+        std::optional<_V> find(const _K &_key)
+        {
+            bool sampled = __sampled();
+            if (sampled)
+                __sample(_key, false);
+
+            std::optional<_V> result;
+            if (__options.enabled && __find_hot(_key, result))
+                return result;
+
+            __probe probe(sampled ? &__contention : nullptr, false);
+            auto access = __shard_for(_key).get_shared_access(false);
+            access.lock();
+            probe.acquired();
+            auto it = access->find(_key);
+            if (it != access->end())
+                result = it->second;
+            return result;
+        }
+
+        bool contains(const _K &_key)
+        {
+            return find(_key).has_value();
+        }
+
+        /**
+         * @brief inserts _value for _key if the key is not present yet.
+         * @return bool true if the element was inserted
+         */
+        bool insert(const _K &_key, const _V &_value)
+        {
+            return __write(_key, [&](shard_container_type &_c)
+            {
+                bool inserted = _c.emplace(_key, _value).second;
+                if (inserted)
+                    __invalidate(_key);
+                return inserted;
+            });
+        }
+
+        /**
+         * @brief inserts _value for _key or overwrites the existing value.
+         * @return bool true if the element was inserted, false if it was assigned
+         */
+        bool insert_or_assign(const _K &_key, const _V &_value)
+        {
+            return __write(_key, [&](shard_container_type &_c)
+            {
+                bool inserted = _c.insert_or_assign(_key, _value).second;
+                __invalidate(_key);
+                return inserted;
+            });
+        }
+
+        /**
+         * @brief calls _fn with a reference to the value of _key while holding the
+         * shard's exclusive lock, if the key is present.
+         * @return bool true if the key was present
+         */
+        template <class _Fn>
+        bool update(const _K &_key, _Fn _fn)
+        {
+            return __write(_key, [&](shard_container_type &_c)
+            {
+                auto it = _c.find(_key);
+                if (it == _c.end())
+                    return false;
+                _fn(it->second);
+                __invalidate(_key);
+                return true;
+            });
+        }
+
+        /**
+         * @return size_type number of elements removed (0 or 1)
+         */
+        size_type erase(const _K &_key)
+        {
+            return __write(_key, [&](shard_container_type &_c)
+            {
+                size_type erased = _c.erase(_key);
+                if (erased)
+                    __invalidate(_key);
+                return erased;
+            });
+        }
+
+        /**
+         * @brief removes all elements, locking one shard at a time
+         */
+        void clear()
+        {
+            for (size_type i = 0; i < __shard_count; i++)
+            {
+                auto access = __shards[i].map.get_exclusive_access();
+                access->clear();
+                __invalidate_shard(i);
+            }
+        }
+
+        /**
+         * @brief replaces the contents of the map with the key/value pairs of the range
+         * [_first, _last) using multiple threads. The shard containers are built in parallel
+         * (see ts::build_parallel()) and then swapped in, locking one shard at a time, so unlike
+         * build_parallel() no serial merge of the partitions is needed. The previous contents
+         * are destroyed after the shard locks have been released.
+         * As with insert(), the first occurrence of a key in the input wins.
+         *
+         * @param _first begin of the input range (random access)
+         * @param _last end of the input range
+         * @param _threads number of threads to use (0 = hardware concurrency)
+         */
+        template <class _It>
+        void build_parallel(_It _first, _It _last, unsigned _threads = 0)
+        {
+            static_assert(
+                std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<_It>::iterator_category>,
+                "ts-stl/sharded_umap build_parallel() requires random access iterators");
+
+            std::vector<shard_container_type> built = __detail::__build_partitions<shard_container_type>(_first, _last, __shard_count, [&](const auto &_element)
+            {
+                return shard_index(_element.first);
+            }, _threads);
+
+            for (size_type i = 0; i < __shard_count; i++)
+            {
+                auto access = __shards[i].map.get_exclusive_access();
+                access->swap(built[i]);
+                __invalidate_shard(i);
+            }
+        }
+
+        /**
+         * @brief sums up the published shard sizes without locking any shard.
+         * Under concurrent modification the result is only approximate.
+         */
+        size_type size()
+        {
+            size_type total = 0;
+            for (size_type i = 0; i < __shard_count; i++)
+                total += __shards[i].map.size();
+            return total;
+        }
+
+        bool empty()
+        {
+            return size() == 0;
+        }
+
+        /**
+         * @brief collects the hot key set, cache hit counters, shard sizes and contention
+         */
+        stats_t stats()
+        {
+            stats_t stats;
+            if (__options.enabled)
+            {
+                epoch_guard guard;
+                if (__hot_set *hot = __hot.load(std::memory_order_seq_cst))
+                {
+                    stats.hot_set_generation = hot->generation;
+                    for (const auto &[key, entry] : hot->entries)
+                        stats.hot_keys.push_back(key);
+                }
+                for (size_type i = 0; i < __cache_count; i++)
+                {
+                    stats.cache_hits += __caches[i].hits.load(std::memory_order_relaxed);
+                    stats.cache_misses += __caches[i].misses.load(std::memory_order_relaxed);
+                }
+            }
+            for (size_type i = 0; i < __shard_count; i++)
+                stats.shard_sizes.push_back(__shards[i].map.size());
+            stats.contention = contention();
+            return stats;
+        }
+
+        /**
+         * @brief lock wait and hold times of the sampled accesses so far. Unlike stats()
+         * this doesn't take any lock, so it can be polled frequently.
+         */
+        ts::contention_stats contention() const
+        {
+            ts::contention_stats result;
+            result.sampled_reads = __contention.reads.load(std::memory_order_relaxed);
+            result.sampled_writes = __contention.writes.load(std::memory_order_relaxed);
+            result.wait = std::chrono::nanoseconds(__contention.wait_ns.load(std::memory_order_relaxed));
+            result.hold = std::chrono::nanoseconds(__contention.hold_ns.load(std::memory_order_relaxed));
+            return result;
+        }
+    };
+
+    /**
+     * @brief calls _fn for every element of a sharded_umap, spreading the shards over
+     * multiple threads. Every shard is locked with shared access on its own while it is
+     * processed, so writers are only blocked on the shard currently being visited.
+     * _fn receives a const reference to each element and has to be safe to call from
+     * multiple threads simultaneously.
+     *
+     * @param _m map to iterate over
+     * @param _fn function called with a const reference to each element
+     * @param _threads number of threads to use (0 = hardware concurrency)
+     */
+    template <class _K, class _V, class _Hash, class _KeyEqual, class _Fn>
+    void parallel_for_each(sharded_umap<_K, _V, _Hash, _KeyEqual> &_m, _Fn _fn, unsigned _threads = 0)
+    {
+        std::size_t shards = _m.shard_count();
+        unsigned n = __detail::__resolve_thread_count(_threads, shards);
+        __detail::__run_parallel(n, [&](unsigned _i)
+        {
+            for (std::size_t s = _i; s < shards; s += n)
+            {
+                auto access = _m.get_shared_shard_access(s);
+                for (const auto &element : *access)
+                    _fn(element);
+            }
+        });
+    }
+
+    /**
+     * @brief maps every element of a sharded_umap to a value of type _R and combines all
+     * of those values into one, spreading the shards over multiple threads. Every shard is
+     * locked with shared access on its own while it is processed.
+     * _combine has to be associative and commutative.
+     *
+     * @param _m map to reduce
+     * @param _init initial value the partial results are combined into
+     * @param _map function converting a const reference to an element into _R
+     * @param _combine function combining two _R values into one
+     * @param _threads number of threads to use (0 = hardware concurrency)
+     * @return _R the combined result (_init if the map is empty)
+     */
+    template <class _K, class _V, class _Hash, class _KeyEqual, class _R, class _Map, class _Combine>
+    _R parallel_reduce(sharded_umap<_K, _V, _Hash, _KeyEqual> &_m, _R _init, _Map _map, _Combine _combine, unsigned _threads = 0)
+    {
+        std::size_t shards = _m.shard_count();
+        unsigned n = __detail::__resolve_thread_count(_threads, shards);
+        std::vector<std::optional<_R>> partials(n);
+        __detail::__run_parallel(n, [&](unsigned _i)
+        {
+            std::optional<_R> &partial = partials[_i];
+            for (std::size_t s = _i; s < shards; s += n)
+            {
+                auto access = _m.get_shared_shard_access(s);
+                for (const auto &element : *access)
+                {
+                    if (partial)
+                        partial = _combine(std::move(*partial), _map(element));
+                    else
+                        partial.emplace(_map(element));
+                }
+            }
+        });
+
+        for (auto &partial : partials)
+            if (partial)
+                _init = _combine(std::move(_init), std::move(*partial));
+        return _init;
+    }
+};
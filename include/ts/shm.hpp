@@ -0,0 +1,978 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 20:05
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Process-shared wrappers living in a POSIX shared memory segment (POSIX only).
+*/
+
+#pragma once
+
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <functional>
+#include <unordered_map>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "wrapper.hpp"
+
+namespace ts
+{
+    namespace __detail
+    {
+        [[noreturn]] inline void __throw_errno(int _error, const char *_what)
+        {
+            throw std::system_error(_error, std::generic_category(), _what);
+        }
+
+        /**
+         * @brief initializes a process-shared robust mutex. If a process dies while holding it,
+         * the next locker is told so and recovers it (see __robust_guard).
+         */
+        inline void __init_robust_mutex(pthread_mutex_t *_mutex)
+        {
+            pthread_mutexattr_t attributes;
+            pthread_mutexattr_init(&attributes);
+            pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+            pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+            int result = pthread_mutex_init(_mutex, &attributes);
+            pthread_mutexattr_destroy(&attributes);
+            if (result != 0)
+                __throw_errno(result, "ts-stl/shm pthread_mutex_init()");
+        }
+
+        /**
+         * @brief holds a robust mutex, making it consistent again if its previous owner died
+         */
+        class __robust_guard
+        {
+        private:
+            pthread_mutex_t *__mutex;
+
+        public:
+            __robust_guard(pthread_mutex_t *_mutex)
+                : __mutex(_mutex)
+            {
+                int result = pthread_mutex_lock(__mutex);
+                if (result == EOWNERDEAD)
+                    pthread_mutex_consistent(__mutex);
+                else if (result != 0)
+                    __throw_errno(result, "ts-stl/shm pthread_mutex_lock()");
+            }
+            ~__robust_guard()
+            {
+                pthread_mutex_unlock(__mutex);
+            }
+
+            __robust_guard(const __robust_guard &) = delete;
+            __robust_guard &operator=(const __robust_guard &) = delete;
+        };
+
+        /**
+         * @brief waits a little longer every time it is called, for polling shared state
+         */
+        class __backoff
+        {
+        private:
+            unsigned __round = 0;
+
+        public:
+            void operator()()
+            {
+                if (__round < 16)
+                    std::this_thread::yield();
+                else
+                    std::this_thread::sleep_for(std::chrono::microseconds(__round < 64 ? 50 : 1000));
+                __round++;
+            }
+        };
+
+        /**
+         * @brief first fit heap inside a shared memory segment. Blocks are addressed by their
+         * offset from the segment base and free blocks form a list sorted by offset, so
+         * neighbouring free blocks can be merged. Allocations are 16 byte aligned.
+         */
+        struct __shm_heap
+        {
+            struct __block
+            {
+                // size including this header
+                std::uint64_t size;
+                // offset of the next free block (0 = none), only used while the block is free
+                std::uint64_t next;
+            };
+
+            static constexpr std::size_t __alignment = 16;
+            static constexpr std::size_t __min_split = 64;
+
+            pthread_mutex_t mutex;
+            char *base;
+            std::uint64_t top;
+            std::uint64_t end;
+            std::uint64_t free_head;
+
+            void init(char *_base, std::size_t _begin, std::size_t _end)
+            {
+                __init_robust_mutex(&mutex);
+                base = _base;
+                top = (_begin + __alignment - 1) / __alignment * __alignment;
+                end = _end;
+                free_head = 0;
+            }
+
+            __block *__at(std::uint64_t _offset) noexcept
+            {
+                return reinterpret_cast<__block *>(base + _offset);
+            }
+
+            void *allocate(std::size_t _bytes)
+            {
+                std::uint64_t need = (_bytes + __alignment - 1) / __alignment * __alignment + sizeof(__block);
+                __robust_guard guard(&mutex);
+
+                std::uint64_t *link = &free_head;
+                for (std::uint64_t offset = free_head; offset != 0; offset = __at(offset)->next)
+                {
+                    __block *block = __at(offset);
+                    if (block->size >= need)
+                    {
+                        if (block->size - need >= __min_split)
+                        {
+                            __block *rest = __at(offset + need);
+                            rest->size = block->size - need;
+                            rest->next = block->next;
+                            *link = offset + need;
+                            block->size = need;
+                        }
+                        else
+                            *link = block->next;
+                        return block + 1;
+                    }
+                    link = &block->next;
+                }
+
+                if (end - top < need)
+                    throw std::bad_alloc();
+                __block *block = __at(top);
+                block->size = need;
+                top += need;
+                return block + 1;
+            }
+
+            void deallocate(void *_pointer)
+            {
+                __block *block = static_cast<__block *>(_pointer) - 1;
+                std::uint64_t offset = reinterpret_cast<char *>(block) - base;
+                __robust_guard guard(&mutex);
+
+                std::uint64_t previous = 0;
+                std::uint64_t next = free_head;
+                while (next != 0 && next < offset)
+                {
+                    previous = next;
+                    next = __at(next)->next;
+                }
+
+                // merge with the following free block
+                if (next != 0 && offset + block->size == next)
+                {
+                    block->size += __at(next)->size;
+                    block->next = __at(next)->next;
+                }
+                else
+                    block->next = next;
+
+                // merge with the preceding free block
+                if (previous != 0 && previous + __at(previous)->size == offset)
+                {
+                    __at(previous)->size += block->size;
+                    __at(previous)->next = block->next;
+                }
+                else if (previous != 0)
+                    __at(previous)->next = offset;
+                else
+                    free_head = offset;
+            }
+
+            std::size_t free_memory()
+            {
+                __robust_guard guard(&mutex);
+                std::size_t total = end - top;
+                for (std::uint64_t offset = free_head; offset != 0; offset = __at(offset)->next)
+                    total += __at(offset)->size;
+                return total;
+            }
+        };
+
+        /**
+         * @brief named object in the directory of a segment
+         */
+        struct __shm_entry
+        {
+            char name[48];
+            std::uint64_t size;
+            void *object;
+        };
+
+        /**
+         * @brief start of every segment
+         */
+        struct __shm_header
+        {
+            static constexpr std::uint64_t magic_value = 0x7473746c73686d31; // "tstlshm1"
+            static constexpr std::size_t directory_size = 64;
+
+            std::atomic<std::uint64_t> magic;
+            void *base;
+            std::uint64_t size;
+            __shm_heap heap;
+            pthread_mutex_t directory_mutex;
+            __shm_entry directory[directory_size];
+        };
+    };
+
+    /**
+     * @brief allocator handing out memory of a shm_segment. Containers using it can be placed in
+     * the segment (see shm_segment::find_or_construct()) and used from all processes mapping it.
+     * As segments are mapped at the same address in every process, allocations are plain
+     * pointers, so it works with all standard containers (which don't support offset pointers).
+     *
+     * @tparam _T value type
+     */
+    template <class _T>
+    class shm_allocator
+    {
+        template <class _U>
+        friend class shm_allocator;
+
+    private:
+        __detail::__shm_heap *__heap;
+
+    public:
+        typedef _T value_type;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        explicit shm_allocator(__detail::__shm_heap *_heap) noexcept
+            : __heap(_heap)
+        {
+        }
+        template <class _U>
+        shm_allocator(const shm_allocator<_U> &_other) noexcept
+            : __heap(_other.__heap)
+        {
+        }
+
+        _T *allocate(std::size_t _n)
+        {
+            static_assert(alignof(_T) <= __detail::__shm_heap::__alignment, "ts-stl/shm_allocator over-aligned types are not supported");
+            return static_cast<_T *>(__heap->allocate(_n * sizeof(_T)));
+        }
+
+        void deallocate(_T *_pointer, std::size_t) noexcept
+        {
+            __heap->deallocate(_pointer);
+        }
+
+        template <class _U>
+        bool operator==(const shm_allocator<_U> &_other) const noexcept
+        {
+            return __heap == _other.__heap;
+        }
+        template <class _U>
+        bool operator!=(const shm_allocator<_U> &_other) const noexcept
+        {
+            return __heap != _other.__heap;
+        }
+    };
+
+    /**
+     * @brief reader/writer lock for use between processes, to be placed in shared memory as
+     * the mutex of a wrapper (see shm_umap). It meets the (shared) timed mutex requirements.
+     *
+     * The lock state is guarded by a robust process-shared mutex. Every thread holding or
+     * waiting for the lock has an entry with a robust mutex of its own, which the thread keeps
+     * locked as long as it uses the entry. If a thread or its process dies while holding the
+     * lock, the next waiter finds that mutex abandoned and releases the ownership (see
+     * recoveries()). Waiting writers are counted and block new readers, so readers can't
+     * starve them. At most 64 threads can hold or wait for the lock at the same time, further
+     * ones keep waiting until an entry is free.
+     */
+    class shm_shared_mutex
+    {
+    private:
+        static constexpr std::uint32_t __max_entries = 64;
+
+        enum __entry_state : std::uint32_t
+        {
+            __free = 0,
+            __reading,
+            __writing,
+            // waiting for exclusive access
+            __pending,
+        };
+
+        struct __entry
+        {
+            // locked by the owning thread while the entry is in use
+            pthread_mutex_t alive;
+            __entry_state state;
+            // shared locks held by the owning thread
+            std::uint32_t count;
+            // identifies the claim, so a thread can't mistake a reused entry for its own
+            std::uint64_t token;
+        };
+
+        /**
+         * @brief the entry a thread has claimed in a lock
+         */
+        struct __claim
+        {
+            const shm_shared_mutex *mutex;
+            std::uint32_t index;
+            std::uint64_t token;
+        };
+
+        pthread_mutex_t __mutex;
+        bool __writer = false;
+        std::uint32_t __readers = 0;
+        std::uint32_t __waiting_writers = 0;
+        std::uint32_t __recoveries = 0;
+        std::uint64_t __next_token = 0;
+        __entry __entries[__max_entries];
+
+        static std::vector<__claim> &__claims()
+        {
+            thread_local std::vector<__claim> claims;
+            return claims;
+        }
+
+        /**
+         * @brief the entry of the calling thread, or nullptr. __mutex has to be held.
+         */
+        __entry *__own_entry()
+        {
+            for (const __claim &claim : __claims())
+            {
+                if (claim.mutex != this)
+                    continue;
+                __entry &entry = __entries[claim.index];
+                return entry.state != __free && entry.token == claim.token ? &entry : nullptr;
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief the entry of the calling thread, claiming a free one if it has none.
+         * __mutex has to be held.
+         * @return __entry* nullptr if all entries are in use
+         */
+        __entry *__claim_entry(__entry_state _state)
+        {
+            if (__entry *entry = __own_entry())
+                return entry;
+            std::vector<__claim> &claims = __claims();
+            // a claim in this lock that turned stale (e.g. reaped) is replaced
+            for (auto it = claims.begin(); it != claims.end(); ++it)
+            {
+                if (it->mutex == this)
+                {
+                    claims.erase(it);
+                    break;
+                }
+            }
+            for (std::uint32_t i = 0; i < __max_entries; i++)
+            {
+                __entry &entry = __entries[i];
+                if (entry.state != __free)
+                    continue;
+                claims.reserve(claims.size() + 1);
+                int result = pthread_mutex_lock(&entry.alive);
+                if (result == EOWNERDEAD)
+                    pthread_mutex_consistent(&entry.alive);
+                else if (result != 0)
+                    __detail::__throw_errno(result, "ts-stl/shm pthread_mutex_lock()");
+                entry.state = _state;
+                entry.count = 0;
+                entry.token = ++__next_token;
+                claims.push_back({this, i, entry.token});
+                return &entry;
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief frees _entry of the calling thread. __mutex has to be held.
+         */
+        void __release_entry(__entry &_entry)
+        {
+            _entry.state = __free;
+            pthread_mutex_unlock(&_entry.alive);
+            std::vector<__claim> &claims = __claims();
+            for (auto it = claims.begin(); it != claims.end(); ++it)
+            {
+                if (it->mutex == this)
+                {
+                    claims.erase(it);
+                    break;
+                }
+            }
+        }
+
+        /**
+         * @brief takes back the entries of threads that died, found by their abandoned entry
+         * mutex. __mutex has to be held.
+         */
+        void __reap()
+        {
+            __entry *own = __own_entry();
+            for (__entry &entry : __entries)
+            {
+                if (entry.state == __free || &entry == own)
+                    continue;
+                int result = pthread_mutex_trylock(&entry.alive);
+                if (result == EBUSY)
+                    continue;
+                if (result == EOWNERDEAD)
+                    pthread_mutex_consistent(&entry.alive);
+                else if (result != 0)
+                    continue;
+                // the owner is gone (an unlocked entry in use can only be left by a dead one as well)
+                switch (entry.state)
+                {
+                case __writing:
+                    __writer = false;
+                    __recoveries++;
+                    break;
+                case __reading:
+                    __readers--;
+                    __recoveries++;
+                    break;
+                case __pending:
+                    __waiting_writers--;
+                    break;
+                case __free:
+                    break;
+                }
+                entry.state = __free;
+                pthread_mutex_unlock(&entry.alive);
+            }
+        }
+
+        bool __try_exclusive(bool _wait)
+        {
+            __detail::__robust_guard guard(&__mutex);
+            for (int attempt = 0; attempt < 2; attempt++)
+            {
+                if (!__writer && __readers == 0)
+                {
+                    __entry *entry = __claim_entry(__writing);
+                    if (entry == nullptr)
+                        return false;
+                    if (entry->state == __pending)
+                        __waiting_writers--;
+                    entry->state = __writing;
+                    __writer = true;
+                    return true;
+                }
+                if (attempt == 0)
+                    __reap();
+            }
+            if (_wait)
+            {
+                __entry *entry = __claim_entry(__pending);
+                if (entry != nullptr && entry->state == __pending && entry->count == 0)
+                {
+                    // count marks the entry as registered in __waiting_writers
+                    entry->count = 1;
+                    __waiting_writers++;
+                }
+            }
+            return false;
+        }
+
+        bool __try_shared()
+        {
+            __detail::__robust_guard guard(&__mutex);
+            for (int attempt = 0; attempt < 2; attempt++)
+            {
+                __entry *own = __own_entry();
+                // a thread already reading may lock again, even if writers are waiting
+                if (own != nullptr && own->state == __reading)
+                {
+                    own->count++;
+                    return true;
+                }
+                if (!__writer && __waiting_writers == 0)
+                {
+                    __entry *entry = __claim_entry(__reading);
+                    if (entry == nullptr)
+                        return false;
+                    entry->count = 1;
+                    __readers++;
+                    return true;
+                }
+                if (attempt == 0)
+                    __reap();
+            }
+            return false;
+        }
+
+        void __give_up_pending()
+        {
+            __detail::__robust_guard guard(&__mutex);
+            __entry *entry = __own_entry();
+            if (entry == nullptr || entry->state != __pending)
+                return;
+            if (entry->count != 0)
+                __waiting_writers--;
+            __release_entry(*entry);
+        }
+
+    public:
+        shm_shared_mutex()
+        {
+            __detail::__init_robust_mutex(&__mutex);
+            for (__entry &entry : __entries)
+            {
+                __detail::__init_robust_mutex(&entry.alive);
+                entry.state = __free;
+                entry.count = 0;
+                entry.token = 0;
+            }
+        }
+        ~shm_shared_mutex()
+        {
+            for (__entry &entry : __entries)
+                pthread_mutex_destroy(&entry.alive);
+            pthread_mutex_destroy(&__mutex);
+        }
+
+        shm_shared_mutex(const shm_shared_mutex &) = delete;
+        shm_shared_mutex &operator=(const shm_shared_mutex &) = delete;
+
+        /**
+         * @return std::uint32_t number of times the lock was taken back from a dead thread or
+         * process. The data it guarded may have been left half modified.
+         */
+        std::uint32_t recoveries()
+        {
+            __detail::__robust_guard guard(&__mutex);
+            return __recoveries;
+        }
+
+        bool try_lock()
+        {
+            return __try_exclusive(false);
+        }
+
+        void lock()
+        {
+            for (__detail::__backoff backoff; !__try_exclusive(true);)
+                backoff();
+        }
+
+        template <class _Clock, class _Duration>
+        bool try_lock_until(const std::chrono::time_point<_Clock, _Duration> &_time)
+        {
+            for (__detail::__backoff backoff; !__try_exclusive(true);)
+            {
+                if (_Clock::now() >= _time)
+                {
+                    __give_up_pending();
+                    return false;
+                }
+                backoff();
+            }
+            return true;
+        }
+
+        template <class _Rep, class _Period>
+        bool try_lock_for(const std::chrono::duration<_Rep, _Period> &_duration)
+        {
+            return try_lock_until(std::chrono::steady_clock::now() + _duration);
+        }
+
+        void unlock()
+        {
+            __detail::__robust_guard guard(&__mutex);
+            __entry *entry = __own_entry();
+            if (entry == nullptr || entry->state != __writing)
+                return;
+            __writer = false;
+            __release_entry(*entry);
+        }
+
+        bool try_lock_shared()
+        {
+            return __try_shared();
+        }
+
+        void lock_shared()
+        {
+            for (__detail::__backoff backoff; !__try_shared();)
+                backoff();
+        }
+
+        template <class _Clock, class _Duration>
+        bool try_lock_shared_until(const std::chrono::time_point<_Clock, _Duration> &_time)
+        {
+            for (__detail::__backoff backoff; !__try_shared();)
+            {
+                if (_Clock::now() >= _time)
+                    return false;
+                backoff();
+            }
+            return true;
+        }
+
+        template <class _Rep, class _Period>
+        bool try_lock_shared_for(const std::chrono::duration<_Rep, _Period> &_duration)
+        {
+            return try_lock_shared_until(std::chrono::steady_clock::now() + _duration);
+        }
+
+        void unlock_shared()
+        {
+            __detail::__robust_guard guard(&__mutex);
+            __entry *entry = __own_entry();
+            if (entry == nullptr || entry->state != __reading)
+                return;
+            if (--entry->count == 0)
+            {
+                __readers--;
+                __release_entry(*entry);
+            }
+        }
+    };
+
+    namespace __detail
+    {
+        template <>
+        struct __process_shared_mutex<shm_shared_mutex> : std::true_type
+        {
+        };
+    };
+
+    /**
+     * @brief POSIX shared memory segment (shm_open) that is mapped at the same address in
+     * every process using it, so containers and wrappers can be constructed in it and used by
+     * all of them without serialization (e.g. one copy of a large lookup table for a group of
+     * worker processes). Objects are created and looked up by name with find_or_construct().
+     *
+     * The first process creates the segment and chooses its address (or uses _address), the
+     * others map it at the same address and fail with a std::system_error if that range is
+     * already in use in their address space. The segment stays in the system until remove()
+     * is called, even if all processes unmapped it.
+     *
+     * Objects placed in the segment must only contain pointers into the segment, e.g. use
+     * shm_allocator for all their allocations (see shm_umap, shm_map, shm_string).
+     */
+    class shm_segment
+    {
+    private:
+        __detail::__shm_header *__header = nullptr;
+        std::size_t __size = 0;
+        bool __created = false;
+
+        static void *__map(int _fd, std::size_t _size, void *_address)
+        {
+            int flags = MAP_SHARED;
+#ifdef MAP_FIXED_NOREPLACE
+            if (_address != nullptr)
+                flags |= MAP_FIXED_NOREPLACE;
+#endif
+            void *mapping = mmap(_address, _size, PROT_READ | PROT_WRITE, flags, _fd, 0);
+            if (mapping == MAP_FAILED)
+                __detail::__throw_errno(errno, "ts-stl/shm mmap()");
+            if (_address != nullptr && mapping != _address)
+            {
+                munmap(mapping, _size);
+                __detail::__throw_errno(EEXIST, "ts-stl/shm segment address is not available in this process");
+            }
+            return mapping;
+        }
+
+        void __create(int _fd, std::size_t _size, void *_address)
+        {
+            if (ftruncate(_fd, _size) != 0)
+                __detail::__throw_errno(errno, "ts-stl/shm ftruncate()");
+            void *base = __map(_fd, _size, _address);
+
+            __header = new (base) __detail::__shm_header;
+            __header->base = base;
+            __header->size = _size;
+            __header->heap.init(static_cast<char *>(base), sizeof(__detail::__shm_header), _size);
+            __detail::__init_robust_mutex(&__header->directory_mutex);
+            std::memset(__header->directory, 0, sizeof(__header->directory));
+            __header->magic.store(__detail::__shm_header::magic_value, std::memory_order_release);
+            __size = _size;
+            __created = true;
+        }
+
+        void __open(int _fd)
+        {
+            // wait for the creator to size and initialize the segment
+            struct stat info;
+            __detail::__backoff backoff;
+            for (;;)
+            {
+                if (fstat(_fd, &info) != 0)
+                    __detail::__throw_errno(errno, "ts-stl/shm fstat()");
+                if (static_cast<std::size_t>(info.st_size) >= sizeof(__detail::__shm_header))
+                    break;
+                backoff();
+            }
+            auto *probe = static_cast<__detail::__shm_header *>(__map(_fd, sizeof(__detail::__shm_header), nullptr));
+            while (probe->magic.load(std::memory_order_acquire) != __detail::__shm_header::magic_value)
+                backoff();
+            void *base = probe->base;
+            std::size_t size = probe->size;
+            munmap(probe, sizeof(__detail::__shm_header));
+
+            __header = static_cast<__detail::__shm_header *>(__map(_fd, size, base));
+            __size = size;
+        }
+
+    public:
+        /**
+         * @brief opens the segment _name, creating it with _size bytes if it doesn't exist yet
+         *
+         * @param _name shm_open() name, e.g. "/lookup-table"
+         * @param _size size of the segment if it is created (fixed, it never grows)
+         * @param _address address to map the segment at if it is created, nullptr to let the system choose
+         */
+        shm_segment(const char *_name, std::size_t _size, void *_address = nullptr)
+        {
+            for (;;)
+            {
+                int fd = shm_open(_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+                bool create = fd >= 0;
+                if (!create && errno == EEXIST)
+                    fd = shm_open(_name, O_RDWR, 0600);
+                if (fd < 0)
+                {
+                    // removed between the two calls
+                    if (errno == ENOENT)
+                        continue;
+                    __detail::__throw_errno(errno, "ts-stl/shm shm_open()");
+                }
+
+                try
+                {
+                    if (create)
+                        __create(fd, _size, _address);
+                    else
+                        __open(fd);
+                }
+                catch (...)
+                {
+                    close(fd);
+                    if (create)
+                        shm_unlink(_name);
+                    throw;
+                }
+                close(fd);
+                return;
+            }
+        }
+
+        /**
+         * @brief unmaps the segment. Objects in it stay intact for other processes.
+         */
+        ~shm_segment()
+        {
+            if (__header != nullptr)
+                munmap(__header, __size);
+        }
+
+        shm_segment(const shm_segment &) = delete;
+        shm_segment &operator=(const shm_segment &) = delete;
+
+        /**
+         * @brief removes the segment _name from the system. Processes that have it mapped can
+         * continue to use it, it is freed when the last of them unmapped it.
+         *
+         * @return bool whether the segment existed
+         */
+        static bool remove(const char *_name) noexcept
+        {
+            return shm_unlink(_name) == 0;
+        }
+
+        /**
+         * @return bool whether this process created the segment
+         */
+        bool created() const noexcept
+        {
+            return __created;
+        }
+
+        void *base() const noexcept
+        {
+            return __header;
+        }
+
+        std::size_t size() const noexcept
+        {
+            return __size;
+        }
+
+        /**
+         * @return std::size_t bytes that can still be allocated (possibly fragmented)
+         */
+        std::size_t free_memory() const
+        {
+            return __header->heap.free_memory();
+        }
+
+        shm_allocator<char> get_allocator() const noexcept
+        {
+            return shm_allocator<char>(&__header->heap);
+        }
+
+        /**
+         * @brief returns the object named _name, constructing it from _args if it doesn't exist yet.
+         * Creating and looking up named objects is serialized between processes, so exactly one
+         * process constructs it. A wrapper of a container taking an allocator (e.g. shm_umap) is
+         * constructed empty, using the segment's allocator.
+         * Throws std::invalid_argument if the object exists with a different size.
+         *
+         * @tparam _T object type
+         * @param _name name of the object, at most 47 characters
+         */
+        template <class _T, class... _Args>
+        _T *find_or_construct(const char *_name, _Args &&..._args)
+        {
+            __detail::__robust_guard guard(&__header->directory_mutex);
+            __detail::__shm_entry *empty = nullptr;
+            for (__detail::__shm_entry &entry : __header->directory)
+            {
+                if (entry.object != nullptr && std::strncmp(entry.name, _name, sizeof(entry.name)) == 0)
+                {
+                    if (entry.size != sizeof(_T))
+                        throw std::invalid_argument("ts-stl/shm find_or_construct() object exists with a different type");
+                    return static_cast<_T *>(entry.object);
+                }
+                if (entry.object == nullptr && empty == nullptr)
+                    empty = &entry;
+            }
+            if (empty == nullptr)
+                throw std::length_error("ts-stl/shm find_or_construct() directory is full");
+            if (std::strlen(_name) >= sizeof(empty->name))
+                throw std::invalid_argument("ts-stl/shm find_or_construct() name is too long");
+
+            shm_allocator<_T> allocator(get_allocator());
+            _T *object = allocator.allocate(1);
+            try
+            {
+                __construct(object, std::forward<_Args>(_args)...);
+            }
+            catch (...)
+            {
+                allocator.deallocate(object, 1);
+                throw;
+            }
+            std::strncpy(empty->name, _name, sizeof(empty->name) - 1);
+            empty->size = sizeof(_T);
+            empty->object = object;
+            return object;
+        }
+
+        /**
+         * @brief returns the object named _name or nullptr if it doesn't exist.
+         * Throws std::invalid_argument if the object exists with a different size.
+         */
+        template <class _T>
+        _T *find(const char *_name)
+        {
+            __detail::__robust_guard guard(&__header->directory_mutex);
+            for (__detail::__shm_entry &entry : __header->directory)
+            {
+                if (entry.object != nullptr && std::strncmp(entry.name, _name, sizeof(entry.name)) == 0)
+                {
+                    if (entry.size != sizeof(_T))
+                        throw std::invalid_argument("ts-stl/shm find() object exists with a different type");
+                    return static_cast<_T *>(entry.object);
+                }
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief destroys the object named _name and frees its memory. No process may use it anymore.
+         *
+         * @return bool whether the object existed
+         */
+        template <class _T>
+        bool destroy(const char *_name)
+        {
+            __detail::__robust_guard guard(&__header->directory_mutex);
+            for (__detail::__shm_entry &entry : __header->directory)
+            {
+                if (entry.object != nullptr && std::strncmp(entry.name, _name, sizeof(entry.name)) == 0)
+                {
+                    _T *object = static_cast<_T *>(entry.object);
+                    object->~_T();
+                    shm_allocator<_T>(get_allocator()).deallocate(object, 1);
+                    entry = {};
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        template <class _T, class... _Args>
+        void __construct(_T *_object, _Args &&..._args)
+        {
+            if constexpr (std::uses_allocator_v<_T, shm_allocator<char>>)
+                new (_object) _T(std::forward<_Args>(_args)..., get_allocator());
+            else
+                new (_object) _T(std::forward<_Args>(_args)...);
+        }
+
+        // an empty wrapper of an allocator aware container
+        template <class _C, class _MT>
+        void __construct(wrapper<_C, _MT> *_object)
+        {
+            if constexpr (std::uses_allocator_v<_C, shm_allocator<char>>)
+                new (_object) wrapper<_C, _MT>(_C(typename _C::allocator_type(get_allocator())));
+            else
+                new (_object) wrapper<_C, _MT>();
+        }
+    };
+
+    // containers and wrappers for shm_segment
+
+    template <class _K, class _V, class _Hash = std::hash<_K>, class _Eq = std::equal_to<_K>>
+    using shm_umap = wrapper<std::unordered_map<_K, _V, _Hash, _Eq, shm_allocator<std::pair<const _K, _V>>>, shm_shared_mutex>;
+
+    template <class _K, class _V, class _Cmp = std::less<_K>>
+    using shm_map = wrapper<std::map<_K, _V, _Cmp, shm_allocator<std::pair<const _K, _V>>>, shm_shared_mutex>;
+
+    // string allocating from a segment, e.g. for values of a shm_umap
+    using shm_string = std::basic_string<char, std::char_traits<char>, shm_allocator<char>>;
+};
@@ -0,0 +1,587 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+18.10.26, 00:21
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Wrapper statistics published in a shared memory file that other processes can read without locks (POSIX only).
+*/
+
+#pragma once
+
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace ts
+{
+    /**
+     * @brief statistics of one wrapper as read from a stats file, see stats_reader
+     */
+    struct wrapper_stats
+    {
+        // changes whenever a slot is reused for another wrapper
+        std::uint64_t id = 0;
+        // name of the wrapper (see wrapper::set_name()), empty if it has none
+        std::string name;
+        // container metadata as published by the last unique accessor (see wrapper::metadata())
+        std::uint64_t size = 0;
+        std::uint64_t bucket_count = 0;
+        float load_factor = 0;
+        std::uint64_t bytes = 0;
+        std::uint64_t generation = 0;
+        // locks taken by accessors
+        std::uint64_t shared_acquisitions = 0;
+        std::uint64_t exclusive_acquisitions = 0;
+        // acquisitions that had to wait because try_lock() failed, and waits that timed out
+        std::uint64_t contended = 0;
+        std::uint64_t timeouts = 0;
+        // total time accessors waited for and held the lock
+        std::chrono::nanoseconds wait{0};
+        std::chrono::nanoseconds hold{0};
+    };
+
+    namespace __detail
+    {
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<float>::is_always_lock_free,
+                      "ts-stl/stats needs lock-free atomics to share them between processes");
+
+        /**
+         * @brief statistics of one wrapper in the stats file. The name and metadata are written
+         * behind a sequence counter by the wrapper (serialized by its exclusive lock), the
+         * counters are incremented by all accessors. Slots are cache line aligned, so wrappers
+         * don't contend on each other's counters.
+         */
+        struct alignas(64) __stats_slot
+        {
+            std::atomic<std::uint32_t> claimed{0};
+            // odd while the wrapper is writing
+            std::atomic<std::uint64_t> sequence{0};
+            std::atomic<std::uint32_t> active{0};
+            std::atomic<std::uint64_t> id{0};
+            // name packed into words so it can be read without tearing
+            std::atomic<std::uint64_t> name[4];
+            std::atomic<std::uint64_t> size{0};
+            std::atomic<std::uint64_t> bucket_count{0};
+            std::atomic<float> load_factor{0};
+            std::atomic<std::uint64_t> bytes{0};
+            std::atomic<std::uint64_t> generation{0};
+
+            std::atomic<std::uint64_t> shared_acquisitions{0};
+            std::atomic<std::uint64_t> exclusive_acquisitions{0};
+            std::atomic<std::uint64_t> contended{0};
+            std::atomic<std::uint64_t> timeouts{0};
+            std::atomic<std::uint64_t> wait_ns{0};
+            std::atomic<std::uint64_t> hold_ns{0};
+
+            template <class _Fn>
+            void write(_Fn &&_fn) noexcept
+            {
+                std::uint64_t before = sequence.load(std::memory_order_relaxed);
+                sequence.store(before + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                _fn();
+                sequence.store(before + 2, std::memory_order_release);
+            }
+
+            void set_name(const char *_name) noexcept
+            {
+                char packed[sizeof(name)] = {};
+                if (_name)
+                    std::strncpy(packed, _name, sizeof(packed) - 1);
+                write([&]
+                {
+                    for (std::size_t i = 0; i < 4; i++)
+                    {
+                        std::uint64_t word;
+                        std::memcpy(&word, packed + i * sizeof(word), sizeof(word));
+                        name[i].store(word, std::memory_order_relaxed);
+                    }
+                });
+            }
+
+            void publish(std::uint64_t _size, std::uint64_t _bucket_count, float _load_factor, std::uint64_t _bytes, std::uint64_t _generation) noexcept
+            {
+                write([&]
+                {
+                    size.store(_size, std::memory_order_relaxed);
+                    bucket_count.store(_bucket_count, std::memory_order_relaxed);
+                    load_factor.store(_load_factor, std::memory_order_relaxed);
+                    bytes.store(_bytes, std::memory_order_relaxed);
+                    generation.store(_generation, std::memory_order_relaxed);
+                });
+            }
+
+            /**
+             * @brief reads the slot into _stats if it belongs to a wrapper. Gives up after a few
+             * attempts, so a process that died while writing can't stall the reader.
+             */
+            bool read(wrapper_stats &_stats) const noexcept
+            {
+                for (int attempt = 0; attempt < 64; attempt++)
+                {
+                    std::uint64_t before = sequence.load(std::memory_order_acquire);
+                    if (before & 1)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    bool is_active = active.load(std::memory_order_relaxed) != 0;
+                    char packed[sizeof(name) + 1] = {};
+                    for (std::size_t i = 0; i < 4; i++)
+                    {
+                        std::uint64_t word = name[i].load(std::memory_order_relaxed);
+                        std::memcpy(packed + i * sizeof(word), &word, sizeof(word));
+                    }
+                    _stats.id = id.load(std::memory_order_relaxed);
+                    _stats.size = size.load(std::memory_order_relaxed);
+                    _stats.bucket_count = bucket_count.load(std::memory_order_relaxed);
+                    _stats.load_factor = load_factor.load(std::memory_order_relaxed);
+                    _stats.bytes = bytes.load(std::memory_order_relaxed);
+                    _stats.generation = generation.load(std::memory_order_relaxed);
+                    _stats.shared_acquisitions = shared_acquisitions.load(std::memory_order_relaxed);
+                    _stats.exclusive_acquisitions = exclusive_acquisitions.load(std::memory_order_relaxed);
+                    _stats.contended = contended.load(std::memory_order_relaxed);
+                    _stats.timeouts = timeouts.load(std::memory_order_relaxed);
+                    _stats.wait = std::chrono::nanoseconds(wait_ns.load(std::memory_order_relaxed));
+                    _stats.hold = std::chrono::nanoseconds(hold_ns.load(std::memory_order_relaxed));
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (sequence.load(std::memory_order_relaxed) != before)
+                        continue;
+                    if (!is_active)
+                        return false;
+                    _stats.name = packed;
+                    return true;
+                }
+                return false;
+            }
+        };
+
+        /**
+         * @brief layout of a stats file. The magic and version are written last by the creating
+         * process, so a reader never sees a half initialized file as valid.
+         */
+        struct __stats_file
+        {
+            static constexpr std::uint64_t magic_value = 0x7473737461747331; // "tsstats1"
+            static constexpr std::uint32_t version_value = 2;
+            static constexpr std::size_t capacity = 2048;
+
+            std::atomic<std::uint64_t> magic{0};
+            std::atomic<std::uint32_t> version{0};
+            std::atomic<std::uint32_t> slot_count{0};
+            std::atomic<std::int64_t> pid{0};
+            // number of wrappers ever registered, source of the slot ids
+            std::atomic<std::uint64_t> registrations{0};
+            // slots currently claimed, and wrappers that found no free slot and aren't recorded
+            std::atomic<std::uint32_t> claimed_slots{0};
+            std::atomic<std::uint64_t> dropped{0};
+            __stats_slot slots[capacity];
+        };
+
+        /**
+         * @brief the stats file of this process, created on first use and removed at exit.
+         * If it can't be created, statistics are silently not recorded.
+         *
+         * A child created with fork() inherits the mapping, and so the slots of the wrappers it
+         * inherited. So that it doesn't count into its parent's file, the child copies the file
+         * into one of its own and maps that at the same address.
+         */
+        class __stats_segment
+        {
+        private:
+            __stats_file *__file = nullptr;
+            // process that created the file, only that one removes it
+            pid_t __owner = 0;
+            char __path[32] = {};
+            // slot the next claim starts looking at
+            std::atomic<std::size_t> __hint{0};
+
+            /**
+             * @brief writes "/ts-stl.<_pid>" to __path, without formatting functions (see __after_fork())
+             */
+            void __name(pid_t _pid) noexcept
+            {
+                char digits[24];
+                std::size_t count = 0;
+                unsigned long value = static_cast<unsigned long>(_pid);
+                do
+                {
+                    digits[count++] = static_cast<char>('0' + value % 10);
+                    value /= 10;
+                } while (value != 0);
+                std::memcpy(__path, "/ts-stl.", 8);
+                for (std::size_t i = 0; i < count; i++)
+                    __path[8 + i] = digits[count - 1 - i];
+                __path[8 + count] = 0;
+            }
+
+            /**
+             * @brief creates (or resets) and maps the file of the calling process, at _address if given
+             */
+            __stats_file *__create(void *_address) noexcept
+            {
+                __name(getpid());
+                int descriptor = shm_open(__path, O_CREAT | O_RDWR, 0644);
+                if (descriptor < 0)
+                    return nullptr;
+                // a stale file of an earlier process with the same pid is reset
+                bool sized = ftruncate(descriptor, 0) == 0 && ftruncate(descriptor, sizeof(__stats_file)) == 0;
+                void *memory = sized ? mmap(_address, sizeof(__stats_file), PROT_READ | PROT_WRITE, MAP_SHARED | (_address ? MAP_FIXED : 0), descriptor, 0) : MAP_FAILED;
+                close(descriptor);
+                if (memory == MAP_FAILED)
+                {
+                    shm_unlink(__path);
+                    return nullptr;
+                }
+                __owner = getpid();
+                return static_cast<__stats_file *>(memory);
+            }
+
+            __stats_segment()
+            {
+                __stats_file *file = __create(nullptr);
+                if (file == nullptr)
+                    return;
+                __file = new (file) __stats_file();
+                __file->slot_count.store(__stats_file::capacity, std::memory_order_relaxed);
+                __file->pid.store(__owner, std::memory_order_relaxed);
+                __file->version.store(__stats_file::version_value, std::memory_order_relaxed);
+                __file->magic.store(__stats_file::magic_value, std::memory_order_release);
+                pthread_atfork(nullptr, nullptr, &__after_fork);
+            }
+
+            /**
+             * @brief runs in the child after fork(): moves the inherited slots into a file of the
+             * child, mapped where the parent's was, so pointers to slots stay valid
+             */
+            static void __after_fork() noexcept
+            {
+                __stats_segment &segment = instance();
+                if (segment.__file == nullptr)
+                    return;
+                // the parent's contents are kept in a private copy while the address is remapped
+                void *copy = mmap(nullptr, sizeof(__stats_file), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (copy != MAP_FAILED)
+                    std::memcpy(copy, static_cast<void *>(segment.__file), sizeof(__stats_file));
+                if (copy != MAP_FAILED && segment.__create(segment.__file) != nullptr)
+                {
+                    std::memcpy(static_cast<void *>(segment.__file), copy, sizeof(__stats_file));
+                    segment.__file->pid.store(segment.__owner, std::memory_order_relaxed);
+                }
+                else
+                {
+                    // no file of its own: keep counting into private memory nobody reads, and record no new wrappers
+                    mmap(segment.__file, sizeof(__stats_file), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+                    segment.__file = nullptr;
+                    segment.__owner = 0;
+                    segment.__path[0] = 0;
+                }
+                if (copy != MAP_FAILED)
+                    munmap(copy, sizeof(__stats_file));
+            }
+
+        public:
+            // the mapping is kept until the process exits, so wrappers destroyed after this can still unregister
+            ~__stats_segment()
+            {
+                if (__file && __owner == getpid())
+                    shm_unlink(__path);
+            }
+
+            static __stats_segment &instance()
+            {
+                static __stats_segment segment;
+                return segment;
+            }
+
+            const char *path() const noexcept
+            {
+                return __path;
+            }
+
+            /**
+             * @brief claims a free slot, starting after the last one claimed. If all are taken,
+             * the wrapper is counted as dropped without scanning the table.
+             */
+            __stats_slot *claim() noexcept
+            {
+                if (__file == nullptr)
+                    return nullptr;
+                if (__file->claimed_slots.load(std::memory_order_relaxed) >= __stats_file::capacity)
+                {
+                    __file->dropped.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+                std::size_t hint = __hint.load(std::memory_order_relaxed);
+                for (std::size_t i = 0; i < __stats_file::capacity; i++)
+                {
+                    std::size_t index = (hint + i) % __stats_file::capacity;
+                    __stats_slot &slot = __file->slots[index];
+                    std::uint32_t expected = 0;
+                    if (!slot.claimed.load(std::memory_order_relaxed) && slot.claimed.compare_exchange_strong(expected, 1, std::memory_order_acquire))
+                    {
+                        __hint.store((index + 1) % __stats_file::capacity, std::memory_order_relaxed);
+                        __file->claimed_slots.fetch_add(1, std::memory_order_relaxed);
+                        std::uint64_t id = __file->registrations.fetch_add(1, std::memory_order_relaxed) + 1;
+                        slot.write([&]
+                        {
+                            slot.id.store(id, std::memory_order_relaxed);
+                            for (auto &word : slot.name)
+                                word.store(0, std::memory_order_relaxed);
+                            slot.size.store(0, std::memory_order_relaxed);
+                            slot.bucket_count.store(0, std::memory_order_relaxed);
+                            slot.load_factor.store(0, std::memory_order_relaxed);
+                            slot.bytes.store(0, std::memory_order_relaxed);
+                            slot.generation.store(0, std::memory_order_relaxed);
+                            slot.shared_acquisitions.store(0, std::memory_order_relaxed);
+                            slot.exclusive_acquisitions.store(0, std::memory_order_relaxed);
+                            slot.contended.store(0, std::memory_order_relaxed);
+                            slot.timeouts.store(0, std::memory_order_relaxed);
+                            slot.wait_ns.store(0, std::memory_order_relaxed);
+                            slot.hold_ns.store(0, std::memory_order_relaxed);
+                            slot.active.store(1, std::memory_order_relaxed);
+                        });
+                        return &slot;
+                    }
+                }
+                __file->dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            void release(__stats_slot *_slot) noexcept
+            {
+                _slot->write([&]
+                {
+                    _slot->active.store(0, std::memory_order_relaxed);
+                });
+                _slot->claimed.store(0, std::memory_order_release);
+                if (__file)
+                    __file->claimed_slots.fetch_sub(1, std::memory_order_relaxed);
+            }
+        };
+
+        /**
+         * @brief records a wait for a lock that failed its try_lock()
+         */
+        inline void __stats_waited(__stats_slot *_slot, std::chrono::nanoseconds _waited, bool _timed_out) noexcept
+        {
+            if (_slot == nullptr)
+                return;
+            _slot->contended.fetch_add(1, std::memory_order_relaxed);
+            _slot->wait_ns.fetch_add(static_cast<std::uint64_t>(_waited.count()), std::memory_order_relaxed);
+            if (_timed_out)
+                _slot->timeouts.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief owned by an accessor, counts its acquisitions and hold time in the wrapper's slot
+         */
+        class __stats_token
+        {
+        private:
+            __stats_slot *__slot = nullptr;
+            // steady clock time the lock was taken, 0 while it isn't held
+            std::int64_t __since = 0;
+
+            static std::int64_t __now() noexcept
+            {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+        public:
+            __stats_token() = default;
+            __stats_token(__stats_token &&_other) noexcept
+                : __slot(_other.__slot),
+                __since(_other.__since)
+            {
+                _other.__since = 0;
+            }
+
+            void set_slot(__stats_slot *_slot) noexcept
+            {
+                __slot = _slot;
+            }
+
+            __stats_slot *slot() const noexcept
+            {
+                return __slot;
+            }
+
+            void begin(bool _exclusive) noexcept
+            {
+                if (__slot == nullptr)
+                    return;
+                (_exclusive ? __slot->exclusive_acquisitions : __slot->shared_acquisitions).fetch_add(1, std::memory_order_relaxed);
+                __since = __now();
+            }
+
+            void end() noexcept
+            {
+                if (__slot == nullptr || __since == 0)
+                    return;
+                __slot->hold_ns.fetch_add(static_cast<std::uint64_t>(__now() - __since), std::memory_order_relaxed);
+                __since = 0;
+            }
+        };
+
+        /**
+         * @brief owned by a wrapper, holds its slot in the stats file from construction to
+         * destruction. _Cell is the wrapper's metadata cell, which mirrors every publication
+         * into the slot.
+         */
+        class __stats_registration
+        {
+        private:
+            __stats_slot *__slot = nullptr;
+
+        public:
+            template <class _Cell>
+            __stats_registration(_Cell &_cell, bool _enabled) noexcept
+            {
+                if (_enabled)
+                    __slot = __stats_segment::instance().claim();
+                _cell.mirror(__slot);
+            }
+            ~__stats_registration()
+            {
+                if (__slot)
+                    __stats_segment::instance().release(__slot);
+            }
+
+            __stats_registration(const __stats_registration &) = delete;
+            __stats_registration &operator=(const __stats_registration &) = delete;
+
+            __stats_slot *slot() const noexcept
+            {
+                return __slot;
+            }
+
+            void set_name(const char *_name) noexcept
+            {
+                if (__slot)
+                    __slot->set_name(_name);
+            }
+        };
+    };
+
+    /**
+     * @brief path of this process' stats file (e.g. "/dev/shm/ts-stl.1234" on Linux), empty if
+     * it couldn't be created.
+     *
+     * Statistics are only recorded if TS_STL_STATS is defined for the whole build. Then every
+     * ts::wrapper claims a slot in a shared memory file named "/ts-stl.<pid>" (see shm_open())
+     * for its lifetime, where its name, the metadata of its container (see wrapper::metadata())
+     * and its lock counters are kept up to date. Other processes read it with a stats_reader
+     * without taking any lock of this process, so monitoring doesn't perturb the wrappers.
+     * Recording costs a relaxed atomic increment and two clock reads per acquisition, and a few
+     * more for acquisitions that have to wait. Wrappers in shm_segments are not recorded, as
+     * several processes use them. The file is removed when the process exits normally.
+     */
+    inline std::string stats_path()
+    {
+        std::string path = __detail::__stats_segment::instance().path();
+        if (path.empty())
+            return path;
+#ifdef __linux__
+        return "/dev/shm" + path;
+#else
+        return path;
+#endif
+    }
+
+    /**
+     * @brief reads the stats file of another (or the same) process, see stats_path(). Reading
+     * takes no locks: every wrapper's statistics are read behind its sequence counter and
+     * retried if the wrapper updated them meanwhile.
+     */
+    class stats_reader
+    {
+    private:
+        const __detail::__stats_file *__file = nullptr;
+
+    public:
+        /**
+         * @brief opens the stats file of process _pid
+         * @throws std::system_error if it doesn't exist or isn't a ts-stl stats file
+         */
+        explicit stats_reader(long _pid)
+        {
+            char path[64];
+            std::snprintf(path, sizeof(path), "/ts-stl.%ld", _pid);
+            int descriptor = shm_open(path, O_RDONLY, 0);
+            if (descriptor < 0)
+                throw std::system_error(errno, std::generic_category(), "ts-stl/stats shm_open()");
+            struct stat info;
+            if (fstat(descriptor, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(__detail::__stats_file))
+            {
+                close(descriptor);
+                throw std::system_error(EINVAL, std::generic_category(), "ts-stl/stats file too small");
+            }
+            void *memory = mmap(nullptr, sizeof(__detail::__stats_file), PROT_READ, MAP_SHARED, descriptor, 0);
+            int error = errno;
+            close(descriptor);
+            if (memory == MAP_FAILED)
+                throw std::system_error(error, std::generic_category(), "ts-stl/stats mmap()");
+            __file = static_cast<const __detail::__stats_file *>(memory);
+            if (__file->magic.load(std::memory_order_acquire) != __detail::__stats_file::magic_value ||
+                __file->version.load(std::memory_order_relaxed) != __detail::__stats_file::version_value)
+            {
+                munmap(const_cast<__detail::__stats_file *>(__file), sizeof(__detail::__stats_file));
+                throw std::system_error(EINVAL, std::generic_category(), "ts-stl/stats not a ts-stl stats file of this version");
+            }
+        }
+        ~stats_reader()
+        {
+            munmap(const_cast<__detail::__stats_file *>(__file), sizeof(__detail::__stats_file));
+        }
+
+        stats_reader(const stats_reader &) = delete;
+        stats_reader &operator=(const stats_reader &) = delete;
+
+        /**
+         * @brief number of wrappers that weren't recorded because all slots of the file were
+         * taken when they were created
+         */
+        std::uint64_t dropped() const noexcept
+        {
+            return __file->dropped.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief statistics of all wrappers currently alive in the process
+         */
+        std::vector<wrapper_stats> read() const
+        {
+            std::vector<wrapper_stats> result;
+            for (const __detail::__stats_slot &slot : __file->slots)
+            {
+                if (!slot.claimed.load(std::memory_order_relaxed))
+                    continue;
+                wrapper_stats stats;
+                if (slot.read(stats))
+                    result.push_back(std::move(stats));
+            }
+            return result;
+        }
+    };
+};
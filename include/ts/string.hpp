@@ -19,4 +19,11 @@ threadsafe wrapper for std::string
 namespace ts
 {
     using string = wrapper<std::string>;
+
+    // with explicit mutex type
+    template <class _MT>
+    using basic_string = wrapper<std::string, _MT>;
+
+    // unsynchronized, for single threaded use (see null_lock.hpp)
+    using unlocked_string = basic_string<null_lock>;
 };
\ No newline at end of file
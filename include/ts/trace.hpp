@@ -0,0 +1,433 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 23:18
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Tracing of wrapper lock events into per-thread ring buffers, exported as Chrome trace JSON.
+*/
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <algorithm>
+#include <ostream>
+#include <unordered_map>
+
+namespace ts
+{
+    namespace __detail
+    {
+        enum class __trace_kind : std::uint8_t
+        {
+            // try_lock() failed, the thread starts waiting
+            wait,
+            acquired,
+            released,
+            // waiting ran into the lock timeout
+            timeout,
+        };
+
+        /**
+         * @brief one recorded event. The fields are atomics so the exporter can read a buffer
+         * while its thread keeps writing, relaxed stores are plain stores on common platforms.
+         */
+        struct __trace_event
+        {
+            std::atomic<std::int64_t> time{0};
+            std::atomic<const void *> mutex{nullptr};
+            std::atomic<__trace_kind> kind{__trace_kind::wait};
+            std::atomic<bool> exclusive{false};
+        };
+
+        /**
+         * @brief ring buffer of the events of one thread. Only the owning thread writes, older
+         * events are overwritten once it is full.
+         */
+        struct __trace_buffer
+        {
+            static constexpr std::size_t capacity = std::size_t(1) << 14;
+            __trace_event events[capacity];
+            // index of the next event to write
+            std::atomic<std::uint64_t> head{0};
+            // events before this index were cleared
+            std::atomic<std::uint64_t> tail{0};
+            unsigned tid = 0;
+            // set when the owning thread exits, the buffer is then only kept for exporting
+            std::atomic<bool> exited{false};
+            // guarded by the registry mutex
+            std::string name;
+
+            void record(__trace_kind _kind, const void *_mutex, bool _exclusive) noexcept
+            {
+                std::uint64_t index = head.load(std::memory_order_relaxed);
+                __trace_event &event = events[index % capacity];
+                // orders the previous head store before the slot is overwritten, see __trace_registry::snapshot()
+                std::atomic_thread_fence(std::memory_order_release);
+                event.time.store(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+                event.mutex.store(_mutex, std::memory_order_relaxed);
+                event.kind.store(_kind, std::memory_order_relaxed);
+                event.exclusive.store(_exclusive, std::memory_order_relaxed);
+                head.store(index + 1, std::memory_order_release);
+            }
+        };
+
+        /**
+         * @brief an event copied out of a buffer
+         */
+        struct __trace_record
+        {
+            std::int64_t time;
+            const void *mutex;
+            __trace_kind kind;
+            bool exclusive;
+        };
+
+        /**
+         * @brief process-wide list of all trace buffers and names of traced wrappers
+         */
+        struct __trace_registry
+        {
+            // buffers of exited threads kept at most, the oldest ones are dropped first
+            static constexpr std::size_t max_exited = 64;
+
+            /**
+             * @brief thread local reference to the thread's buffer, marks it exited at thread exit
+             */
+            struct __handle
+            {
+                std::shared_ptr<__trace_buffer> buffer;
+
+                ~__handle()
+                {
+                    if (buffer)
+                        buffer->exited.store(true, std::memory_order_relaxed);
+                }
+            };
+
+            std::atomic<bool> enabled{false};
+            std::mutex mutex;
+            // buffers stay here after their thread exited, so its events can still be exported,
+            // until the trace is cleared or too many threads have exited
+            std::vector<std::shared_ptr<__trace_buffer>> buffers;
+            std::unordered_map<const void *, std::string> names;
+            unsigned next_tid = 1;
+
+            static __trace_registry &instance()
+            {
+                static __trace_registry registry;
+                return registry;
+            }
+
+            /**
+             * @brief the buffer of the calling thread, registered on first use
+             * @return __trace_buffer* nullptr if the buffer could not be allocated or registered,
+             * the next call tries again
+             */
+            __trace_buffer *local() noexcept
+            {
+                thread_local __handle handle;
+                if (handle.buffer)
+                    return handle.buffer.get();
+                try
+                {
+                    auto created = std::make_shared<__trace_buffer>();
+                    std::lock_guard lock(mutex);
+                    created->tid = next_tid++;
+                    __drop_exited_locked(max_exited);
+                    buffers.push_back(created);
+                    handle.buffer = std::move(created);
+                }
+                catch (...)
+                {
+                    return nullptr;
+                }
+                return handle.buffer.get();
+            }
+
+            /**
+             * @brief removes the oldest buffers of exited threads until at most _keep are left.
+             * mutex has to be held.
+             */
+            void __drop_exited_locked(std::size_t _keep)
+            {
+                std::size_t exited = std::count_if(buffers.begin(), buffers.end(), [](const auto &_buffer)
+                {
+                    return _buffer->exited.load(std::memory_order_relaxed);
+                });
+                // buffers are in registration order, so the first ones found are the oldest
+                auto dropped = std::remove_if(buffers.begin(), buffers.end(), [&](const auto &_buffer)
+                {
+                    if (exited <= _keep || !_buffer->exited.load(std::memory_order_relaxed))
+                        return false;
+                    exited--;
+                    return true;
+                });
+                buffers.erase(dropped, buffers.end());
+            }
+
+            /**
+             * @brief copies the events of _buffer that were not cleared or overwritten meanwhile
+             */
+            static std::vector<__trace_record> snapshot(const __trace_buffer &_buffer)
+            {
+                std::uint64_t head = _buffer.head.load(std::memory_order_acquire);
+                std::uint64_t begin = head > __trace_buffer::capacity ? head - __trace_buffer::capacity : 0;
+                begin = std::max(begin, _buffer.tail.load(std::memory_order_relaxed));
+
+                std::vector<__trace_record> records;
+                records.reserve(head - std::min(begin, head));
+                for (std::uint64_t i = begin; i < head; i++)
+                {
+                    const __trace_event &event = _buffer.events[i % __trace_buffer::capacity];
+                    records.push_back({event.time.load(std::memory_order_relaxed), event.mutex.load(std::memory_order_relaxed),
+                                       event.kind.load(std::memory_order_relaxed), event.exclusive.load(std::memory_order_relaxed)});
+                }
+
+                // the writer may have lapped the oldest events while they were copied. A slot being
+                // rewritten for index i + capacity implies head >= i + capacity, so those are dropped.
+                std::atomic_thread_fence(std::memory_order_acquire);
+                std::uint64_t after = _buffer.head.load(std::memory_order_relaxed);
+                std::uint64_t valid = after >= __trace_buffer::capacity ? after - __trace_buffer::capacity + 1 : 0;
+                if (valid > begin)
+                    records.erase(records.begin(), records.begin() + std::min<std::uint64_t>(valid - begin, records.size()));
+                return records;
+            }
+        };
+
+        /**
+         * @brief records an event in the calling thread's buffer if tracing is running.
+         * The event is dropped if the thread has no buffer and none can be allocated.
+         */
+        inline void __trace(__trace_kind _kind, const void *_mutex, bool _exclusive) noexcept
+        {
+            __trace_registry &registry = __trace_registry::instance();
+            if (!registry.enabled.load(std::memory_order_relaxed))
+                return;
+            if (__trace_buffer *buffer = registry.local())
+                buffer->record(_kind, _mutex, _exclusive);
+        }
+
+        /**
+         * @brief names the wrapper whose mutex is _mutex in exported traces. If the name
+         * can't be stored, the wrapper keeps appearing under its mutex address.
+         */
+        inline void __trace_name(const void *_mutex, const char *_name) noexcept
+        {
+            __trace_registry &registry = __trace_registry::instance();
+            try
+            {
+                std::lock_guard lock(registry.mutex);
+                registry.names[_mutex] = _name;
+            }
+            catch (...)
+            {
+                // out of memory, the name is only cosmetic
+            }
+        }
+
+        inline void __write_json_string(std::ostream &_stream, const std::string &_string)
+        {
+            _stream << '"';
+            for (char c : _string)
+            {
+                if (c == '"' || c == '\\')
+                    _stream << '\\' << c;
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    _stream << escaped;
+                }
+                else
+                    _stream << c;
+            }
+            _stream << '"';
+        }
+    };
+
+    /**
+     * @brief starts recording lock events of all wrappers. Events are only recorded if
+     * TS_STL_LOCK_TRACING is defined for the whole build, otherwise the accessors contain no
+     * tracing code at all. While tracing is stopped, the accessors only check a flag.
+     *
+     * Every thread records into a ring buffer of its own (the last 16384 events), so recording
+     * takes no locks and costs a clock read and a few stores. The buffers of exited threads are
+     * kept for exporting until clear_lock_trace() is called, but at most the 64 most recent
+     * ones. An uncontended lock produces an acquired and a released event, a contended one
+     * also a wait event when try_lock() fails.
+     */
+    inline void start_lock_trace() noexcept
+    {
+        __detail::__trace_registry::instance().enabled.store(true, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief stops recording lock events, the recorded events are kept
+     */
+    inline void stop_lock_trace() noexcept
+    {
+        __detail::__trace_registry::instance().enabled.store(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief discards all recorded lock events and frees the buffers of exited threads
+     */
+    inline void clear_lock_trace()
+    {
+        __detail::__trace_registry &registry = __detail::__trace_registry::instance();
+        std::lock_guard lock(registry.mutex);
+        registry.__drop_exited_locked(0);
+        for (auto &buffer : registry.buffers)
+            buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief names the calling thread in exported traces, e.g. "worker 3"
+     */
+    inline void set_trace_thread_name(const std::string &_name)
+    {
+        __detail::__trace_registry &registry = __detail::__trace_registry::instance();
+        __detail::__trace_buffer *buffer = registry.local();
+        if (buffer == nullptr)
+            throw std::bad_alloc();
+        std::lock_guard lock(registry.mutex);
+        buffer->name = _name;
+    }
+
+    /**
+     * @brief writes the recorded lock events to _stream in the Chrome trace event format
+     * (JSON), which can be opened in chrome://tracing or ui.perfetto.dev. Every thread is a
+     * track with a "wait" slice per contended acquisition, a "hold" slice per held lock and a
+     * "timeout" slice per wait that ran into the lock timeout. Slices are named after the
+     * wrapper (see wrapper::set_name()) or its mutex address. Locks still held are cut off at
+     * the time of the export. Tracing can keep running meanwhile.
+     */
+    inline void write_lock_trace(std::ostream &_stream)
+    {
+        using namespace __detail;
+        __trace_registry &registry = __trace_registry::instance();
+
+        std::vector<std::shared_ptr<__trace_buffer>> buffers;
+        std::vector<std::string> thread_names;
+        std::unordered_map<const void *, std::string> names;
+        {
+            std::lock_guard lock(registry.mutex);
+            buffers = registry.buffers;
+            for (auto &buffer : buffers)
+                thread_names.push_back(buffer->name);
+            names = registry.names;
+        }
+        std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+        bool first = true;
+        auto separate = [&]
+        {
+            _stream << (first ? "\n" : ",\n");
+            first = false;
+        };
+        auto name_of = [&](const void *_mutex)
+        {
+            auto it = names.find(_mutex);
+            if (it != names.end())
+                return it->second;
+            char address[32];
+            std::snprintf(address, sizeof(address), "%p", _mutex);
+            return std::string(address);
+        };
+        auto slice = [&](const char *_what, unsigned _tid, const __trace_record &_begin, std::int64_t _end, bool _open)
+        {
+            separate();
+            _stream << "{\"name\":";
+            __write_json_string(_stream, std::string(_what) + " " + name_of(_begin.mutex));
+            char times[96];
+            std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", _begin.time / 1000.0, (_end - _begin.time) / 1000.0);
+            char address[32];
+            std::snprintf(address, sizeof(address), "%p", _begin.mutex);
+            _stream << ",\"cat\":\"ts-stl\",\"ph\":\"X\",\"pid\":1,\"tid\":" << _tid << "," << times
+                    << ",\"args\":{\"mode\":\"" << (_begin.exclusive ? "exclusive" : "shared") << "\",\"mutex\":\"" << address << "\""
+                    << (_open ? ",\"open\":true" : "") << "}}";
+        };
+
+        _stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        for (std::size_t b = 0; b < buffers.size(); b++)
+        {
+            unsigned tid = buffers[b]->tid;
+            separate();
+            _stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+            __write_json_string(_stream, thread_names[b].empty() ? "thread " + std::to_string(tid) : thread_names[b]);
+            _stream << "}}";
+
+            // starts of waits and holds still open, per mutex (a thread may hold a shared lock more than once)
+            std::unordered_map<const void *, std::vector<__trace_record>> waits, holds;
+            for (const __trace_record &record : __trace_registry::snapshot(*buffers[b]))
+            {
+                switch (record.kind)
+                {
+                case __trace_kind::wait:
+                    waits[record.mutex].push_back(record);
+                    break;
+                case __trace_kind::acquired:
+                case __trace_kind::timeout:
+                {
+                    auto &pending = waits[record.mutex];
+                    if (!pending.empty())
+                    {
+                        slice(record.kind == __trace_kind::timeout ? "timeout" : "wait", tid, pending.back(), record.time, false);
+                        pending.pop_back();
+                    }
+                    if (record.kind == __trace_kind::acquired)
+                        holds[record.mutex].push_back(record);
+                    break;
+                }
+                case __trace_kind::released:
+                {
+                    // the acquisition may have been overwritten already
+                    auto &pending = holds[record.mutex];
+                    if (!pending.empty())
+                    {
+                        slice("hold", tid, pending.back(), record.time, false);
+                        pending.pop_back();
+                    }
+                    break;
+                }
+                }
+            }
+            for (auto &[mutex, pending] : waits)
+                for (const __trace_record &record : pending)
+                    slice("wait", tid, record, now, true);
+            for (auto &[mutex, pending] : holds)
+                for (const __trace_record &record : pending)
+                    slice("hold", tid, record, now, true);
+        }
+        _stream << "\n]}\n";
+    }
+
+    /**
+     * @brief writes the recorded lock events to the file at _path, see write_lock_trace(std::ostream &)
+     * @return bool whether the file could be written
+     */
+    inline bool write_lock_trace(const std::string &_path)
+    {
+        std::ofstream file(_path, std::ios::out | std::ios::trunc);
+        if (!file)
+            return false;
+        write_lock_trace(file);
+        file.flush();
+        return static_cast<bool>(file);
+    }
+};
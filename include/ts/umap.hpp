@@ -23,4 +23,18 @@ namespace ts
 
     template <class... _Args>
     using umultimap = wrapper<std::unordered_multimap<_Args...>>;
+
+    // with explicit mutex type
+    template <class _MT, class... _Args>
+    using basic_umap = wrapper<std::unordered_map<_Args...>, _MT>;
+
+    template <class _MT, class... _Args>
+    using basic_umultimap = wrapper<std::unordered_multimap<_Args...>, _MT>;
+
+    // unsynchronized, for single threaded use (see null_lock.hpp)
+    template <class... _Args>
+    using unlocked_umap = basic_umap<null_lock, _Args...>;
+
+    template <class... _Args>
+    using unlocked_umultimap = basic_umultimap<null_lock, _Args...>;
 };
\ No newline at end of file
@@ -20,4 +20,12 @@ namespace ts
 {
     template <class... _Args>
     using uset = wrapper<std::unordered_set<_Args...>>;
+
+    // with explicit mutex type
+    template <class _MT, class... _Args>
+    using basic_uset = wrapper<std::unordered_set<_Args...>, _MT>;
+
+    // unsynchronized, for single threaded use (see null_lock.hpp)
+    template <class... _Args>
+    using unlocked_uset = basic_uset<null_lock, _Args...>;
 };
\ No newline at end of file
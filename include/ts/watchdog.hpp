@@ -0,0 +1,128 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+17.10.26, 22:51
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+Watchdog reporting wrapper locks held for too long, with their call sites.
+*/
+
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <algorithm>
+#include <sstream>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "hooks.hpp"
+
+namespace ts
+{
+    /**
+     * @brief background thread reporting every wrapper lock that is held longer than a threshold,
+     * together with the call site that took it and the holding thread. Every acquisition is
+     * reported at most once.
+     *
+     * It works on the locks recorded by accessors, so TS_STL_LOCK_DIAGNOSTICS has to be defined
+     * for the whole build (see hooks.hpp), otherwise it never reports anything. Recording a lock
+     * costs a few uncontended atomic stores and a clock read, and the watchdog itself only scans
+     * the hold table, so it can stay enabled in production.
+     */
+    class lock_watchdog
+    {
+    public:
+        typedef std::function<void(const lock_hold &)> reporter_t;
+
+    private:
+        std::chrono::nanoseconds __threshold;
+        std::chrono::nanoseconds __interval;
+        reporter_t __reporter;
+
+        std::mutex __mutex;
+        std::condition_variable __wakeup;
+        bool __stop = false;
+        std::thread __worker;
+
+        // sequence of the hold last reported per slot of the hold table
+        std::unordered_map<std::size_t, std::uint64_t> __reported;
+
+        void __scan()
+        {
+            __detail::__for_each_hold([&](const lock_hold &_hold, std::size_t _slot, std::uint64_t _sequence)
+            {
+                if (_hold.held < __threshold)
+                    return;
+                auto it = __reported.find(_slot);
+                if (it != __reported.end() && it->second == _sequence)
+                    return;
+                __reported[_slot] = _sequence;
+                __reporter(_hold);
+            });
+        }
+
+        void __run()
+        {
+            std::unique_lock lock(__mutex);
+            while (!__wakeup.wait_for(lock, __interval, [this] { return __stop; }))
+            {
+                lock.unlock();
+                __scan();
+                lock.lock();
+            }
+        }
+
+    public:
+        /**
+         * @brief prints _hold to stderr
+         */
+        static void print_report(const lock_hold &_hold)
+        {
+            std::ostringstream thread;
+            thread << _hold.thread;
+            std::fprintf(stderr, "ts-stl/watchdog %s lock of %p held for %lld ms by thread %s, taken at %s:%u (%s)\n",
+                         _hold.exclusive ? "exclusive" : "shared", _hold.mutex,
+                         static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(_hold.held).count()),
+                         thread.str().c_str(), _hold.site.file_name(), _hold.site.line(), _hold.site.function_name());
+        }
+
+        /**
+         * @brief starts watching
+         *
+         * @param _threshold locks held longer than this are reported
+         * @param _reporter called on the watchdog thread for every lock held too long, prints to stderr by default
+         * @param _interval time between two scans, a quarter of _threshold by default
+         */
+        lock_watchdog(std::chrono::milliseconds _threshold, reporter_t _reporter = print_report, std::chrono::milliseconds _interval = std::chrono::milliseconds(0))
+            : __threshold(_threshold),
+            __interval(_interval.count() > 0 ? std::chrono::nanoseconds(_interval) : std::max(std::chrono::nanoseconds(_threshold) / 4, std::chrono::nanoseconds(std::chrono::milliseconds(1)))),
+            __reporter(std::move(_reporter))
+        {
+            __worker = std::thread([this] { __run(); });
+        }
+
+        /**
+         * @brief stops watching
+         */
+        ~lock_watchdog()
+        {
+            {
+                std::lock_guard lock(__mutex);
+                __stop = true;
+            }
+            __wakeup.notify_all();
+            __worker.join();
+        }
+
+        lock_watchdog(const lock_watchdog &) = delete;
+        lock_watchdog &operator=(const lock_watchdog &) = delete;
+    };
+};
@@ -19,15 +19,322 @@ https://stackoverflow.com/a/29988626
 
 #include <shared_mutex>
 #include <mutex>
+#include <atomic>
 #include <chrono>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
 #include <cassert>
 
 #include "except.hpp"
+#include "hooks.hpp"
+#ifdef TS_STL_LOCK_TRACING
+#include "trace.hpp"
+#endif
+#ifdef TS_STL_LOCK_ORDER_CHECK
+#include "lock_order.hpp"
+#endif
+#ifdef TS_STL_STATS
+#include "stats.hpp"
+#endif
+
+// accessors capture their call site if a diagnostic reporting it is enabled
+#if defined(TS_STL_LOCK_DIAGNOSTICS) || defined(TS_STL_LOCK_ORDER_CHECK)
+#define TS_STL_CALL_SITES
+#endif
 
 using namespace std::chrono_literals;
 
 namespace ts
 {
+    struct null_lock;
+    struct lock_free;
+    struct seqlock;
+
+    /**
+     * @brief mutex type used by wrappers that don't specify one. Defining TS_STL_NULL_LOCK
+     * for the whole build turns all of them into unsynchronized wrappers (see null_lock.hpp)
+     * for single threaded programs.
+     */
+#ifdef TS_STL_NULL_LOCK
+    typedef null_lock default_mutex;
+#else
+    typedef std::shared_timed_mutex default_mutex;
+#endif
+
+    /**
+     * @brief snapshot of the metadata of a wrapped container, see wrapper::metadata()
+     */
+    struct container_metadata
+    {
+        // 0 for types without size()
+        std::size_t size = 0;
+        // also known for containers without size() (e.g. std::forward_list)
+        bool empty = true;
+        // 0 for containers without buckets
+        std::size_t bucket_count = 0;
+        float load_factor = 0;
+        // approximate memory footprint of the container and its elements in bytes
+        std::size_t bytes = 0;
+        // number of times the metadata was published, changes whenever it does
+        std::uint64_t generation = 0;
+    };
+
+    namespace __detail
+    {
+        // a wrapper's slot in the stats file, see stats.hpp
+        struct __stats_slot;
+
+        template <class _CT, class = void>
+        struct __has_buckets : std::false_type
+        {
+        };
+        template <class _CT>
+        struct __has_buckets<_CT, std::void_t<decltype(std::declval<const _CT &>().bucket_count())>> : std::true_type
+        {
+        };
+
+        template <class _CT, class = void>
+        struct __has_capacity : std::false_type
+        {
+        };
+        template <class _CT>
+        struct __has_capacity<_CT, std::void_t<decltype(std::declval<const _CT &>().capacity())>> : std::true_type
+        {
+        };
+
+        template <class _CT, class = void>
+        struct __has_size : std::false_type
+        {
+        };
+        template <class _CT>
+        struct __has_size<_CT, std::void_t<decltype(std::declval<const _CT &>().size()), typename _CT::value_type>> : std::true_type
+        {
+        };
+
+        template <class _CT, class = void>
+        struct __has_iterators : std::false_type
+        {
+        };
+        template <class _CT>
+        struct __has_iterators<_CT, std::void_t<decltype(std::declval<const _CT &>().begin() == std::declval<const _CT &>().end())>> : std::true_type
+        {
+        };
+
+        /**
+         * @brief whether the emptiness of _CT is known: from size() or, without it, from begin() == end()
+         */
+        template <class _CT>
+        constexpr bool __knows_empty = __has_size<_CT>::value || __has_iterators<_CT>::value;
+
+        /**
+         * @brief reads the metadata of _container (without generation). The byte footprint
+         * assumes a node per element plus the bucket array for hash containers, a node with
+         * three links per element for other node based containers and the capacity for
+         * contiguous ones.
+         */
+        template <class _CT>
+        container_metadata __measure(const _CT &_container) noexcept
+        {
+            container_metadata metadata;
+            metadata.bytes = sizeof(_CT);
+            if constexpr (__has_size<_CT>::value)
+            {
+                typedef typename _CT::value_type value_type;
+                metadata.size = _container.size();
+                metadata.empty = metadata.size == 0;
+                if constexpr (__has_buckets<_CT>::value)
+                {
+                    metadata.bucket_count = _container.bucket_count();
+                    metadata.load_factor = _container.load_factor();
+                    metadata.bytes += metadata.size * (sizeof(value_type) + sizeof(void *) + sizeof(std::size_t)) + metadata.bucket_count * sizeof(void *);
+                }
+                else if constexpr (__has_capacity<_CT>::value)
+                    metadata.bytes += _container.capacity() * sizeof(value_type);
+                else
+                    metadata.bytes += metadata.size * (sizeof(value_type) + 3 * sizeof(void *) + sizeof(int));
+            }
+            else if constexpr (__has_iterators<_CT>::value)
+                metadata.empty = _container.begin() == _container.end();
+            return metadata;
+        }
+
+        /**
+         * @brief metadata of a wrapped container published behind a sequence counter, so it can be
+         * read without the container's lock. Publishers have to be serialized (they hold the
+         * exclusive lock of the container), readers retry if they overlap with one.
+         */
+        class __metadata_cell
+        {
+        private:
+            // odd while a publisher is writing, half of it is the generation
+            std::atomic<std::uint64_t> __sequence{0};
+            std::atomic<std::size_t> __size{0};
+            std::atomic<bool> __empty{true};
+            std::atomic<std::size_t> __bucket_count{0};
+            std::atomic<float> __load_factor{0};
+            std::atomic<std::size_t> __bytes{0};
+#ifdef TS_STL_STATS
+            // slot in the stats file every publication is copied to, see stats.hpp
+            __stats_slot *__mirror = nullptr;
+#endif
+
+        public:
+#ifdef TS_STL_STATS
+            void mirror(__stats_slot *_slot) noexcept
+            {
+                __mirror = _slot;
+            }
+#endif
+
+            template <class _CT>
+            void publish(const _CT &_container) noexcept
+            {
+                container_metadata metadata = __measure(_container);
+                std::uint64_t sequence = __sequence.load(std::memory_order_relaxed);
+                __sequence.store(sequence + 1, std::memory_order_relaxed);
+                // the odd sequence has to be visible before any of the values change
+                std::atomic_thread_fence(std::memory_order_release);
+                __size.store(metadata.size, std::memory_order_relaxed);
+                __empty.store(metadata.empty, std::memory_order_relaxed);
+                __bucket_count.store(metadata.bucket_count, std::memory_order_relaxed);
+                __load_factor.store(metadata.load_factor, std::memory_order_relaxed);
+                __bytes.store(metadata.bytes, std::memory_order_relaxed);
+                __sequence.store(sequence + 2, std::memory_order_release);
+#ifdef TS_STL_STATS
+                if (__mirror)
+                    __mirror->publish(metadata.size, metadata.bucket_count, metadata.load_factor, metadata.bytes, sequence / 2 + 1);
+#endif
+            }
+
+            std::size_t size() const noexcept
+            {
+                return __size.load(std::memory_order_acquire);
+            }
+
+            bool empty() const noexcept
+            {
+                return __empty.load(std::memory_order_acquire);
+            }
+
+            container_metadata load() const noexcept
+            {
+                for (;;)
+                {
+                    std::uint64_t before = __sequence.load(std::memory_order_acquire);
+                    if (before & 1)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    container_metadata metadata;
+                    metadata.size = __size.load(std::memory_order_relaxed);
+                    metadata.empty = __empty.load(std::memory_order_relaxed);
+                    metadata.bucket_count = __bucket_count.load(std::memory_order_relaxed);
+                    metadata.load_factor = __load_factor.load(std::memory_order_relaxed);
+                    metadata.bytes = __bytes.load(std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (__sequence.load(std::memory_order_relaxed) == before)
+                    {
+                        metadata.generation = before / 2;
+                        return metadata;
+                    }
+                }
+            }
+        };
+
+        /**
+         * @brief whether wrappers with mutex type _MT are used by several processes (see shm.hpp),
+         * such wrappers are not recorded in the stats file of any one of them
+         */
+        template <class _MT>
+        struct __process_shared_mutex : std::false_type
+        {
+        };
+
+        /**
+         * @brief counts the threads waiting for a lock while they are in scope
+         */
+        class __waiting_guard
+        {
+        private:
+            std::atomic<unsigned> *__waiting;
+
+        public:
+            __waiting_guard(std::atomic<unsigned> *_waiting)
+                : __waiting(_waiting)
+            {
+                if (__waiting)
+                    __waiting->fetch_add(1, std::memory_order_relaxed);
+            }
+            ~__waiting_guard()
+            {
+                if (__waiting)
+                    __waiting->fetch_sub(1, std::memory_order_relaxed);
+            }
+        };
+
+        /**
+         * @brief acquires _lock (a unique or shared lock) for an accessor. An uncontended lock
+         * is taken with a single try_lock(), otherwise this waits for up to _timeout (or forever
+         * if it is negative) and throws a lock_timeout_error with _message if it runs out.
+         * While waiting, _waiting (if given) is incremented so shared leases can make way.
+         * Waits are counted in _stats (if given) when TS_STL_STATS is defined, see stats.hpp.
+         *
+         * The error carries diagnostics (the wrapper's _name, the mode, the time waited and the
+         * current holders if TS_STL_LOCK_DIAGNOSTICS is defined), all gathered only after the
+         * wait failed, so acquisitions that succeed don't pay for them.
+         */
+        template <class _LT>
+        void __acquire(_LT &_lock, std::chrono::milliseconds _timeout, const char *_message, const char *_name, std::atomic<unsigned> *_waiting = nullptr, [[maybe_unused]] __stats_slot *_stats = nullptr)
+        {
+            constexpr bool exclusive = std::is_same_v<_LT, std::unique_lock<typename _LT::mutex_type>>;
+            if (_lock.try_lock())
+                return;
+
+#ifdef TS_STL_LOCK_TRACING
+            __trace(__trace_kind::wait, _lock.mutex(), exclusive);
+#endif
+            __waiting_guard guard(_waiting);
+            auto start = std::chrono::steady_clock::now();
+            if (_timeout.count() < 0)
+            {
+                _lock.lock();
+#ifdef TS_STL_STATS
+                __stats_waited(_stats, std::chrono::steady_clock::now() - start, false);
+#endif
+                return;
+            }
+            if (_lock.try_lock_for(_timeout))
+            {
+#ifdef TS_STL_STATS
+                __stats_waited(_stats, std::chrono::steady_clock::now() - start, false);
+#endif
+                return;
+            }
+
+            lock_timeout_info info;
+            info.waited = std::chrono::steady_clock::now() - start;
+            if (_name)
+                info.name = _name;
+            info.mode = exclusive ? lock_mode::exclusive : lock_mode::shared;
+#ifdef TS_STL_STATS
+            __stats_waited(_stats, info.waited, true);
+#endif
+#ifdef TS_STL_LOCK_DIAGNOSTICS
+            info.diagnostics = true;
+            info.holders = lock_holders(_lock.mutex());
+            for (const lock_hold &hold : info.holders)
+                if (!hold.exclusive)
+                    info.readers++;
+#endif
+#ifdef TS_STL_LOCK_TRACING
+            __trace(__trace_kind::timeout, _lock.mutex(), exclusive);
+#endif
+            throw lock_timeout_error(_message, std::move(info));
+        }
+    };
 
     /**
      * @brief wrapper class referencing a container of type _CT (typically in a ts::wrapper object)
@@ -52,6 +359,43 @@ namespace ts
         std::shared_lock<_MT> __lock;
 
         std::chrono::milliseconds __lock_timeout;
+        // name of the wrapper reported in lock_timeout_errors
+        const char *__name = nullptr;
+
+#ifdef TS_STL_CALL_SITES
+        // call site reported by lock diagnostics, see hooks.hpp and lock_order.hpp
+        source_location __site;
+#endif
+#ifdef TS_STL_LOCK_DIAGNOSTICS
+        // hold record for lock diagnostics, see hooks.hpp
+        __detail::__hold_token __hold;
+#endif
+#ifdef TS_STL_STATS
+        // acquisition and hold time counters of the wrapper, see stats.hpp
+        __detail::__stats_token __stats;
+#endif
+
+        void __take(const char *_message)
+        {
+#ifdef TS_STL_LOCK_ORDER_CHECK
+            __detail::__order_acquiring(__lock.mutex(), __site, false);
+#endif
+#ifdef TS_STL_STATS
+            __detail::__acquire(__lock, __lock_timeout, _message, __name, nullptr, __stats.slot());
+            __stats.begin(false);
+#else
+            __detail::__acquire(__lock, __lock_timeout, _message, __name);
+#endif
+#ifdef TS_STL_LOCK_DIAGNOSTICS
+            __hold.begin(__lock.mutex(), __site, false);
+#endif
+#ifdef TS_STL_LOCK_TRACING
+            __detail::__trace(__detail::__trace_kind::acquired, __lock.mutex(), false);
+#endif
+#ifdef TS_STL_LOCK_ORDER_CHECK
+            __detail::__order_acquired(__lock.mutex(), __site, false);
+#endif
+        }
 
     public:
         shared_accessor(const _CT &_c, _MT &_mu)
@@ -60,6 +404,43 @@ namespace ts
             __lock_timeout(10000)
         {
         }
+        shared_accessor(shared_accessor &&) = default;
+
+        /**
+         * @brief releases the lock if it owns it.
+         */
+        ~shared_accessor()
+        {
+            unlock();
+        }
+
+#ifdef TS_STL_CALL_SITES
+        /**
+         * @brief sets the call site reported for this accessor by lock diagnostics (see hooks.hpp and lock_order.hpp)
+         */
+        void set_call_site(const source_location &_site) noexcept
+        {
+            __site = _site;
+        }
+#endif
+#ifdef TS_STL_STATS
+        /**
+         * @brief sets the slot of the wrapper in the stats file this accessor counts its locks in (see stats.hpp)
+         */
+        void set_stats(__detail::__stats_slot *_slot) noexcept
+        {
+            __stats.set_slot(_slot);
+        }
+#endif
+
+        /**
+         * @brief sets the name of the wrapper reported in lock_timeout_errors.
+         * _name is not copied and has to outlive the accessor.
+         */
+        void set_name(const char *_name) noexcept
+        {
+            __name = _name;
+        }
 
         /**
          * @brief Set the lock timeout. This timeout is used when accessing
@@ -82,16 +463,8 @@ namespace ts
          */
         void lock()
         {
-            if (__lock)
-                return;
-            if (__lock_timeout.count() < 0)
-            {
-                __lock.lock();
-                return;
-            }
-            __lock.try_lock_for(__lock_timeout);
             if (!__lock)
-                throw lock_timeout_error("ts-stl/wrapper shared_accessor::lock() timeout");
+                __take("ts-stl/wrapper shared_accessor::lock() timeout");
         }
 
         /**
@@ -99,8 +472,21 @@ namespace ts
          */
         void unlock()
         {
-            if (__lock)
-                __lock.unlock();
+            if (!__lock)
+                return;
+#ifdef TS_STL_LOCK_DIAGNOSTICS
+            __hold.end();
+#endif
+#ifdef TS_STL_STATS
+            __stats.end();
+#endif
+#ifdef TS_STL_LOCK_TRACING
+            __detail::__trace(__detail::__trace_kind::released, __lock.mutex(), false);
+#endif
+#ifdef TS_STL_LOCK_ORDER_CHECK
+            __detail::__order_released(__lock.mutex());
+#endif
+            __lock.unlock();
         }
 
         /**
@@ -111,21 +497,9 @@ namespace ts
          */
         const _CT *operator->()
         {
-            // just return if lock is already owned
-            if (__lock)
-                return &__container;
-
-            // otherwise aquire lock
-            if (__lock_timeout.count() < 0)
-            {
-                __lock.lock();
-            }
-            else
-            {
-                __lock.try_lock_for(__lock_timeout);
-                if (!__lock)
-                    throw lock_timeout_error("ts-stl/wrapper shared_accessor::operator->() timeout");
-            }
+            // aquire lock if it isn't owned already
+            if (!__lock)
+                __take("ts-stl/wrapper shared_accessor::operator->() timeout");
 
             return &__container;
         }
@@ -137,21 +511,9 @@ namespace ts
          */
         const _CT &operator*()
         {
-            // just return if lock is already owned
-            if (__lock)
-                return __container;
-
-            // otherwise aquire lock
-            if (__lock_timeout.count() < 0)
-            {
-                __lock.lock();
-            }
-            else
-            {
-                __lock.try_lock_for(__lock_timeout);
-                if (!__lock)
-                    throw lock_timeout_error("ts-stl/wrapper shared_accessor::operator*() timeout");
-            }
+            // aquire lock if it isn't owned already
+            if (!__lock)
+                __take("ts-stl/wrapper shared_accessor::operator*() timeout");
 
             return __container;
         }
@@ -178,16 +540,96 @@ namespace ts
     private:
         _CT &__container;
         std::unique_lock<_MT> __lock;
+        // counter of waiting writers of the wrapper, see shared_lease
+        std::atomic<unsigned> *__writers_waiting;
+        // metadata of the wrapper, published whenever the lock is released
+        __detail::__metadata_cell *__metadata;
 
         std::chrono::milliseconds __lock_timeout = 10000;
+        // name of the wrapper reported in lock_timeout_errors
+        const char *__name = nullptr;
+
+#ifdef TS_STL_CALL_SITES
+        // call site reported by lock diagnostics, see hooks.hpp and lock_order.hpp
+        source_location __site;
+#endif
+#ifdef TS_STL_LOCK_DIAGNOSTICS
+        // hold record for lock diagnostics, see hooks.hpp
+        __detail::__hold_token __hold;
+#endif
+#ifdef TS_STL_STATS
+        // acquisition and hold time counters of the wrapper, see stats.hpp
+        __detail::__stats_token __stats;
+#endif
+
+        void __take(const char *_message)
+        {
+#ifdef TS_STL_LOCK_ORDER_CHECK
+            __detail::__order_acquiring(__lock.mutex(), __site, true);
+#endif
+#ifdef TS_STL_STATS
+            __detail::__acquire(__lock, __lock_timeout, _message, __name, __writers_waiting, __stats.slot());
+            __stats.begin(true);
+#else
+            __detail::__acquire(__lock, __lock_timeout, _message, __name, __writers_waiting);
+#endif
+#ifdef TS_STL_LOCK_DIAGNOSTICS
+            __hold.begin(__lock.mutex(), __site, true);
+#endif
+#ifdef TS_STL_LOCK_TRACING
+            __detail::__trace(__detail::__trace_kind::acquired, __lock.mutex(), true);
+#endif
+#ifdef TS_STL_LOCK_ORDER_CHECK
+            __detail::__order_acquired(__lock.mutex(), __site, true);
+#endif
+        }
 
     public:
-        unique_accessor(_CT &_c, _MT &_mu)
+        unique_accessor(_CT &_c, _MT &_mu, std::atomic<unsigned> *_writers_waiting = nullptr, __detail::__metadata_cell *_metadata = nullptr)
             : __container(_c),
             __lock(_mu, std::defer_lock),
+            __writers_waiting(_writers_waiting),
+            __metadata(_metadata),
             __lock_timeout(10000)
         {
         }
+        unique_accessor(unique_accessor &&) = default;
+
+        /**
+         * @brief publishes the metadata of the container and releases the lock if it owns it.
+         */
+        ~unique_accessor()
+        {
+            unlock();
+        }
+
+#ifdef TS_STL_CALL_SITES
+        /**
+         * @brief sets the call site reported for this accessor by lock diagnostics (see hooks.hpp and lock_order.hpp)
+         */
+        void set_call_site(const source_location &_site) noexcept
+        {
+            __site = _site;
+        }
+#endif
+#ifdef TS_STL_STATS
+        /**
+         * @brief sets the slot of the wrapper in the stats file this accessor counts its locks in (see stats.hpp)
+         */
+        void set_stats(__detail::__stats_slot *_slot) noexcept
+        {
+            __stats.set_slot(_slot);
+        }
+#endif
+
+        /**
+         * @brief sets the name of the wrapper reported in lock_timeout_errors.
+         * _name is not copied and has to outlive the accessor.
+         */
+        void set_name(const char *_name) noexcept
+        {
+            __name = _name;
+        }
 
         /**
          * @brief Set the lock timeout. This timeout is used when accessing
@@ -210,25 +652,33 @@ namespace ts
          */
         void lock()
         {
-            if (__lock)
-                return;
-            if (__lock_timeout.count() < 0)
-            {
-                __lock.lock();
-                return;
-            }
-            __lock.try_lock_for(__lock_timeout);
             if (!__lock)
-                throw lock_timeout_error("ts-stl/wrapper unique_accessor::lock() timeout");
+                __take("ts-stl/wrapper unique_accessor::lock() timeout");
         }
 
         /**
-         * @brief Releases the lock if it owns it.
+         * @brief Releases the lock if it owns it, after publishing the metadata of the
+         * container (see wrapper::metadata()).
          */
         void unlock()
         {
-            if (__lock)
-                __lock.unlock();
+            if (!__lock)
+                return;
+            if (__metadata)
+                __metadata->publish(__container);
+#ifdef TS_STL_LOCK_DIAGNOSTICS
+            __hold.end();
+#endif
+#ifdef TS_STL_STATS
+            __stats.end();
+#endif
+#ifdef TS_STL_LOCK_TRACING
+            __detail::__trace(__detail::__trace_kind::released, __lock.mutex(), true);
+#endif
+#ifdef TS_STL_LOCK_ORDER_CHECK
+            __detail::__order_released(__lock.mutex());
+#endif
+            __lock.unlock();
         }
 
         /**
@@ -239,21 +689,9 @@ namespace ts
          */
         _CT *operator->()
         {
-            // just return if lock is already owned
-            if (__lock)
-                return &__container;
-
-            // otherwise aquire lock
-            if (__lock_timeout.count() < 0)
-            {
-                __lock.lock();
-            }
-            else
-            {
-                __lock.try_lock_for(__lock_timeout);
-                if (!__lock)
-                    throw lock_timeout_error("ts-stl/wrapper unique_accessor::operator->() timeout");
-            }
+            // aquire lock if it isn't owned already
+            if (!__lock)
+                __take("ts-stl/wrapper unique_accessor::operator->() timeout");
 
             return &__container;
         }
@@ -265,22 +703,220 @@ namespace ts
          */
         _CT &operator*()
         {
-            // just return if lock is already owned
-            if (__lock)
-                return __container;
+            // aquire lock if it isn't owned already
+            if (!__lock)
+                __take("ts-stl/wrapper unique_accessor::operator*() timeout");
+
+            return __container;
+        }
+    };
+
+
+    /**
+     * @brief shared access to a container (typically in a ts::wrapper object) that is meant to be
+     * held across many reads, e.g. by a worker for a whole batch of lookups. Taking a shared accessor
+     * per lookup costs a lock round trip every time, while holding one for long blocks all writers.
+     * A lease keeps the shared lock instead, and the worker calls checkpoint() at safe points where it
+     * doesn't hold any references into the container. Whenever a writer is waiting for the wrapper,
+     * the lease steps aside at the next checkpoint until the writer got the lock and then re-acquires
+     * it. Checking for waiting writers is a single relaxed load, so checkpoints can be frequent.
+     *
+     * Note that the lease class itself is not thread safe, meaning one instance of lease is only ever allowed to be used in a single thread.
+     *
+     * @tparam _CT container type
+     * @tparam _MT mutex type
+     */
+    template <class _CT, class _MT>
+    class shared_lease
+    {
+    private:
+        const _CT &__container;
+        std::shared_lock<_MT> __lock;
+        const std::atomic<unsigned> &__writers_waiting;
+
+        std::chrono::milliseconds __lock_timeout;
+        // name of the wrapper reported in lock_timeout_errors
+        const char *__name = nullptr;
+
+#ifdef TS_STL_CALL_SITES
+        // call site reported by lock diagnostics, see hooks.hpp and lock_order.hpp
+        source_location __site;
+#endif
+#ifdef TS_STL_LOCK_DIAGNOSTICS
+        // hold record for lock diagnostics, see hooks.hpp
+        __detail::__hold_token __hold;
+#endif
+#ifdef TS_STL_STATS
+        // acquisition and hold time counters of the wrapper, see stats.hpp
+        __detail::__stats_token __stats;
+#endif
+
+        void __take(const char *_message)
+        {
+#ifdef TS_STL_LOCK_ORDER_CHECK
+            __detail::__order_acquiring(__lock.mutex(), __site, false);
+#endif
+#ifdef TS_STL_STATS
+            __detail::__acquire(__lock, __lock_timeout, _message, __name, nullptr, __stats.slot());
+            __stats.begin(false);
+#else
+            __detail::__acquire(__lock, __lock_timeout, _message, __name);
+#endif
+#ifdef TS_STL_LOCK_DIAGNOSTICS
+            __hold.begin(__lock.mutex(), __site, false);
+#endif
+#ifdef TS_STL_LOCK_TRACING
+            __detail::__trace(__detail::__trace_kind::acquired, __lock.mutex(), false);
+#endif
+#ifdef TS_STL_LOCK_ORDER_CHECK
+            __detail::__order_acquired(__lock.mutex(), __site, false);
+#endif
+        }
 
-            // otherwise aquire lock
-            if (__lock_timeout.count() < 0)
-            {
-                __lock.lock();
-            }
-            else
-            {
-                __lock.try_lock_for(__lock_timeout);
-                if (!__lock)
-                    throw lock_timeout_error("ts-stl/wrapper unique_accessor::operator*() timeout");
-            }
+    public:
+        shared_lease(const _CT &_c, _MT &_mu, const std::atomic<unsigned> &_writers_waiting)
+            : __container(_c),
+            __lock(_mu, std::defer_lock),
+            __writers_waiting(_writers_waiting),
+            __lock_timeout(10000)
+        {
+        }
+        shared_lease(shared_lease &&) = default;
+
+        /**
+         * @brief releases the lock if it owns it.
+         */
+        ~shared_lease()
+        {
+            unlock();
+        }
+
+#ifdef TS_STL_CALL_SITES
+        /**
+         * @brief sets the call site reported for this accessor by lock diagnostics (see hooks.hpp and lock_order.hpp)
+         */
+        void set_call_site(const source_location &_site) noexcept
+        {
+            __site = _site;
+        }
+#endif
+#ifdef TS_STL_STATS
+        /**
+         * @brief sets the slot of the wrapper in the stats file this accessor counts its locks in (see stats.hpp)
+         */
+        void set_stats(__detail::__stats_slot *_slot) noexcept
+        {
+            __stats.set_slot(_slot);
+        }
+#endif
+
+        /**
+         * @brief sets the name of the wrapper reported in lock_timeout_errors.
+         * _name is not copied and has to outlive the lease.
+         */
+        void set_name(const char *_name) noexcept
+        {
+            __name = _name;
+        }
+
+        /**
+         * @brief Set the lock timeout. This timeout is used when (re-)aquiring the lock
+         * and bounds how long checkpoint() waits for writers to go first. If it is configured
+         * to a negative number (preferably -1) the timeout is disabled
+         *
+         * Default: 10000 ms
+         *
+         * @param _ms timeout value
+         */
+        void set_lock_timeout(std::chrono::milliseconds _ms)
+        {
+            __lock_timeout = _ms;
+        }
+
+        /**
+         * @brief manually aquire the lock of the underlying container object.
+         * If the lock timeout is exceeded, a lock_timeout_error is thrown
+         *
+         */
+        void lock()
+        {
+            if (!__lock)
+                __take("ts-stl/wrapper shared_lease::lock() timeout");
+        }
 
+        /**
+         * @brief Releases the lock if it owns it.
+         */
+        void unlock()
+        {
+            if (!__lock)
+                return;
+#ifdef TS_STL_LOCK_DIAGNOSTICS
+            __hold.end();
+#endif
+#ifdef TS_STL_STATS
+            __stats.end();
+#endif
+#ifdef TS_STL_LOCK_TRACING
+            __detail::__trace(__detail::__trace_kind::released, __lock.mutex(), false);
+#endif
+#ifdef TS_STL_LOCK_ORDER_CHECK
+            __detail::__order_released(__lock.mutex());
+#endif
+            __lock.unlock();
+        }
+
+        /**
+         * @return bool whether a writer is currently waiting for the lock
+         */
+        bool writer_waiting() const noexcept
+        {
+            return __writers_waiting.load(std::memory_order_relaxed) != 0;
+        }
+
+        /**
+         * @brief safe point of the lease holder. If the lease owns the lock and a writer is waiting,
+         * the lock is released until the waiting writers got it (at most for the lock timeout) and
+         * then re-aquired. If this returns true, the container may have been modified, so pointers,
+         * references and iterators into it obtained before must not be used anymore.
+         * If the lock timeout is exceeded while re-aquiring, a lock_timeout_error is thrown.
+         *
+         * @return bool true if the lock was released in between
+         */
+        bool checkpoint()
+        {
+            if (!__lock || !writer_waiting())
+                return false;
+
+            unlock();
+            // let the writers take the lock before competing for it again
+            auto deadline = std::chrono::steady_clock::now() + __lock_timeout;
+            while (writer_waiting() && (__lock_timeout.count() < 0 || std::chrono::steady_clock::now() < deadline))
+                std::this_thread::yield();
+            lock();
+            return true;
+        }
+
+        /**
+         * @brief arrow operator can be used to access container object members.
+         * When using this operator, lock access will be aquired if the lock is
+         * not owned already. If the lock timeout is not configured to -1 and is
+         * exceeded without a successfull lock, a ts::lock_timeout_error is thrown.
+         */
+        const _CT *operator->()
+        {
+            lock();
+            return &__container;
+        }
+        /**
+         * @brief asterisk operator can be used to access the container object directly.
+         * When using this operator, lock access will be aquired if the lock is
+         * not owned already. If the lock timeout is not configured to -1 and is
+         * exceeded without a successfull lock, a ts::lock_timeout_error is thrown.
+         */
+        const _CT &operator*()
+        {
+            lock();
             return __container;
         }
     };
@@ -292,50 +928,78 @@ namespace ts
      * get_exclusive_access() or get_shared_access()
      *
      * @tparam _T container type
+     * @tparam _MT mutex type (a shared timed mutex, or ts::null_lock for no synchronization,
+     * or ts::lock_free / ts::seqlock for small trivially copyable values, see atomic_wrapper)
      */
-    template <class _T>
+    template <class _T, class _MT = default_mutex>
     class wrapper
     {
     private:
         _T __container;
-        std::shared_timed_mutex __stmutex;
+        _MT __stmutex;
+        // writers currently waiting for __stmutex, polled by shared leases
+        std::atomic<unsigned> __writers_waiting{0};
+        // published by unique accessors when they release __stmutex
+        __detail::__metadata_cell __metadata;
+#ifdef TS_STL_STATS
+        // slot in the stats file the metadata and lock counters are published to, see stats.hpp
+        __detail::__stats_registration __stats{__metadata, !__detail::__process_shared_mutex<_MT>::value};
+#endif
 
         std::chrono::milliseconds __lock_timeout;
+        // reported in lock_timeout_errors, a fixed array so wrappers can live in shared memory
+        char __name[32] = {};
 
     public:
-        typedef std::unique_lock<std::shared_timed_mutex> _ulock_t;
-        typedef std::shared_lock<std::shared_timed_mutex> _slock_t;
+        typedef std::unique_lock<_MT> _ulock_t;
+        typedef std::shared_lock<_MT> _slock_t;
 
         wrapper(_T &&_stl_init)
             : __container(std::move(_stl_init)),
             __lock_timeout(10000)
         {
+            __metadata.publish(__container);
         }
         wrapper(const _T &_stl_init)
             : __container(std::copy(_stl_init)),
             __lock_timeout(10000)
         {
+            __metadata.publish(__container);
         }
         wrapper()
             : __lock_timeout(10000)
-            {}
+        {
+            __metadata.publish(__container);
+        }
         
         // allow copy, move, assign
         wrapper(const wrapper &_other)
+            : __lock_timeout(10000)
         {
             _slock_t readlock(_other.__stmutex, std::defer_lock);
             assert(("ts-stl/wrapper copy", readlock.try_lock_for(__lock_timeout)));
             __container = std::copy(_other.__container);
             __lock_timeout = _other.__lock_timeout;
+            __metadata.publish(__container);
         }
         wrapper(wrapper &&_other)
+            : __lock_timeout(10000)
         {
             _ulock_t writelock(_other.__stmutex, std::defer_lock);
             assert(("ts-stl/wrapper move", writelock.try_lock_for(__lock_timeout)));
             __container = std::move(_other.__container);
             __lock_timeout = _other.__lock_timeout;
+            __metadata.publish(__container);
+            _other.__metadata.publish(_other.__container);
         }
 
+#ifdef TS_STL_LOCK_ORDER_CHECK
+        ~wrapper()
+        {
+            __detail::__order_forget(&__stmutex);
+        }
+#endif
+
         wrapper &operator=(const wrapper &_rhs)
         {
             if (this == &_rhs)
@@ -346,6 +1010,7 @@ namespace ts
             std::lock(lhs_write_lock, rhs_read_lock);
             __container = std::copy(_rhs.__container);
             __lock_timeout = _rhs.__lock_timeout;
+            __metadata.publish(__container);
 
             return *this;
         }
@@ -359,6 +1024,8 @@ namespace ts
             std::lock(lhs_write_lock, rhs_write_lock);
             __container = std::move(_rhs.__container);
             __lock_timeout = _rhs.__lock_timeout;
+            __metadata.publish(__container);
+            _rhs.__metadata.publish(_rhs.__container);
 
             return *this;
         }
@@ -378,6 +1045,39 @@ namespace ts
             __lock_timeout = _ms;
         }
 
+        /**
+         * @brief names the wrapper, so lock_timeout_errors of its accessors tell which container
+         * timed out. Longer names are truncated to 31 characters. Like the lock timeout, this
+         * should be set before the wrapper is shared between threads. Copies and moves of the
+         * wrapper don't take over the name.
+         *
+         * @param _name name of the wrapper, e.g. "sessions"
+         */
+        void set_name(const char *_name) noexcept
+        {
+            std::size_t i = 0;
+            for (; _name && _name[i] && i < sizeof(__name) - 1; i++)
+                __name[i] = _name[i];
+            __name[i] = 0;
+#ifdef TS_STL_LOCK_TRACING
+            __detail::__trace_name(&__stmutex, __name);
+#endif
+#ifdef TS_STL_LOCK_ORDER_CHECK
+            __detail::__order_name(&__stmutex, __name);
+#endif
+#ifdef TS_STL_STATS
+            __stats.set_name(__name);
+#endif
+        }
+
+        /**
+         * @brief name set with set_name(), empty if there is none
+         */
+        const char *name() const noexcept
+        {
+            return __name;
+        }
+
         /**
          * @brief creates a unique accessor to the container and returns it.
          * The unique accessor can then be used to access the container. 
@@ -389,10 +1089,22 @@ namespace ts
          * 
          * @param _aquire lock aquire flag
          */
-        unique_accessor<_T, std::shared_timed_mutex> get_exclusive_access(bool _aquire = true)
+        unique_accessor<_T, _MT> get_exclusive_access(bool _aquire = true
+#ifdef TS_STL_CALL_SITES
+            , source_location _site = source_location::current()
+#endif
+        )
         {
-            unique_accessor<_T, std::shared_timed_mutex> accessor(__container, __stmutex);
+            unique_accessor<_T, _MT> accessor(__container, __stmutex, &__writers_waiting, &__metadata);
             accessor.set_lock_timeout(__lock_timeout);
+            if (__name[0])
+                accessor.set_name(__name);
+#ifdef TS_STL_CALL_SITES
+            accessor.set_call_site(_site);
+#endif
+#ifdef TS_STL_STATS
+            accessor.set_stats(__stats.slot());
+#endif
             if (_aquire)
                 accessor.lock();
             return accessor;
@@ -409,14 +1121,107 @@ namespace ts
          * 
          * @param _aquire lock aquire flag
          */
-        shared_accessor<_T, std::shared_timed_mutex> get_shared_access(bool _aquire = true)
+        shared_accessor<_T, _MT> get_shared_access(bool _aquire = true
+#ifdef TS_STL_CALL_SITES
+            , source_location _site = source_location::current()
+#endif
+        )
         {
-            shared_accessor<_T, std::shared_timed_mutex> accessor(__container, __stmutex);
+            shared_accessor<_T, _MT> accessor(__container, __stmutex);
             accessor.set_lock_timeout(__lock_timeout);
+            if (__name[0])
+                accessor.set_name(__name);
+#ifdef TS_STL_CALL_SITES
+            accessor.set_call_site(_site);
+#endif
+#ifdef TS_STL_STATS
+            accessor.set_stats(__stats.slot());
+#endif
             if (_aquire)
                 accessor.lock();
             return accessor;
         }
+
+        /**
+         * @brief creates a shared lease of the container and returns it, see shared_lease.
+         * A worker can keep the lease for many reads as long as it regularly calls
+         * checkpoint() to let waiting writers go first.
+         * If _aquire is true (default) the mutex will be locket (with configured timeout).
+         *
+         * @param _aquire lock aquire flag
+         */
+        shared_lease<_T, _MT> get_shared_lease(bool _aquire = true
+#ifdef TS_STL_CALL_SITES
+            , source_location _site = source_location::current()
+#endif
+        )
+        {
+            shared_lease<_T, _MT> lease(__container, __stmutex, __writers_waiting);
+            lease.set_lock_timeout(__lock_timeout);
+            if (__name[0])
+                lease.set_name(__name);
+#ifdef TS_STL_CALL_SITES
+            lease.set_call_site(_site);
+#endif
+#ifdef TS_STL_STATS
+            lease.set_stats(__stats.slot());
+#endif
+            if (_aquire)
+                lease.lock();
+            return lease;
+        }
+
+        /**
+         * @brief number of elements of the container as published by the last unique accessor
+         * releasing its lock. This is a single atomic load and doesn't lock the container, so
+         * it can be polled frequently, but it doesn't reflect a modification in progress.
+         * Only available for containers with a size() member.
+         */
+        template <class _C = _T, std::enable_if_t<__detail::__has_size<_C>::value, int> = 0>
+        std::size_t size() const noexcept
+        {
+            return __metadata.size();
+        }
+
+        /**
+         * @brief whether the container is empty, published like size(). Also available for
+         * containers without size() but with begin() and end() (e.g. std::forward_list).
+         */
+        template <class _C = _T, std::enable_if_t<__detail::__knows_empty<_C>, int> = 0>
+        bool empty() const noexcept
+        {
+            return __metadata.empty();
+        }
+
+        /**
+         * @brief consistent snapshot of the container's metadata (size, bucket count, load factor,
+         * approximate bytes) as published by the last unique accessor releasing its lock. Like
+         * size() this doesn't lock the container. The generation changes with every publication.
+         */
+        container_metadata metadata() const noexcept
+        {
+            return __metadata.load();
+        }
+
+        /**
+         * @brief exchanges the contents of the wrapped container with _other while
+         * holding exclusive access (with configured timeout). For STL containers this is
+         * an O(1) operation, so a container that was built without any locking can be
+         * published with one very short critical section. The previous contents end up
+         * in _other and can be destroyed after the lock has been released.
+         *
+         * @param _other container to exchange contents with
+         */
+        void swap(_T &_other)
+        {
+            auto accessor = get_exclusive_access();
+            using std::swap;
+            swap(*accessor, _other);
+        }
     };
 
-};
\ No newline at end of file
+};
+// unsynchronized specializations, see TS_STL_NULL_LOCK
+#include "null_lock.hpp"
+// specializations for small trivially copyable types, see atomic_wrapper
+#include "lock_free.hpp"
@@ -0,0 +1,144 @@
+/*
+ELEKTRON © 2026 - now
+Written by melektron
+www.elektron.work
+18.10.26, 00:48
+All rights reserved.
+
+This source code is licensed under the Apache-2.0 license found in the
+LICENSE file in the root directory of this source tree.
+
+ts-stl-stat: prints the wrapper statistics of a process built with TS_STL_STATS (see ts/stats.hpp).
+
+    c++ -std=c++17 -O2 -I include tools/ts-stl-stat.cpp -o ts-stl-stat -lrt
+
+    ts-stl-stat <pid>               prints the statistics once
+    ts-stl-stat <pid> <interval>    prints the rates every <interval> milliseconds until the process exits
+*/
+
+#include <map>
+#include <chrono>
+#include <cerrno>
+#include <thread>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+
+#include <signal.h>
+
+#include "ts/stats.hpp"
+
+namespace
+{
+    void print_header(bool _rates)
+    {
+        if (_rates)
+            std::printf("%-32s %12s %12s %12s %10s %9s %8s %8s\n", "wrapper", "size", "shared/s", "excl/s", "cont/s", "timeout/s", "wait%", "hold%");
+        else
+            std::printf("%-32s %12s %12s %12s %12s %10s %9s %12s %12s\n", "wrapper", "size", "bytes", "shared", "exclusive", "contended", "timeouts", "wait ms", "hold ms");
+    }
+
+    const char *label(const ts::wrapper_stats &_stats, char (&_buffer)[48])
+    {
+        if (!_stats.name.empty())
+            return _stats.name.c_str();
+        std::snprintf(_buffer, sizeof(_buffer), "#%llu", static_cast<unsigned long long>(_stats.id));
+        return _buffer;
+    }
+
+    void print_totals(const ts::wrapper_stats &_stats)
+    {
+        char buffer[48];
+        std::printf("%-32s %12llu %12llu %12llu %12llu %10llu %9llu %12.3f %12.3f\n", label(_stats, buffer),
+                    static_cast<unsigned long long>(_stats.size), static_cast<unsigned long long>(_stats.bytes),
+                    static_cast<unsigned long long>(_stats.shared_acquisitions), static_cast<unsigned long long>(_stats.exclusive_acquisitions),
+                    static_cast<unsigned long long>(_stats.contended), static_cast<unsigned long long>(_stats.timeouts),
+                    _stats.wait.count() / 1e6, _stats.hold.count() / 1e6);
+    }
+
+    void print_rates(const ts::wrapper_stats &_now, const ts::wrapper_stats &_before, double _seconds)
+    {
+        char buffer[48];
+        auto rate = [&](std::uint64_t _now_value, std::uint64_t _before_value)
+        {
+            return static_cast<double>(_now_value - _before_value) / _seconds;
+        };
+        // share of the interval spent waiting for and holding the lock, summed over all threads
+        auto share = [&](std::chrono::nanoseconds _now_value, std::chrono::nanoseconds _before_value)
+        {
+            return 100.0 * static_cast<double>((_now_value - _before_value).count()) / (_seconds * 1e9);
+        };
+        std::printf("%-32s %12llu %12.0f %12.0f %10.0f %9.0f %8.1f %8.1f\n", label(_now, buffer), static_cast<unsigned long long>(_now.size),
+                    rate(_now.shared_acquisitions, _before.shared_acquisitions), rate(_now.exclusive_acquisitions, _before.exclusive_acquisitions),
+                    rate(_now.contended, _before.contended), rate(_now.timeouts, _before.timeouts),
+                    share(_now.wait, _before.wait), share(_now.hold, _before.hold));
+    }
+
+    void print_dropped(const ts::stats_reader &_reader)
+    {
+        // wrappers created while the stats file was full are missing from the table
+        if (std::uint64_t dropped = _reader.dropped())
+            std::printf("(%llu wrappers not recorded, the stats file was full)\n", static_cast<unsigned long long>(dropped));
+    }
+};
+
+int main(int _argc, char **_argv)
+{
+    if (_argc < 2 || _argc > 3)
+    {
+        std::fprintf(stderr, "usage: %s <pid> [interval ms]\n", _argv[0]);
+        return 2;
+    }
+    long pid = std::strtol(_argv[1], nullptr, 10);
+    long interval = _argc == 3 ? std::strtol(_argv[2], nullptr, 10) : 0;
+
+    try
+    {
+        ts::stats_reader reader(pid);
+        if (interval <= 0)
+        {
+            print_header(false);
+            for (const ts::wrapper_stats &stats : reader.read())
+                print_totals(stats);
+            print_dropped(reader);
+            return 0;
+        }
+
+        // previous sample of every wrapper by slot id, wrappers created meanwhile start at zero
+        std::map<std::uint64_t, ts::wrapper_stats> before;
+        auto sampled = std::chrono::steady_clock::now();
+        for (const ts::wrapper_stats &stats : reader.read())
+            before[stats.id] = stats;
+        for (;;)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+            // the file stays readable while mapped, even after the process removed it
+            if (kill(static_cast<pid_t>(pid), 0) != 0 && errno != EPERM)
+                break;
+            auto now = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(now - sampled).count();
+            sampled = now;
+
+            std::map<std::uint64_t, ts::wrapper_stats> current;
+            for (const ts::wrapper_stats &stats : reader.read())
+                current[stats.id] = stats;
+            print_header(true);
+            for (auto &[id, stats] : current)
+            {
+                auto it = before.find(id);
+                print_rates(stats, it != before.end() ? it->second : ts::wrapper_stats(), seconds);
+            }
+            print_dropped(reader);
+            std::printf("\n");
+            std::fflush(stdout);
+            before = std::move(current);
+        }
+        return 0;
+    }
+    catch (const std::exception &_error)
+    {
+        std::fprintf(stderr, "%s: %s\n", _argv[0], _error.what());
+        return 1;
+    }
+}